@@ -1,163 +1,369 @@
 #include "backtest.h"
+#include "day_number.h"
+#include "profiler.h"
 
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <iomanip>
+#include <limits>
+#include <numeric>
+#include <sstream>
 #include <string>
 
-Indicators::Indicators(const std::vector<Data::Bar>& bars) : bars_(bars) {}
+Indicators::Indicators(const BarView& bars) : bars_(bars) {}
 
-double Indicators::movingAverage(int length, size_t endIndex) {
-    if (bars_.size() < static_cast<size_t>(length)) {
-        return 0;
+const double* Indicators::values(FeatureKind kind, int length) {
+    for (const CachedSeries& cached : series_) {
+        if (cached.kind == kind && cached.length == length) {
+            return cached.values->data() + bars_.offset();
+        }
     }
+    series_.push_back({kind, length, FeatureStore::instance().get(bars_, kind, length)});
+    return series_.back().values->data() + bars_.offset();
+}
 
-    double sum = 0.0;
-    for (size_t i = endIndex + 1 - length; i <= endIndex; ++i) {
-        sum += bars_[i].close;
+// Each returns 0 until length bars are available in the view. Past that the window lies inside
+// the view, so the value over the full history is the same one the view alone would give.
+double Indicators::value(FeatureKind kind, int length, size_t endIndex) {
+    if (endIndex + 1 < static_cast<size_t>(length)) {
+        return 0.0;
     }
-    return sum / length;
+    return values(kind, length)[endIndex];
+}
+
+double Indicators::movingAverage(int length, size_t endIndex) {
+    return value(FeatureKind::SMA, length, endIndex);
 }
 
 double Indicators::adr(int length, size_t endIndex) {
-    if (endIndex + 1 < static_cast<size_t>(length)) {
-        return 0;
+    return value(FeatureKind::ADR, length, endIndex);
+}
+
+double Indicators::avgVolume(int length, size_t endIndex) {
+    return value(FeatureKind::AvgVolume, length, endIndex);
+}
+
+// ------------------------
+// Strategy parameters
+// ------------------------
+
+namespace {
+
+bool parseValues(const std::string& key, const std::string& list, std::vector<double>& values, std::string& error) {
+    std::size_t start = 0;
+    while (start <= list.size()) {
+        std::size_t end = list.find(',', start);
+        if (end == std::string::npos) {
+            end = list.size();
+        }
+        const std::string item = list.substr(start, end - start);
+        char* parsedEnd = nullptr;
+        const double value = std::strtod(item.c_str(), &parsedEnd);
+        if (item.empty() || parsedEnd != item.c_str() + item.size()) {
+            error = "invalid value \"" + item + "\" for " + key;
+            return false;
+        }
+        values.push_back(value);
+        start = end + 1;
     }
+    return true;
+}
 
-    double sumADR = 0.0;
-    for (size_t i = endIndex + 1 - length; i <= endIndex; ++i) {
-        sumADR += (bars_[i].high - bars_[i].low);
+bool setParam(StrategyParams& params, const std::string& key, double value, std::string& error) {
+    int* integer = nullptr;
+    if (key == "ma") integer = &params.maPeriod;
+    else if (key == "adr") integer = &params.adrPeriod;
+    else if (key == "volperiod") integer = &params.volumePeriod;
+    else if (key == "risk") integer = &params.dollarRisk;
+    else if (key == "minvol") params.minAvgVolume = value;
+    else if (key == "entry") params.entryAdrs = value;
+    else if (key == "stop") params.stopAdrs = value;
+    else if (key == "partial") params.partialAdrs = value;
+    else if (key == "target") params.targetAdrs = value;
+    else {
+        error = "unknown parameter \"" + key + "\"";
+        return false;
     }
 
-    return sumADR / length;
+    if (integer) {
+        // Checked before the cast, which is undefined outside the int range
+        if (!(value >= std::numeric_limits<int>::min() && value <= std::numeric_limits<int>::max())
+            || value != std::floor(value)) {
+            std::ostringstream text;
+            text << value;
+            error = key + " must be a whole number, got " + text.str();
+            return false;
+        }
+        *integer = static_cast<int>(value);
+    }
+    return true;
 }
 
-double Indicators::avgVolume(int length, size_t endIndex) {
-    if (endIndex + 1 < static_cast<size_t>(length)) {
-        return 0;
+} // namespace
+
+bool parseStrategyGrid(const std::string& text, std::vector<StrategyParams>& variants, std::string& error) {
+    variants.assign(1, StrategyParams());
+    std::istringstream words(text);
+    std::string word;
+    while (words >> word) {
+        const std::size_t equals = word.find('=');
+        if (equals == std::string::npos) {
+            error = "expected key=values, got \"" + word + "\"";
+            return false;
+        }
+        const std::string key = word.substr(0, equals);
+        std::vector<double> values;
+        if (!parseValues(key, word.substr(equals + 1), values, error)) {
+            return false;
+        }
+
+        std::vector<StrategyParams> expanded;
+        expanded.reserve(variants.size() * values.size());
+        for (const StrategyParams& base : variants) {
+            for (double value : values) {
+                StrategyParams params = base;
+                if (!setParam(params, key, value, error)) {
+                    return false;
+                }
+                if (params.maPeriod <= 0 || params.adrPeriod <= 0 || params.volumePeriod <= 0) {
+                    error = "periods must be positive";
+                    return false;
+                }
+                expanded.push_back(params);
+            }
+        }
+        variants.swap(expanded);
+    }
+    return true;
+}
+
+std::string describeStrategy(const StrategyParams& params) {
+    std::ostringstream text;
+    text << std::setprecision(17)
+         << "ma=" << params.maPeriod << " adr=" << params.adrPeriod << " volperiod=" << params.volumePeriod
+         << " minvol=" << params.minAvgVolume << " risk=" << params.dollarRisk << " entry=" << params.entryAdrs
+         << " stop=" << params.stopAdrs << " partial=" << params.partialAdrs << " target=" << params.targetAdrs;
+    return text.str();
+}
+
+std::size_t tradeLogBytes(const std::vector<TradeRecord>& trades) {
+    // Strings of up to 15 characters live inside the record in the common standard libraries
+    auto heap = [](const std::string& text) { return text.capacity() > 15 ? text.capacity() + 1 : 0; };
+    std::size_t bytes = trades.capacity() * sizeof(TradeRecord);
+    for (const TradeRecord& trade : trades) {
+        bytes += heap(trade.ticker) + heap(trade.buyDate) + heap(trade.sellDate) + heap(trade.info);
+    }
+    return bytes;
+}
+
+// ------------------------
+// Backtest
+// ------------------------
+
+namespace {
+
+// Bars before this are never traded, whatever the periods
+constexpr std::size_t kFirstTradedBar = 14;
+
+// State of every variant, one array per field. Orders are plain prices and quantities: a
+// variant has at most one buy stop, or one position with its stop, partial and target exits.
+struct BatchState {
+    explicit BatchState(std::size_t count)
+        : pending(count, 0), inPosition(count, 0), partialHit(count, 0),
+          entryPrice(count, 0.0), stopPrice(count, 0.0), partialPrice(count, 0.0), targetPrice(count, 0.0),
+          buyPrice(count, 0.0), entryQuantity(count, 0), stopQuantity(count, 0), partialQuantity(count, 0),
+          targetQuantity(count, 0), openQuantity(count, 0), buyDay(count, 0),
+          upTrigger(count, std::numeric_limits<double>::infinity()),
+          downTrigger(count, -std::numeric_limits<double>::infinity()),
+          volumeTrigger(count, std::numeric_limits<double>::infinity()) {}
+
+    // Sets the levels at which variant k next has something to do: its buy stop while one is
+    // pending, its exits while in a position, and otherwise the average volume of an entry
+    void arm(std::size_t k, double minAvgVolume) {
+        const double never = std::numeric_limits<double>::infinity();
+        upTrigger[k] = pending[k] ? entryPrice[k]
+                     : inPosition[k] ? (partialHit[k] ? targetPrice[k] : partialPrice[k]) : never;
+        downTrigger[k] = inPosition[k] ? stopPrice[k] : -never;
+        volumeTrigger[k] = pending[k] || inPosition[k] ? never : minAvgVolume;
+    }
+
+    std::vector<unsigned char> pending, inPosition, partialHit;
+    std::vector<double> entryPrice, stopPrice, partialPrice, targetPrice, buyPrice;
+    std::vector<int> entryQuantity, stopQuantity, partialQuantity, targetQuantity, openQuantity;
+    std::vector<int> buyDay;
+    // A variant needs stepping when high >= upTrigger, low <= downTrigger or the average volume
+    // is above volumeTrigger; disarmed variants never do
+    std::vector<double> upTrigger, downTrigger, volumeTrigger;
+};
+
+// Per-variant inputs resolved once per view
+struct VariantSeries {
+    const double* ma;
+    const double* adr;
+    const double* volume;
+    std::size_t firstBar;
+};
+
+TradeRecord makeTrade(const std::string& ticker, int buyDay, int sellDay, double buyPrice, double sellPrice,
+                      int quantity, const char* info) {
+    TradeRecord trade;
+    trade.ticker = ticker;
+    trade.buyDate = dayToString(buyDay);
+    trade.sellDate = dayToString(sellDay);
+    trade.buyDay = buyDay;
+    trade.sellDay = sellDay;
+    trade.buyPrice = buyPrice;
+    trade.sellPrice = sellPrice;
+    trade.quantity = quantity;
+    trade.info = info;
+    return trade;
+}
+
+// One bar of variant k: fill a pending buy stop, or place one on a signal, then work the exits
+void stepVariant(BatchState& s, std::size_t k, const StrategyParams& params, const VariantSeries& series,
+                 std::size_t i, const std::string& ticker, int day, double high, double low,
+                 std::vector<TradeRecord>& trades) {
+    const double adr = series.adr[i];
+
+    if (s.pending[k]) {
+        if (high >= s.entryPrice[k]) {
+            s.inPosition[k] = 1;
+            s.pending[k] = 0;
+            s.buyPrice[k] = s.entryPrice[k];
+            s.buyDay[k] = day;
+            s.openQuantity[k] = s.entryQuantity[k];
+            s.stopPrice[k] = s.buyPrice[k] - params.stopAdrs * adr;
+            s.stopQuantity[k] = s.openQuantity[k];
+            s.partialPrice[k] = s.buyPrice[k] + params.partialAdrs * adr;
+            s.partialQuantity[k] = s.openQuantity[k] / 2;
+            s.targetPrice[k] = s.buyPrice[k] + params.targetAdrs * adr;
+            s.targetQuantity[k] = s.openQuantity[k] / 2;
+        }
+    } else if (!s.inPosition[k]) {
+        // Only the average volume gates entries: the high > MA test was always discarded by a
+        // comma operator, and results are kept as they were
+        if (series.volume[i] > params.minAvgVolume && adr > 0.0) {
+            int orderSize = params.dollarRisk / adr;
+            if (orderSize >= 2) {
+                s.entryPrice[k] = series.ma[i] + params.entryAdrs * adr;
+                s.entryQuantity[k] = orderSize;
+                s.pending[k] = 1;
+            }
+        }
     }
 
-    double sumVol = 0.0;
-    for (size_t i = endIndex + 1 - length; i <= endIndex; ++i) {
-        sumVol += (bars_[i].volume);
+    if (!s.inPosition[k]) {
+        return;
+    }
+    if (s.partialHit[k] && high >= s.targetPrice[k]) {
+        trades.push_back(makeTrade(ticker, s.buyDay[k], day, s.buyPrice[k], s.targetPrice[k], s.targetQuantity[k], "Full"));
+        s.partialHit[k] = 0;
+        s.inPosition[k] = 0;
+    } else if (!s.partialHit[k] && high >= s.partialPrice[k]) {
+        trades.push_back(makeTrade(ticker, s.buyDay[k], day, s.buyPrice[k], s.partialPrice[k], s.partialQuantity[k], "Partial"));
+        // The rest is stopped out at break-even
+        s.openQuantity[k] -= s.partialQuantity[k];
+        s.stopPrice[k] = s.buyPrice[k];
+        s.stopQuantity[k] = s.openQuantity[k];
+        s.partialHit[k] = 1;
+    } else if (low <= s.stopPrice[k]) {
+        trades.push_back(makeTrade(ticker, s.buyDay[k], day, s.buyPrice[k], s.stopPrice[k], s.stopQuantity[k], "Stop"));
+        s.partialHit[k] = 0;
+        s.inPosition[k] = 0;
     }
+}
 
-    return sumVol / length;
+} // namespace
+
+std::vector<TradeRecord> Backtest::run(const BarView& bars, const StrategyParams& params) {
+    return std::move(runBatch(bars, {params}).front());
 }
 
-std::vector<TradeRecord> Backtest::run(const std::vector<Data::Bar>& bars) {
-    std::vector<TradeRecord> completedTrades;
-    if (bars.size() < 2) {
+std::vector<std::vector<TradeRecord>> Backtest::runBatch(const BarView& bars, const std::vector<StrategyParams>& variants) {
+    BTE_PROFILE_SCOPE("Backtest::runBatch");
+    const std::size_t count = variants.size();
+    std::vector<std::vector<TradeRecord>> completedTrades(count);
+    if (bars.size() < 2 || count == 0) {
         return completedTrades;
     }
 
-    std::string ticker = bars.front().ticker;
-    Indicators indicators(bars);
+    const std::string& ticker = bars.ticker();
+    const int* day = bars.day();
+    const double* high = bars.high();
+    const double* low = bars.low();
 
-    Order pBuyStopOrder(OrderType::Limit, OrderSide::Buy, 0.0, 0, ticker, OrderInfo::Full, OrderStatus::Canceled);
-    Order pStopOrder(OrderType::Stop, OrderSide::Sell, 0.0, 0, ticker, OrderInfo::Full, OrderStatus::Canceled);
-    Order pLimitPartialOrder(OrderType::Limit, OrderSide::Sell, 0.0, 0, ticker, OrderInfo::Partial, OrderStatus::Canceled);
-    Order pLimitFlatOrder(OrderType::Limit, OrderSide::Sell, 0.0, 0, ticker, OrderInfo::Full, OrderStatus::Canceled);
-
-    int dollarRisk = 100;
-    bool pBuyStopOrderActive = false;
-    bool inPosition = false;
-    bool partialHit = false;
-    const int maPeriod = 10;
-
-    struct OpenTrade {
-        double buyPrice;
-        std::string buyDate;
-        double takeProfit;
-        double partialTarget;
-        int quantity;
-        double stopLoss;
-    } openTrade;
-
-    completedTrades.reserve(bars.size() / 5);
-
-    for (size_t i = 14; i < bars.size(); ++i) {
-        const Data::Bar& bar = bars[i];
-        if (i < static_cast<size_t>(maPeriod - 1)) {
-            continue;
-        }
+    // Variants sharing a period share its series
+    Indicators indicators(bars);
+    std::vector<VariantSeries> series(count);
+    std::size_t firstBar = bars.size();
+    for (std::size_t k = 0; k < count; ++k) {
+        const StrategyParams& params = variants[k];
+        series[k].ma = indicators.values(FeatureKind::SMA, params.maPeriod);
+        series[k].adr = indicators.values(FeatureKind::ADR, params.adrPeriod);
+        series[k].volume = indicators.values(FeatureKind::AvgVolume, params.volumePeriod);
+        // The original loop skipped bars before maPeriod - 1 outright, and saw the ADR and the
+        // average volume as 0 until their periods of view bars existed. A zero ADR blocks
+        // entries, as does a zero average volume unless the minimum is negative, so the first
+        // bar where anything can happen is the latest of these.
+        const int blocking = params.minAvgVolume >= 0.0 ? std::max(params.adrPeriod, params.volumePeriod)
+                                                        : params.adrPeriod;
+        const int longest = std::max(params.maPeriod, blocking);
+        series[k].firstBar = std::max(kFirstTradedBar, static_cast<std::size_t>(longest - 1));
+        firstBar = std::min(firstBar, series[k].firstBar);
+        completedTrades[k].reserve(bars.size() / 5);
+    }
 
-        double ma = indicators.movingAverage(maPeriod, i);
-        double adr = indicators.adr(14, i);
-        double volume = indicators.avgVolume(14, i);
+    // Lanes start out disarmed and are armed in order of their first traded bar
+    std::vector<std::size_t> startOrder(count);
+    std::iota(startOrder.begin(), startOrder.end(), 0);
+    std::stable_sort(startOrder.begin(), startOrder.end(), [&](std::size_t a, std::size_t b) {
+        return series[a].firstBar < series[b].firstBar;
+    });
+    std::size_t armed = 0;
 
-        if (pBuyStopOrderActive) {
-            if (bar.high >= pBuyStopOrder.getPrice()) {
-                inPosition = true;
-                openTrade.buyPrice = pBuyStopOrder.getPrice();
-                openTrade.buyDate = bar.date;
-                openTrade.quantity = pBuyStopOrder.getQuantity();
+    BatchState state(count);
+    std::vector<const double*> volumeSeries(count);
+    for (std::size_t k = 0; k < count; ++k) {
+        volumeSeries[k] = series[k].volume;
+    }
+    std::vector<double> volumeNow(count);
+    std::vector<unsigned char> active(count);
 
-                double stopPrice = openTrade.buyPrice - adr;
-                double partialPrice = openTrade.buyPrice + adr;
-                double takeProfitPrice = openTrade.buyPrice + (3 * adr);
+    for (std::size_t i = firstBar; i < bars.size(); ++i) {
+        while (armed < count && series[startOrder[armed]].firstBar <= i) {
+            const std::size_t k = startOrder[armed++];
+            state.arm(k, variants[k].minAvgVolume);
+        }
 
-                pStopOrder = Order(OrderType::Stop, OrderSide::Sell, stopPrice, openTrade.quantity, bar.ticker, OrderInfo::Full, OrderStatus::Active);
-                pLimitPartialOrder = Order(OrderType::Limit, OrderSide::Sell, partialPrice, openTrade.quantity / 2, bar.ticker, OrderInfo::Partial, OrderStatus::Active);
-                pLimitFlatOrder = Order(OrderType::Limit, OrderSide::Sell, takeProfitPrice, openTrade.quantity / 2, bar.ticker, OrderInfo::Full, OrderStatus::Active);
+        const double barHigh = high[i];
+        const double barLow = low[i];
+        const double* const* volumes = volumeSeries.data();
+        double* volume = volumeNow.data();
+        for (std::size_t k = 0; k < count; ++k) {
+            volume[k] = volumes[k][i];
+        }
 
-                pBuyStopOrderActive = false;
-            }
-        } else if (!inPosition && pBuyStopOrderActive == false) {
-            const Data::Bar& previousBar = bars[i - 1];
-            if (bar.high > ma, volume > 50000000) {
-                int orderSize = dollarRisk / adr;
-                if (orderSize >= 2) {
-                    double orderPrice = ma + (adr * 2);
-                    pBuyStopOrder = Order(OrderType::BuyStopLimit, OrderSide::Buy, orderPrice, orderSize, bar.ticker, OrderInfo::Full, OrderStatus::Active);
-                    pBuyStopOrderActive = true;
-                }
-            }
+        // Branch-free scan over all variants for the ones this bar can change: a buy stop that
+        // fills, an exit price that is reached or an entry signal. Most bars change none.
+        const double* up = state.upTrigger.data();
+        const double* down = state.downTrigger.data();
+        const double* volumeLevel = state.volumeTrigger.data();
+        unsigned char* lane = active.data();
+        unsigned char any = 0;
+        for (std::size_t k = 0; k < count; ++k) {
+            const unsigned char hit = (barHigh >= up[k]) | (barLow <= down[k]) | (volume[k] > volumeLevel[k]);
+            lane[k] = hit;
+            any |= hit;
+        }
+        if (!any) {
+            continue;
         }
 
-        if (inPosition) {
-            if (bar.high >= pLimitFlatOrder.getPrice() && partialHit == true) {
-                TradeRecord trade;
-                trade.ticker = bar.ticker;
-                trade.buyDate = openTrade.buyDate;
-                trade.sellDate = bar.date;
-                trade.buyPrice = openTrade.buyPrice;
-                trade.sellPrice = pLimitFlatOrder.getPrice();
-                trade.quantity = pLimitFlatOrder.getQuantity();
-                trade.info = "Full";
-                completedTrades.push_back(trade);
-                pStopOrder.cancel();
-                pLimitFlatOrder.cancel();
-
-                partialHit = false;
-                inPosition = false;
-            } else if (bar.high >= pLimitPartialOrder.getPrice() && partialHit == false) {
-                TradeRecord partialTrade;
-                partialTrade.ticker = bar.ticker;
-                partialTrade.buyDate = openTrade.buyDate;
-                partialTrade.sellDate = bar.date;
-                partialTrade.buyPrice = openTrade.buyPrice;
-                partialTrade.quantity = pLimitPartialOrder.getQuantity();
-                partialTrade.sellPrice = pLimitPartialOrder.getPrice();
-                partialTrade.info = "Partial";
-                completedTrades.push_back(partialTrade);
-                pStopOrder.cancel();
-                openTrade.quantity -= pLimitPartialOrder.getQuantity();
-                pStopOrder = Order(OrderType::Stop, OrderSide::Sell, openTrade.buyPrice, openTrade.quantity, bar.ticker, OrderInfo::Full, OrderStatus::Active);
-                pLimitPartialOrder.cancel();
-                partialHit = true;
-            } else if (bar.low <= pStopOrder.getPrice()) {
-                TradeRecord trade;
-                trade.ticker = bar.ticker;
-                trade.buyDate = openTrade.buyDate;
-                trade.sellDate = bar.date;
-                trade.buyPrice = openTrade.buyPrice;
-                trade.sellPrice = pStopOrder.getPrice();
-                trade.quantity = pStopOrder.getQuantity();
-                trade.info = "Stop";
-                completedTrades.push_back(trade);
-                pLimitPartialOrder.cancel();
-                pLimitFlatOrder.cancel();
-
-                partialHit = false;
-                inPosition = false;
+        for (std::size_t k = 0; k < count; ++k) {
+            if (active[k]) {
+                stepVariant(state, k, variants[k], series[k], i, ticker, day[i], barHigh, barLow, completedTrades[k]);
+                state.arm(k, variants[k].minAvgVolume);
             }
         }
     }
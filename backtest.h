@@ -7,34 +7,36 @@
 #include <ostream>
 #include <iostream>
 
-// Data class for loading stock data
-class Data
-{
-public:
-    struct Bar {
-        double open;
-        double high;
-        double low;
-        double close;
-        int volume;
-        std::string ticker;
-        std::string date;
-    };
-};
+#include "bar_repository.h"
+#include "feature_store.h"
 
-// Indicator class
+// Indicator class. Each (indicator, length) series comes from the feature store (see
+// feature_store.h), computed over the ticker's whole history or read back from the database, and
+// is looked up by this view's offset into it.
 class Indicators
 {
 public:
-    // Constructor that takes bar vector to perform calculations
-    Indicators(const std::vector<Data::Bar>& bars);
+    // Constructor that takes a view of the bars to perform calculations on
+    Indicators(const BarView& bars);
 
     double movingAverage(int length, size_t endIndex);
     double adr(int length, size_t endIndex);
     double avgVolume(int length, size_t endIndex);
 
+    // The series itself, indexed like the view's bars. Entries before length - 1 are computed
+    // from bars before the view; the accessors above return 0 for them instead.
+    const double* values(FeatureKind kind, int length);
+
 private:
-    std::vector<Data::Bar> bars_;
+    struct CachedSeries {
+        FeatureKind kind;
+        int length;
+        std::shared_ptr<const std::vector<double>> values;
+    };
+    double value(FeatureKind kind, int length, size_t endIndex);
+
+    BarView bars_;
+    std::vector<CachedSeries> series_;
 };
 
 // Order class and enums
@@ -88,17 +90,48 @@ struct TradeRecord {
     std::string ticker;
     std::string buyDate;
     std::string sellDate;
+    int buyDay;               // buyDate / sellDate as day numbers, see day_number.h
+    int sellDay;
     double buyPrice;
     double sellPrice;
     double quantity;
     std::string info;
 };
 
+// Memory held by trades: the records and the text their strings keep on the heap
+std::size_t tradeLogBytes(const std::vector<TradeRecord>& trades);
+
+// Parameters of the breakout strategy; the defaults are the ones Backtest::run has always traded.
+struct StrategyParams {
+    int maPeriod = 10;
+    int adrPeriod = 14;
+    int volumePeriod = 14;
+    double minAvgVolume = 50000000;  // entries need the average volume above this
+    int dollarRisk = 100;            // position size is dollarRisk / ADR shares
+    double entryAdrs = 2.0;          // buy stop at MA + entryAdrs * ADR
+    double stopAdrs = 1.0;           // exits, in ADRs from the fill price
+    double partialAdrs = 1.0;
+    double targetAdrs = 3.0;
+};
+
+// Every combination of the values in text such as "ma=10,20 risk=100,200"; parameters that are
+// not named keep their defaults. Keys: ma adr volperiod minvol risk entry stop partial target.
+// On failure returns false and describes the problem in error.
+bool parseStrategyGrid(const std::string& text, std::vector<StrategyParams>& variants, std::string& error);
+
+// params in the syntax parseStrategyGrid reads, every value exact, e.g. "ma=10 adr=14 ... target=3"
+std::string describeStrategy(const StrategyParams& params);
+
 // Backtest class to orchestrate the simulation
 class Backtest
 {
 public:
-    std::vector<TradeRecord> run(const std::vector<Data::Bar>& bars);
+    std::vector<TradeRecord> run(const BarView& bars, const StrategyParams& params = StrategyParams());
+
+    // Trades every variant over bars in a single pass: each bar is read once and then stepped
+    // for all variants, whose state is kept one array per field. Result k holds the trades of
+    // variants[k], the same ones run(bars, variants[k]) returns.
+    std::vector<std::vector<TradeRecord>> runBatch(const BarView& bars, const std::vector<StrategyParams>& variants);
 };
 
 #endif // BACKTEST_H
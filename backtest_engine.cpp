@@ -1,6 +1,16 @@
 #include "backtest_engine.h"
 #include "ui_backtest_engine.h"
 #include "backtest.h"
+#include "database.h"
+#include "bar_repository.h"
+#include "feature_store.h"
+#include "strategy_rules.h"
+#include "signal_backtest.h"
+#include "monte_carlo.h"
+#include "run_cache.h"
+#include "profiler.h"
+#include "memory_usage.h"
+#include "bar_stream.h"
 
 #include <QFile>
 #include <QTextStream>
@@ -9,8 +19,13 @@
 #include <QString>
 #include <QRegularExpression>
 #include <QPushButton>
+#include <QCheckBox>
+#include <QFileInfo>
 #include <sqlite3.h>
 #include <iostream>
+#include <algorithm>
+#include <chrono>
+#include <numeric>
 
 #include <QtCharts/QChartView>
 #include <QtCharts/QChart>
@@ -21,12 +36,12 @@
 #include <QHeaderView>
 #include <QVBoxLayout>
 #include <QDateTime>
+#include <QTime>
 
 
 backtest_engine::backtest_engine(QWidget *parent)
     : QWidget(parent)
     , ui(new Ui::backtest_engine)
-    , db(nullptr)
 {
     ui->setupUi(this);
 
@@ -47,12 +62,14 @@ backtest_engine::backtest_engine(QWidget *parent)
     }
 
 
+    // Starts checked when BTE_PROFILE is set in the environment
+    ui->profileRun->setChecked(Profiler::enabled());
+
     connect(ui->runBacktestButton, &QPushButton::clicked, this, &backtest_engine::runBacktestButton_Clicked);
 }
 
 backtest_engine::~backtest_engine()
 {
-    closeDatabase();  // Ensure database is closed if still open
     delete ui;
 }
 
@@ -77,76 +94,78 @@ QStringList backtest_engine::loadTickersFromCSV(const QString &filePath)
     return lines;
 }
 
-bool backtest_engine::openDatabase(const QString &dbPath)
-{
-    if (sqlite3_open(dbPath.toStdString().c_str(), &db) != SQLITE_OK) {
-        qWarning() << "Could not open database:" << dbPath;
-        db = nullptr;
-        return false;
-    }
-    return true;
-}
-
-void backtest_engine::closeDatabase()
-{
-    if (db) {
-        sqlite3_close(db);
-        db = nullptr;
+struct BarLoad {
+    std::unordered_map<std::string, BarView> bars;
+    std::size_t bytes = 0;        // histories the views keep alive
+};
+
+// Returns the most recent `bars` bars of each ticker as views into the shared bar repository, so
+// tickers the chart (or a previous run) already loaded are not read from SQLite again. Each view
+// keeps its ticker's whole history alive; runs with a memory budget stream instead (bar_stream.h).
+BarLoad loadAllData(DbConnection& db, const QStringList& tickers, int bars) {
+    BTE_PROFILE_SCOPE("loadAllData");
+    BarLoad load;
+    load.bars.reserve(tickers.size());
+    BarRepository& repository = BarRepository::instance();
+    for (const QString& ticker : tickers) {
+        std::string tickerStr = ticker.toUpper().toStdString();
+        BarView view = repository.get(db, tickerStr);
+        if (!view.empty()) {
+            load.bytes += view.series()->bytes();
+            load.bars.emplace(ticker.toStdString(), view.last(static_cast<std::size_t>(bars)));
+        }
     }
+    return load;
 }
 
-std::unordered_map<std::string, std::vector<Data::Bar>> loadAllData(sqlite3* db, int bars) {
-    std::unordered_map<std::string, std::vector<Data::Bar>> allData;
-    const char* querySQL = "SELECT open, high, low, close, volume, ticker, date FROM ("
-                           "  SELECT open, high, low, close, volume, ticker, date, "
-                           "         ROW_NUMBER() OVER (PARTITION BY ticker ORDER BY date(date) DESC) as rn "
-                           "  FROM Stocks"
-                           ") WHERE rn <= ? ORDER BY ticker, date;";
-    sqlite3_stmt* stmt = nullptr;
-    if (sqlite3_prepare_v2(db, querySQL, -1, &stmt, NULL) != SQLITE_OK) {
-        std::cerr << "Error preparing query: " << sqlite3_errmsg(db) << std::endl;
-        return allData;
+// Totals of every rule of grid over the most recent `bars` bars of each ticker, from the
+// signal-array path. With a memory budget the bars are streamed as in the run itself. Returns
+// false if the database could not be read.
+bool screenRuleGrid(const QStringList& tickers, int bars, std::size_t memoryBudget,
+                    const std::vector<SignalRule>& grid, std::vector<SignalStats>& totals) {
+    totals.assign(grid.size(), SignalStats());
+    if (memoryBudget == 0) {
+        std::vector<BarView> views;
+        MemoryCharge runBars(MemorySubsystem::RunBars);
+        {
+            DbLease db = Database::instance().reader();
+            if (!db) {
+                return false;
+            }
+            BarLoad load = loadAllData(*db, tickers, bars);
+            runBars.set(load.bytes);
+            views.reserve(load.bars.size());
+            for (auto& entry : load.bars) {
+                views.push_back(std::move(entry.second));
+            }
+        }
+        totals = screenSignalRules(views, grid);
+        return true;
     }
 
-    // Bind the max bars value to the first placeholder.
-    if (sqlite3_bind_int(stmt, 1, bars) != SQLITE_OK) {
-        std::cerr << "Error binding parameter: " << sqlite3_errmsg(db) << std::endl;
-        sqlite3_finalize(stmt);
-        return allData;
+    std::vector<std::string> symbols;
+    symbols.reserve(static_cast<std::size_t>(tickers.size()));
+    for (const QString& ticker : tickers) {
+        symbols.push_back(ticker.toUpper().toStdString());
     }
-
-    while (sqlite3_step(stmt) == SQLITE_ROW) {
-        Data::Bar bar;
-        bar.open = sqlite3_column_double(stmt, 0);
-        bar.high = sqlite3_column_double(stmt, 1);
-        bar.low = sqlite3_column_double(stmt, 2);
-        bar.close = sqlite3_column_double(stmt, 3);
-        bar.volume = sqlite3_column_int(stmt, 4);
-        const unsigned char* tickerText = sqlite3_column_text(stmt, 5);
-        const unsigned char* dateText = sqlite3_column_text(stmt, 6);
-        if (tickerText)
-            bar.ticker = reinterpret_cast<const char*>(tickerText);
-        if (dateText)
-            bar.date = reinterpret_cast<const char*>(dateText);
-
-        // Insert the bar into the map
-        allData[bar.ticker].push_back(bar);
+    BarStreamReader stream(symbols, static_cast<std::size_t>(bars), memoryBudget / 3);
+    BarChunk chunk;
+    std::size_t delivered = 0;
+    while (stream.next(chunk)) {
+        const std::vector<SignalStats> chunkTotals = screenSignalRules(chunk.bars, grid);
+        for (std::size_t r = 0; r < grid.size(); ++r) {
+            totals[r].merge(chunkTotals[r]);
+        }
+        delivered = chunk.first + chunk.bars.size();
+        FeatureStore::instance().flush();
     }
-    sqlite3_finalize(stmt);
-    return allData;
+    return delivered == symbols.size();
 }
 
 
 void backtest_engine::runBacktest()
 {
     QString tickerFilePath = "C:\\BTE\\build\\Desktop_Qt_6_8_2_MSVC2022_64bit-Debug\\universeSmall.csv";
-    QString dbPath = "C:\\BTE\\build\\Desktop_Qt_6_8_2_MSVC2022_64bit-Debug\\Universe_OHLCV.db";  // Adjust to your database path
-
-    // Open the database with error checking
-    if (!openDatabase(dbPath)) {
-        ui->backtestOutput->setPlainText("Failed to open database.");
-        return;
-    }
 
     int maxBars = ui->enterMaxBars->text().toInt();
     if (maxBars <= 0) {
@@ -155,54 +174,362 @@ void backtest_engine::runBacktest()
         maxBars = 100;
     }
 
-    auto allData = loadAllData(db, maxBars);
+    // Every combination of the entered parameter values is traded in one pass per ticker
+    std::vector<StrategyParams> variants;
+    std::string gridError;
+    if (!parseStrategyGrid(ui->enterVariants->text().toStdString(), variants, gridError)) {
+        ui->backtestOutput->setPlainText("Invalid variants: " + QString::fromStdString(gridError));
+        return;
+    }
+
+    // Rules written on the Rules tab replace the built-in strategy; they are compiled once here.
+    // With Screen checked the rules are instead the best variants of the Screen tab's grid, chosen
+    // once the tickers are known.
+    std::vector<RuleStrategy> rules;
+    std::vector<std::string> ruleTexts;     // what each of rules was compiled from
+    std::vector<SignalRule> ruleGrid;
+    const bool screen = ui->screenRules->isChecked();
+    const bool useRules = screen || !ui->enterRules->toPlainText().trimmed().isEmpty();
+    if (screen) {
+        std::string ruleGridError;
+        if (!parseSignalRuleGrid(ui->enterRuleGrid->toPlainText().toStdString(), ruleGrid, ruleGridError)) {
+            ui->backtestOutput->setPlainText("Invalid rule grid: " + QString::fromStdString(ruleGridError));
+            return;
+        }
+    } else if (useRules) {
+        ruleTexts.push_back(ui->enterRules->toPlainText().toStdString());
+        rules.resize(1);
+        std::string rulesError;
+        if (!compileRuleStrategy(ruleTexts.front(), rules.front(), rulesError)) {
+            ui->backtestOutput->setPlainText("Invalid rules: " + QString::fromStdString(rulesError));
+            return;
+        }
+    }
+
+    // Phases are timed only while "Profile run" is checked; the summary is limited to this run
+    Profiler::setEnabled(ui->profileRun->isChecked());
+    const std::int64_t runStart = Profiler::now();
+
+    // Memory is reported per subsystem for every run, peaks counted from here
+    MemoryUsage::instance().resetPeaks();
+    PeakRssMonitor rssMonitor;
+    const std::size_t memoryBudget = static_cast<std::size_t>(std::max(0LL, ui->enterMemoryBudget->text().toLongLong())) * 1024 * 1024;
+
     QStringList tickerList = loadTickersFromCSV(tickerFilePath);
 
-    // Initialize aggregate statistics
-    AggregateStats aggStats;
+    // Every rule of the grid is traded by the signal-array path, which only counts trades; the
+    // most profitable ones are then run in detail like rules from the Rules tab
+    std::vector<SignalStats> screenTotals;
+    double screenMs = 0.0;
+    if (screen) {
+        const auto screenStart = std::chrono::steady_clock::now();
+        if (!screenRuleGrid(tickerList, maxBars, memoryBudget, ruleGrid, screenTotals)) {
+            ui->backtestOutput->setPlainText("Failed to read the bars to screen the rule grid.");
+            return;
+        }
+        screenMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - screenStart).count();
+
+        const int top = ui->enterScreenTop->text().toInt();
+        std::vector<std::size_t> ranked(ruleGrid.size());
+        std::iota(ranked.begin(), ranked.end(), std::size_t(0));
+        std::stable_sort(ranked.begin(), ranked.end(), [&](std::size_t a, std::size_t b) {
+            return screenTotals[a].profit > screenTotals[b].profit;
+        });
+        ranked.resize(std::min(ranked.size(), static_cast<std::size_t>(top > 0 ? top : 5)));
+        for (std::size_t r : ranked) {
+            ruleTexts.push_back(describeSignalRule(ruleGrid[r]));
+            rules.emplace_back();
+            std::string rulesError;
+            if (!compileRuleStrategy(ruleTexts.back(), rules.back(), rulesError)) {
+                ui->backtestOutput->setPlainText("Invalid screened rule: " + QString::fromStdString(rulesError));
+                return;
+            }
+        }
+    }
+    if (useRules) {
+        variants.assign(rules.size(), StrategyParams());
+    }
+
+    // Results of earlier runs over the same bars and parameters are read back instead of traded
+    // again; only tickers missing some of them are loaded
+    RunCache runCache(maxBars);
+    std::vector<std::uint64_t> strategies;
+    if (useRules) {
+        for (const std::string& text : ruleTexts) {
+            strategies.push_back(strategyFingerprint("rules " + text));
+        }
+    } else {
+        for (const StrategyParams& params : variants) {
+            strategies.push_back(strategyFingerprint("breakout " + describeStrategy(params)));
+        }
+    }
+    struct TickerResults {
+        std::vector<std::vector<TradeRecord>> trades;    // one per variant
+        std::vector<char> found;                         // whether each came from the cache
+    };
+    // Filled by the lookups, emptied as soon as the ticker is folded into the totals
+    std::vector<TickerResults> results(static_cast<std::size_t>(tickerList.size()));
+
+    // Initialize aggregate statistics, one per variant
+    std::vector<AggregateStats> variantStats(variants.size());
 
-    // Container for all trades to be displayed in the chart and table
+    // Container for all trades of the first variant, to be displayed in the chart and table
     std::vector<TradeRecord> allTrades;
+    int reusedTickers = 0;
+
+    // Trades ticker i over bars (null if it was not loaded) in every variant without a stored
+    // result, then adds its trades to stats
+    auto processTicker = [&](std::size_t i, const BarView* bars, std::vector<AggregateStats>& stats) {
+        TickerResults& tickerResults = results[i];
+        std::vector<std::size_t> missing;
+        for (std::size_t k = 0; k < variants.size(); ++k) {
+            if (!tickerResults.found[k]) {
+                missing.push_back(k);
+            }
+        }
 
-    // Process each ticker
-    for (const QString &ticker : tickerList) {
-        std::string tickerStr = ticker.toStdString();
-        auto it = allData.find(tickerStr);
-
-        if (it != allData.end()) {
-            Backtest backtest;
-            std::vector<TradeRecord> trades = backtest.run(it->second);
-
-            allTrades.insert(allTrades.end(), trades.begin(), trades.end());
-
-            // Update aggregate statistics from each ticker's trades
-            for (const auto& trade : trades) {
-                aggStats.totalTrades++;
-                double profit = (trade.sellPrice - trade.buyPrice) * trade.quantity;
-                aggStats.totalProfit += profit;
-                if (profit > 0) {
-                    aggStats.wins++;
-                } else {
-                    aggStats.losses++;
+        if (missing.empty()) {
+            reusedTickers++;
+        } else {
+            if (!bars || bars->empty()) {
+                qWarning() << "No data found for ticker:" << tickerList[static_cast<int>(i)];
+                tickerResults = TickerResults();
+                return;
+            }
+            // Only the variants without a current stored result are traded
+            std::vector<std::vector<TradeRecord>> computed;
+            if (useRules) {
+                computed.resize(missing.size());
+                for (std::size_t m = 0; m < missing.size(); ++m) {
+                    runRuleStrategy(*bars, rules[missing[m]], &computed[m]);
+                }
+            } else {
+                std::vector<StrategyParams> missingVariants;
+                for (std::size_t k : missing) {
+                    missingVariants.push_back(variants[k]);
                 }
+                Backtest backtest;
+                computed = backtest.runBatch(*bars, missingVariants);
             }
-        } else {
-            qWarning() << "No data found for ticker:" << ticker;
+            for (std::size_t m = 0; m < missing.size(); ++m) {
+                const std::size_t k = missing[m];
+                tickerResults.trades[k] = std::move(computed[m]);
+                runCache.add(*bars, strategies[k], tickerResults.trades[k]);
+            }
+        }
+        const std::vector<std::vector<TradeRecord>>& variantTrades = tickerResults.trades;
+
+        allTrades.insert(allTrades.end(), variantTrades.front().begin(), variantTrades.front().end());
+
+        // Update aggregate statistics from each ticker's trades
+        for (std::size_t k = 0; k < variants.size(); ++k) {
+            for (const auto& trade : variantTrades[k]) {
+                stats[k].add(trade);
+            }
+        }
+        tickerResults = TickerResults();
+    };
+
+    std::size_t storedFeatures = 0;
+    std::size_t storedResults = 0;
+    const bool streamed = memoryBudget > 0;
+    std::size_t streamChunks = 0;
+    if (!streamed) {
+        // Reads go through a pooled WAL connection, so a running price update does not block the run.
+        std::unordered_map<std::string, BarView> allData;
+        MemoryCharge runBars(MemorySubsystem::RunBars);
+        {
+            DbLease db = Database::instance().reader();
+            if (!db) {
+                ui->backtestOutput->setPlainText("Failed to open database.");
+                return;
+            }
+            QStringList toLoad;
+            for (int i = 0; i < tickerList.size(); ++i) {
+                TickerResults& stored = results[static_cast<std::size_t>(i)];
+                if (!runCache.lookup(*db, tickerList[i].toUpper().toStdString(), strategies, stored.trades, stored.found)) {
+                    toLoad << tickerList[i];
+                }
+            }
+            BarLoad load = loadAllData(*db, toLoad, maxBars);
+            allData = std::move(load.bars);
+            runBars.set(load.bytes);
+        }
+
+        // Process each ticker
+        for (int i = 0; i < tickerList.size(); ++i) {
+            auto it = allData.find(tickerList[i].toStdString());
+            processTicker(static_cast<std::size_t>(i), it == allData.end() ? nullptr : &it->second, variantStats);
+        }
+    } else {
+        // With a memory budget the bars are streamed: the next chunk of tickers is read (and
+        // looked up in the run cache) on a background thread while the current one is traded,
+        // folded into the totals and dropped. A third of the budget per chunk keeps the one being
+        // traded, the one waiting and the one being read within it.
+        std::vector<std::string> symbols;
+        symbols.reserve(static_cast<std::size_t>(tickerList.size()));
+        for (const QString& ticker : tickerList) {
+            symbols.push_back(ticker.toUpper().toStdString());
+        }
+        BarStreamReader stream(symbols, static_cast<std::size_t>(maxBars), memoryBudget / 3, 1,
+                               [&](DbConnection& db, std::size_t i) {
+                                   TickerResults& stored = results[i];
+                                   return !runCache.lookup(db, symbols[i], strategies, stored.trades, stored.found);
+                               });
+        BarChunk chunk;
+        std::size_t delivered = 0;
+        while (stream.next(chunk)) {
+            std::vector<AggregateStats> chunkStats(variants.size());
+            for (std::size_t j = 0; j < chunk.bars.size(); ++j) {
+                processTicker(chunk.first + j, &chunk.bars[j], chunkStats);
+            }
+            for (std::size_t k = 0; k < variants.size(); ++k) {
+                variantStats[k].merge(chunkStats[k]);
+            }
+            delivered = chunk.first + chunk.bars.size();
+            // Pending rows keep the chunk's results and indicator series alive, so they are
+            // written per chunk rather than at the end
+            storedFeatures += FeatureStore::instance().flush();
+            storedResults += runCache.flush();
+        }
+        streamChunks = stream.chunksRead();
+        if (delivered < symbols.size()) {
+            ui->backtestOutput->setPlainText(QString("Failed to read the bars of %1 of %2 tickers.")
+                                                 .arg(symbols.size() - delivered)
+                                                 .arg(symbols.size()));
+            return;
         }
     }
 
+    MemoryCharge tradeLog(MemorySubsystem::TradeLog, tradeLogBytes(allTrades));
+
+    // Indicator series computed or extended by this run are kept for the next one
+    storedFeatures += FeatureStore::instance().flush();
+    if (storedFeatures > 0) {
+        std::cout << "Stored " << storedFeatures << " indicator series" << std::endl;
+    }
+    storedResults += runCache.flush();
+    if (storedResults > 0) {
+        std::cout << "Stored " << storedResults << " ticker results" << std::endl;
+    }
+
     populateProfitLossChart(allTrades);
     populateTradeDetailsTable(allTrades);
 
     // Format the aggregate stats into a QString to output to the UI element
+    const AggregateStats& aggStats = variantStats.front();
     QString resultText = QString("Backtesting completed: \n\nTotal Trades: %1\nTotal Profit: $%2\nWins: %3\nLosses: %4")
                              .arg(aggStats.totalTrades)
                              .arg(aggStats.totalProfit)
                              .arg(aggStats.wins)
                              .arg(aggStats.losses);
+    if (useRules) {
+        resultText += QString("\n\nStrategy: rules (%1 indicator series)").arg(rules.front().columns.size());
+    }
+    if (screen) {
+        resultText += QString("\n\nScreened %1 rule variants over %2 tickers in %3 ms; the %4 most profitable were run in detail")
+                          .arg(ruleGrid.size())
+                          .arg(tickerList.size())
+                          .arg(screenMs, 0, 'f', 0)
+                          .arg(rules.size());
+    }
+    if (streamed) {
+        resultText += QString("\n\nStreamed %1 tickers in %2 chunks to stay within the memory budget")
+                          .arg(tickerList.size())
+                          .arg(streamChunks);
+    }
+    if (reusedTickers > 0) {
+        resultText += QString("\n\nReused stored results of %1 of %2 tickers").arg(reusedTickers).arg(tickerList.size());
+    }
+    if (variants.size() > 1 || screen) {
+        resultText += "\n\nVariants (chart and table show the first):\n";
+        for (std::size_t k = 0; k < variants.size(); ++k) {
+            const StrategyParams& params = variants[k];
+            const AggregateStats& stats = variantStats[k];
+            const QString variant = useRules
+                ? QString("%1. %2: ").arg(k + 1).arg(QString::fromStdString(ruleTexts[k]))
+                : QString("%1. ma=%2 adr=%3 volperiod=%4 minvol=%5 risk=%6 entry=%7 stop=%8 partial=%9 target=%10: ")
+                      .arg(k + 1)
+                      .arg(params.maPeriod)
+                      .arg(params.adrPeriod)
+                      .arg(params.volumePeriod)
+                      .arg(params.minAvgVolume)
+                      .arg(params.dollarRisk)
+                      .arg(params.entryAdrs)
+                      .arg(params.stopAdrs)
+                      .arg(params.partialAdrs)
+                      .arg(params.targetAdrs);
+            resultText += variant
+                          + QString("%1 trades, $%2, %3 wins, %4 losses\n")
+                                .arg(stats.totalTrades)
+                                .arg(stats.totalProfit)
+                                .arg(stats.wins)
+                                .arg(stats.losses);
+        }
+    }
+
+    // Resampled outcomes of the first variant's trades, to show how much of the result is luck
+    const int monteCarloIterations = ui->enterMonteCarlo->text().toInt();
+    if (monteCarloIterations > 0 && !allTrades.empty()) {
+        const std::vector<double> profits = tradeProfits(allTrades);
+        const TradePath actual = measurePath(profits.data(), profits.size());
+        resultText += QString("\n\nMonte Carlo, %1 iterations over %2 trades (actual: $%3 profit, $%4 max drawdown, %5 losing streak)\n"
+                              "5th percentile / median / 95th percentile:\n")
+                          .arg(monteCarloIterations)
+                          .arg(profits.size())
+                          .arg(actual.finalProfit, 0, 'f', 2)
+                          .arg(actual.maxDrawdown, 0, 'f', 2)
+                          .arg(actual.losingStreak);
+        struct Method { ResampleMethod method; const char* name; };
+        const Method methods[] = {
+            {ResampleMethod::Shuffle, "Shuffled order"},
+            {ResampleMethod::Bootstrap, "Bootstrap"},
+            {ResampleMethod::SkipTrades, "10% of trades skipped"},
+        };
+        for (const Method& method : methods) {
+            MonteCarloOptions options;
+            options.method = method.method;
+            options.iterations = monteCarloIterations;
+            const MonteCarloResult mc = runMonteCarlo(profits, options);
+            resultText += QString("%1: profit $%2 / $%3 / $%4, max drawdown $%5 / $%6 / $%7, losing streak %8 / %9 / %10, %11% end in a loss\n")
+                              .arg(method.name)
+                              .arg(mc.finalProfit.p5, 0, 'f', 2)
+                              .arg(mc.finalProfit.median, 0, 'f', 2)
+                              .arg(mc.finalProfit.p95, 0, 'f', 2)
+                              .arg(mc.maxDrawdown.p5, 0, 'f', 2)
+                              .arg(mc.maxDrawdown.median, 0, 'f', 2)
+                              .arg(mc.maxDrawdown.p95, 0, 'f', 2)
+                              .arg(mc.losingStreak.p5)
+                              .arg(mc.losingStreak.median)
+                              .arg(mc.losingStreak.p95)
+                              .arg(mc.lossProbability * 100.0, 0, 'f', 1);
+        }
+    }
+    const std::size_t runPeakRss = rssMonitor.stop();
+    resultText += QString("\n\nMemory (peak RSS of this run %1, now %2%3):\n")
+                      .arg(QString::fromStdString(formatBytes(static_cast<double>(runPeakRss))))
+                      .arg(QString::fromStdString(formatBytes(static_cast<double>(currentRss()))))
+                      .arg(memoryBudget > 0 ? QString(", budget %1").arg(QString::fromStdString(formatBytes(static_cast<double>(memoryBudget))))
+                                            : QString())
+                  + QString::fromStdString(MemoryUsage::instance().report());
+    if (Profiler::enabled()) {
+        const double runMs = (Profiler::now() - runStart) / 1e6;
+        resultText += QString("\n\nProfile (%1 ms):\n").arg(runMs, 0, 'f', 1)
+                      + QString::fromStdString(Profiler::instance().summaryText(runStart));
+        const QString tracePath = QFileInfo("bte_trace.json").absoluteFilePath();
+        if (Profiler::instance().writeChromeTrace(tracePath.toStdString())) {
+            resultText += "Trace written to " + tracePath + "\n";
+        } else {
+            qWarning() << "Failed to write profile trace to" << tracePath;
+        }
+    }
     ui->backtestOutput->setPlainText(resultText);
 
-    closeDatabase();  // Close DB connection after processing
+    QString runName = QString("Run %1 (%2 trades, %3)")
+                          .arg(++m_runCount)
+                          .arg(aggStats.totalTrades)
+                          .arg(QTime::currentTime().toString("HH:mm:ss"));
+    emit runCompleted(runName, std::make_shared<const TradeMarkerIndex>(allTrades));
 }
 
 void backtest_engine::runBacktestButton_Clicked()
@@ -212,6 +539,7 @@ void backtest_engine::runBacktestButton_Clicked()
 
 void backtest_engine::populateProfitLossChart(const std::vector<TradeRecord>& trades)
 {
+    BTE_PROFILE_SCOPE("populateProfitLossChart");
     // Create a new line series for cumulative profit/loss
     QLineSeries *series = new QLineSeries();
     double cumulativeProfit = 0.0;
@@ -262,6 +590,7 @@ void backtest_engine::populateProfitLossChart(const std::vector<TradeRecord>& tr
 // --------------------------------------------------------------------
 void backtest_engine::populateTradeDetailsTable(const std::vector<TradeRecord>& trades)
 {
+    BTE_PROFILE_SCOPE("populateTradeDetailsTable");
     tradeDetailsTable->setRowCount(static_cast<int>(trades.size()));
     int row = 0;
     for (const auto &trade : trades) {
@@ -3,8 +3,9 @@
 
 #include <QWidget>
 #include <QStringList>
-#include <sqlite3.h>
+#include <memory>
 #include "backtest.h"
+#include "trade_markers.h"
 
 
 // For Charts
@@ -27,16 +28,15 @@ public:
     explicit backtest_engine(QWidget *parent = nullptr);
     ~backtest_engine();
 
+signals:
+    // Emitted after every run so the charting page can plot its trades.
+    void runCompleted(const QString &name, std::shared_ptr<const TradeMarkerIndex> run);
+
 private slots:
     void runBacktestButton_Clicked();
 
 private:
     Ui::backtest_engine *ui;
-    sqlite3* db; // Database connection
-
-    // Database connection helpers
-    bool openDatabase(const QString &dbPath);
-    void closeDatabase();
 
     // Backtesting methods
     void runBacktest();
@@ -48,6 +48,7 @@ private:
     // New UI components
     QChartView *profitChartView;
     QTableWidget *tradeDetailsTable;
+    int m_runCount = 0;
 
 
     struct AggregateStats {
@@ -55,6 +56,25 @@ private:
         double totalProfit = 0.0;
         int wins = 0;
         int losses = 0;
+
+        void add(const TradeRecord& trade) {
+            totalTrades++;
+            double profit = (trade.sellPrice - trade.buyPrice) * trade.quantity;
+            totalProfit += profit;
+            if (profit > 0) {
+                wins++;
+            } else {
+                losses++;
+            }
+        }
+
+        // Totals of a streamed chunk folded into the run's
+        void merge(const AggregateStats& other) {
+            totalTrades += other.totalTrades;
+            totalProfit += other.totalProfit;
+            wins += other.wins;
+            losses += other.losses;
+        }
     };
 };
 
@@ -0,0 +1,82 @@
+#include "bar_lod.h"
+
+#include <algorithm>
+
+namespace {
+
+// Merges neighbouring pairs of source; a trailing odd bar becomes a bucket of its own.
+std::shared_ptr<BarSeries> mergePairs(const BarView& source)
+{
+    auto merged = std::make_shared<BarSeries>();
+    merged->ticker = source.ticker();
+    const std::size_t count = (source.size() + 1) / 2;
+    merged->day.resize(count);
+    merged->open.resize(count);
+    merged->high.resize(count);
+    merged->low.resize(count);
+    merged->close.resize(count);
+    merged->volume.resize(count);
+
+    const int* day = source.day();
+    const double* open = source.open();
+    const double* high = source.high();
+    const double* low = source.low();
+    const double* close = source.close();
+    const double* volume = source.volume();
+
+    const std::size_t pairs = source.size() / 2;
+    for (std::size_t j = 0; j < pairs; ++j) {
+        const std::size_t a = 2 * j;
+        const std::size_t b = a + 1;
+        merged->day[j] = day[a];
+        merged->open[j] = open[a];
+        merged->high[j] = std::max(high[a], high[b]);
+        merged->low[j] = std::min(low[a], low[b]);
+        merged->close[j] = close[b];
+        merged->volume[j] = volume[a] + volume[b];
+    }
+    if (count > pairs) {
+        const std::size_t a = source.size() - 1;
+        merged->day[pairs] = day[a];
+        merged->open[pairs] = open[a];
+        merged->high[pairs] = high[a];
+        merged->low[pairs] = low[a];
+        merged->close[pairs] = close[a];
+        merged->volume[pairs] = volume[a];
+    }
+    return merged;
+}
+
+} // namespace
+
+BarPyramid::BarPyramid(const BarView& bars)
+{
+    if (bars.empty()) {
+        return;
+    }
+    levels_.push_back(bars);
+    // Stop once a level is small enough to draw without further merging
+    while (levels_.back().size() > 64) {
+        levels_.push_back(BarView(mergePairs(levels_.back())));
+    }
+}
+
+std::size_t BarPyramid::bytes() const
+{
+    std::size_t total = 0;
+    for (std::size_t k = 1; k < levels_.size(); ++k) {
+        total += levels_[k].series()->bytes();
+    }
+    return total;
+}
+
+int BarPyramid::levelFor(double pixelsPerBar, double minPixels) const
+{
+    int k = 0;
+    double bucketPixels = pixelsPerBar;
+    while (k + 1 < levelCount() && bucketPixels < minPixels) {
+        bucketPixels *= 2.0;
+        ++k;
+    }
+    return k;
+}
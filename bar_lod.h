@@ -0,0 +1,33 @@
+#ifndef BAR_LOD_H
+#define BAR_LOD_H
+
+#include <cstddef>
+#include <memory>
+#include <vector>
+
+#include "bar_repository.h"
+
+// Level-of-detail pyramid over one BarView. Level 0 is the view itself; level k merges 2^k
+// consecutive bars (first open, max high, min low, last close, summed volume, first day).
+// Buckets are aligned to index 0 of the view, so bar i of level 0 falls in bucket i >> k.
+class BarPyramid
+{
+public:
+    BarPyramid() = default;
+    explicit BarPyramid(const BarView& bars);
+
+    int levelCount() const { return static_cast<int>(levels_.size()); }
+    const BarView& level(int k) const { return levels_[static_cast<std::size_t>(k)]; }
+
+    // Finest level whose buckets are at least minPixels wide when a single level-0 bar is
+    // pixelsPerBar wide, or the coarsest level if none is.
+    int levelFor(double pixelsPerBar, double minPixels = 3.0) const;
+
+    // Memory of the merged levels; level 0 belongs to the view it was built from
+    std::size_t bytes() const;
+
+private:
+    std::vector<BarView> levels_;
+};
+
+#endif // BAR_LOD_H
@@ -0,0 +1,277 @@
+#include "bar_repository.h"
+#include "database.h"
+#include "memory_usage.h"
+#include "profiler.h"
+
+#include <algorithm>
+
+// ------------------------
+// BarSeries / BarView
+// ------------------------
+
+std::size_t BarSeries::bytes() const
+{
+    return sizeof(BarSeries) + ticker.capacity()
+           + day.capacity() * sizeof(int)
+           + (open.capacity() + high.capacity() + low.capacity() + close.capacity() + volume.capacity()) * sizeof(double);
+}
+
+void BarSeries::reserve(std::size_t count)
+{
+    day.reserve(count);
+    open.reserve(count);
+    high.reserve(count);
+    low.reserve(count);
+    close.reserve(count);
+    volume.reserve(count);
+}
+
+BarView::BarView(std::shared_ptr<const BarSeries> series, std::size_t first, std::size_t count)
+    : series_(std::move(series)), first_(first), count_(count)
+{
+    if (!series_) {
+        first_ = count_ = 0;
+    }
+}
+
+BarView::BarView(std::shared_ptr<const BarSeries> series)
+    : series_(std::move(series)), first_(0), count_(series_ ? series_->size() : 0)
+{
+}
+
+const std::string& BarView::ticker() const
+{
+    static const std::string empty;
+    return series_ ? series_->ticker : empty;
+}
+
+BarView BarView::last(std::size_t count) const
+{
+    std::size_t n = std::min(count, count_);
+    return BarView(series_, first_ + count_ - n, n);
+}
+
+BarView BarView::slice(std::size_t first, std::size_t count) const
+{
+    first = std::min(first, count_);
+    return BarView(series_, first_ + first, std::min(count, count_ - first));
+}
+
+// ------------------------
+// BarRepository
+// ------------------------
+
+BarRepository& BarRepository::instance()
+{
+    static BarRepository repository;
+    return repository;
+}
+
+std::shared_ptr<BarSeries> BarRepository::loadSeries(DbConnection& db, const std::string& ticker)
+{
+    BTE_PROFILE_SCOPE("BarRepository::loadSeries");
+    auto series = std::make_shared<BarSeries>();
+    series->ticker = ticker;
+
+    const char* querySQL =
+        "SELECT b.day, b.open, b.high, b.low, b.close, b.volume, t.version "
+        "FROM Bars b JOIN Tickers t ON t.id = b.ticker_id "
+        "WHERE t.symbol = ? ORDER BY b.day;";
+    CachedStatement query = db.prepare("bars.series", querySQL);
+    if (!query) {
+        return series;
+    }
+    sqlite3_stmt* stmt = query.get();
+    sqlite3_bind_text(stmt, 1, ticker.c_str(), -1, SQLITE_TRANSIENT);
+
+    series->reserve(2048);
+    while (sqlite3_step(stmt) == SQLITE_ROW) {
+        series->day.push_back(sqlite3_column_int(stmt, 0));
+        series->open.push_back(sqlite3_column_double(stmt, 1));
+        series->high.push_back(sqlite3_column_double(stmt, 2));
+        series->low.push_back(sqlite3_column_double(stmt, 3));
+        series->close.push_back(sqlite3_column_double(stmt, 4));
+        series->volume.push_back(sqlite3_column_double(stmt, 5));
+        // Read by the same statement, so it describes exactly these bars
+        series->version = sqlite3_column_int64(stmt, 6);
+    }
+    BTE_PROFILE_COUNT("bars loaded", series->size());
+    // Cached series are charged against the budget by capacity
+    series->day.shrink_to_fit();
+    series->open.shrink_to_fit();
+    series->high.shrink_to_fit();
+    series->low.shrink_to_fit();
+    series->close.shrink_to_fit();
+    series->volume.shrink_to_fit();
+    return series;
+}
+
+std::shared_ptr<BarSeries> BarRepository::loadPage(DbConnection& db, const std::string& ticker, int boundaryDay,
+                                                   std::size_t count, bool older)
+{
+    BTE_PROFILE_SCOPE("BarRepository::loadPage");
+    auto series = std::make_shared<BarSeries>();
+    series->ticker = ticker;
+
+    const char* beforeSQL =
+        "SELECT day, open, high, low, close, volume FROM Bars "
+        "WHERE ticker_id = (SELECT id FROM Tickers WHERE symbol = ?) AND day < ? "
+        "ORDER BY day DESC LIMIT ?;";
+    const char* afterSQL =
+        "SELECT day, open, high, low, close, volume FROM Bars "
+        "WHERE ticker_id = (SELECT id FROM Tickers WHERE symbol = ?) AND day > ? "
+        "ORDER BY day LIMIT ?;";
+    CachedStatement query = older ? db.prepare("bars.pageBefore", beforeSQL)
+                                  : db.prepare("bars.pageAfter", afterSQL);
+    if (!query) {
+        return series;
+    }
+    sqlite3_stmt* stmt = query.get();
+    sqlite3_bind_text(stmt, 1, ticker.c_str(), -1, SQLITE_TRANSIENT);
+    sqlite3_bind_int(stmt, 2, boundaryDay);
+    sqlite3_bind_int64(stmt, 3, static_cast<sqlite3_int64>(count));
+
+    series->reserve(count);
+    while (sqlite3_step(stmt) == SQLITE_ROW) {
+        series->day.push_back(sqlite3_column_int(stmt, 0));
+        series->open.push_back(sqlite3_column_double(stmt, 1));
+        series->high.push_back(sqlite3_column_double(stmt, 2));
+        series->low.push_back(sqlite3_column_double(stmt, 3));
+        series->close.push_back(sqlite3_column_double(stmt, 4));
+        series->volume.push_back(sqlite3_column_double(stmt, 5));
+    }
+    if (older) {
+        // Walked the index backwards; put the page in chronological order
+        std::reverse(series->day.begin(), series->day.end());
+        std::reverse(series->open.begin(), series->open.end());
+        std::reverse(series->high.begin(), series->high.end());
+        std::reverse(series->low.begin(), series->low.end());
+        std::reverse(series->close.begin(), series->close.end());
+        std::reverse(series->volume.begin(), series->volume.end());
+    }
+    return series;
+}
+
+BarView BarRepository::peek(const std::string& ticker)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = entries_.find(ticker);
+    if (it == entries_.end()) {
+        return BarView();
+    }
+    lru_.splice(lru_.begin(), lru_, it->second.lruPosition);
+    return BarView(it->second.series);
+}
+
+BarView BarRepository::get(const std::string& ticker)
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto it = entries_.find(ticker);
+        if (it != entries_.end()) {
+            lru_.splice(lru_.begin(), lru_, it->second.lruPosition);
+            return BarView(it->second.series);
+        }
+    }
+
+    DbLease db = Database::instance().reader();
+    if (!db) {
+        return BarView();
+    }
+    return get(*db, ticker);
+}
+
+BarView BarRepository::get(DbConnection& db, const std::string& ticker)
+{
+    std::uint64_t generation;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto it = entries_.find(ticker);
+        if (it != entries_.end()) {
+            lru_.splice(lru_.begin(), lru_, it->second.lruPosition);
+            return BarView(it->second.series);
+        }
+        generation = generation_;
+    }
+
+    // Load without holding the lock so other tickers can be served meanwhile.
+    std::shared_ptr<const BarSeries> series = loadSeries(db, ticker);
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = entries_.find(ticker);
+    if (it != entries_.end()) {
+        // Another thread loaded it first
+        lru_.splice(lru_.begin(), lru_, it->second.lruPosition);
+        return BarView(it->second.series);
+    }
+    // Only publish if no write invalidated the cache while this load was running.
+    if (generation == generation_ && !series->day.empty()) {
+        lru_.push_front(ticker);
+        entries_.emplace(ticker, Entry{series, lru_.begin()});
+        bytes_ += series->bytes();
+        MemoryUsage::instance().add(MemorySubsystem::BarCache, static_cast<std::int64_t>(series->bytes()));
+        evictLocked();
+    }
+    return BarView(series);
+}
+
+void BarRepository::invalidate(const std::string& ticker)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    generation_++;
+    auto it = entries_.find(ticker);
+    if (it == entries_.end()) {
+        return;
+    }
+    bytes_ -= it->second.series->bytes();
+    MemoryUsage::instance().add(MemorySubsystem::BarCache, -static_cast<std::int64_t>(it->second.series->bytes()));
+    lru_.erase(it->second.lruPosition);
+    entries_.erase(it);
+}
+
+void BarRepository::invalidateAll()
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    generation_++;
+    entries_.clear();
+    lru_.clear();
+    MemoryUsage::instance().add(MemorySubsystem::BarCache, -static_cast<std::int64_t>(bytes_));
+    bytes_ = 0;
+}
+
+void BarRepository::setMemoryBudget(std::size_t bytes)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    budget_ = bytes;
+    evictLocked();
+}
+
+std::size_t BarRepository::memoryBudget() const
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    return budget_;
+}
+
+std::size_t BarRepository::bytesCached() const
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    return bytes_;
+}
+
+std::uint64_t BarRepository::generation() const
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    return generation_;
+}
+
+// Views handed out earlier keep evicted series alive until they are dropped.
+void BarRepository::evictLocked()
+{
+    while (bytes_ > budget_ && lru_.size() > 1) {
+        auto it = entries_.find(lru_.back());
+        bytes_ -= it->second.series->bytes();
+        MemoryUsage::instance().add(MemorySubsystem::BarCache, -static_cast<std::int64_t>(it->second.series->bytes()));
+        entries_.erase(it);
+        lru_.pop_back();
+    }
+}
@@ -0,0 +1,118 @@
+#ifndef BAR_REPOSITORY_H
+#define BAR_REPOSITORY_H
+
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+class DbConnection;
+
+// Complete daily history of one ticker in columnar form, oldest bar first.
+// Instances are immutable once published by BarRepository.
+struct BarSeries {
+    std::string ticker;
+    std::vector<int> day;          // days since 1970-01-01, see day_number.h
+    std::vector<double> open;
+    std::vector<double> high;
+    std::vector<double> low;
+    std::vector<double> close;
+    std::vector<double> volume;
+    // Tickers.version of a full history read by BarRepository::loadSeries; -1 for pages and
+    // other partial series, which feature_store.h never persists
+    std::int64_t version = -1;
+
+    std::size_t size() const { return day.size(); }
+    std::size_t bytes() const;
+    void reserve(std::size_t count);
+};
+
+// Read-only window into a shared BarSeries. Copies are cheap and keep the series alive.
+class BarView
+{
+public:
+    BarView() = default;
+    BarView(std::shared_ptr<const BarSeries> series, std::size_t first, std::size_t count);
+    explicit BarView(std::shared_ptr<const BarSeries> series);
+
+    std::size_t size() const { return count_; }
+    bool empty() const { return count_ == 0; }
+    const std::string& ticker() const;
+
+    const int* day() const { return series_->day.data() + first_; }
+    const double* open() const { return series_->open.data() + first_; }
+    const double* high() const { return series_->high.data() + first_; }
+    const double* low() const { return series_->low.data() + first_; }
+    const double* close() const { return series_->close.data() + first_; }
+    const double* volume() const { return series_->volume.data() + first_; }
+
+    // The most recent count bars of this view (or all of them if there are fewer).
+    BarView last(std::size_t count) const;
+    BarView slice(std::size_t first, std::size_t count) const;
+
+    const std::shared_ptr<const BarSeries>& series() const { return series_; }
+    // Offset of this view's first bar inside series().
+    std::size_t offset() const { return first_; }
+
+private:
+    std::shared_ptr<const BarSeries> series_;
+    std::size_t first_ = 0;
+    std::size_t count_ = 0;
+};
+
+// Process-wide cache of per-ticker histories shared by the chart, backtester and query tools.
+// Each ticker is loaded once from the Bars table and kept until it is evicted by the LRU memory
+// budget or invalidated by an ingestion write.
+class BarRepository
+{
+public:
+    static BarRepository& instance();
+
+    // Full history of ticker (upper-case symbol). Loads through a pooled reader on a miss.
+    // Returns an empty view if the ticker has no bars.
+    BarView get(const std::string& ticker);
+    // Same, using a connection the caller already holds.
+    BarView get(DbConnection& db, const std::string& ticker);
+
+    void invalidate(const std::string& ticker);
+    void invalidateAll();
+
+    void setMemoryBudget(std::size_t bytes);
+    std::size_t memoryBudget() const;
+    std::size_t bytesCached() const;
+    // Changes whenever bars are invalidated, so a copy taken from them can tell it may be stale
+    std::uint64_t generation() const;
+
+    // Cached history of ticker, or an empty view if it is not resident. Never touches the database.
+    BarView peek(const std::string& ticker);
+
+    // Reads ticker's bars straight from the database without caching them.
+    static std::shared_ptr<BarSeries> loadSeries(DbConnection& db, const std::string& ticker);
+    // Up to count bars adjacent to boundaryDay, oldest first: the newest bars before it when older
+    // is set, otherwise the oldest bars after it. Served by the (ticker_id, day) primary key.
+    static std::shared_ptr<BarSeries> loadPage(DbConnection& db, const std::string& ticker, int boundaryDay,
+                                               std::size_t count, bool older);
+
+private:
+    BarRepository() = default;
+
+    struct Entry {
+        std::shared_ptr<const BarSeries> series;
+        std::list<std::string>::iterator lruPosition;
+    };
+
+    void evictLocked();
+
+    mutable std::mutex mutex_;
+    std::unordered_map<std::string, Entry> entries_;
+    std::list<std::string> lru_;            // most recently used first
+    std::size_t bytes_ = 0;
+    std::size_t budget_ = 512ull * 1024 * 1024;
+    std::uint64_t generation_ = 0;          // bumped by every invalidation
+};
+
+#endif // BAR_REPOSITORY_H
@@ -0,0 +1,98 @@
+#include "bar_stream.h"
+#include "database.h"
+#include "profiler.h"
+
+#include <algorithm>
+
+BarStreamReader::BarStreamReader(std::vector<std::string> tickers, std::size_t bars, std::size_t chunkBytes,
+                                 std::size_t prefetch, Filter filter)
+    : tickers_(std::move(tickers))
+    , bars_(bars)
+    , chunkBytes_(std::max<std::size_t>(chunkBytes, 1))
+    , prefetch_(std::max<std::size_t>(prefetch, 1))
+    , filter_(std::move(filter))
+{
+    thread_ = std::thread(&BarStreamReader::run, this);
+}
+
+BarStreamReader::~BarStreamReader()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stopping_ = true;
+    }
+    changed_.notify_all();
+    thread_.join();
+}
+
+bool BarStreamReader::next(BarChunk& chunk)
+{
+    // The previous chunk's bars are released before waiting, so they never overlap the next two
+    chunk = BarChunk();
+    std::unique_lock<std::mutex> lock(mutex_);
+    changed_.wait(lock, [this]() { return !ready_.empty() || finished_; });
+    if (ready_.empty()) {
+        return false;
+    }
+    chunk = std::move(ready_.front());
+    ready_.pop_front();
+    changed_.notify_all();
+    return true;
+}
+
+std::size_t BarStreamReader::chunksRead() const
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    return chunks_;
+}
+
+void BarStreamReader::run()
+{
+    BarRepository& repository = BarRepository::instance();
+    std::size_t index = 0;
+    while (index < tickers_.size()) {
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            changed_.wait(lock, [this]() { return ready_.size() < prefetch_ || stopping_; });
+            if (stopping_) {
+                break;
+            }
+        }
+
+        BarChunk chunk;
+        chunk.first = index;
+        {
+            BTE_PROFILE_SCOPE("BarStreamReader::chunk");
+            // One lease per chunk, so the pool is not held while waiting on the consumer
+            DbLease db = Database::instance().reader();
+            if (!db) {
+                break;
+            }
+            while (index < tickers_.size() && (chunk.bars.empty() || chunk.bytes < chunkBytes_)) {
+                BarView view;
+                if (!filter_ || filter_(*db, index)) {
+                    view = repository.peek(tickers_[index]);
+                    if (view.empty()) {
+                        view = BarView(BarRepository::loadSeries(*db, tickers_[index]));
+                    }
+                }
+                if (!view.empty()) {
+                    chunk.bytes += view.series()->bytes();
+                    view = view.last(bars_);
+                }
+                chunk.bars.push_back(std::move(view));
+                index++;
+            }
+        }
+        chunk.charge = std::make_unique<MemoryCharge>(MemorySubsystem::RunBars, chunk.bytes);
+
+        std::lock_guard<std::mutex> lock(mutex_);
+        ready_.push_back(std::move(chunk));
+        chunks_++;
+        changed_.notify_all();
+    }
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    finished_ = true;
+    changed_.notify_all();
+}
@@ -0,0 +1,72 @@
+#ifndef BAR_STREAM_H
+#define BAR_STREAM_H
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "bar_repository.h"
+#include "memory_usage.h"
+
+class DbConnection;
+
+// Consecutive tickers of a stream and their bars
+struct BarChunk {
+    std::size_t first = 0;                   // index of the first ticker in the stream's list
+    std::vector<BarView> bars;               // one per ticker; empty if it has none or was filtered out
+    std::size_t bytes = 0;                   // histories the views keep alive
+    std::unique_ptr<MemoryCharge> charge;    // those bytes, charged to MemorySubsystem::RunBars
+};
+
+// Recent bars of a list of tickers, read chunk by chunk on a background thread so the next chunk
+// is loaded while the current one is traded. A chunk closes once its histories reach chunkBytes
+// (it always holds at least one ticker) and at most prefetch chunks wait ahead of the consumer,
+// so no more than about (prefetch + 2) * chunkBytes of bars are held at once, whatever the number
+// of tickers. Histories the repository already holds are used as they are; the others are read
+// without being cached, so a long stream does not evict what the chart is showing.
+class BarStreamReader
+{
+public:
+    // Called on the reader thread before ticker index is loaded, with the connection the chunk is
+    // read on; returning false leaves its bars out of the chunk.
+    using Filter = std::function<bool(DbConnection& db, std::size_t index)>;
+
+    // tickers are upper-case symbols; each view holds the most recent bars bars of its ticker
+    BarStreamReader(std::vector<std::string> tickers, std::size_t bars, std::size_t chunkBytes,
+                    std::size_t prefetch = 1, Filter filter = Filter());
+    ~BarStreamReader();
+
+    BarStreamReader(const BarStreamReader&) = delete;
+    BarStreamReader& operator=(const BarStreamReader&) = delete;
+
+    // Waits for the next chunk, in ticker order. Returns false once every ticker was delivered or
+    // the database could not be read.
+    bool next(BarChunk& chunk);
+
+    std::size_t chunksRead() const;
+
+private:
+    void run();
+
+    std::vector<std::string> tickers_;
+    std::size_t bars_;
+    std::size_t chunkBytes_;
+    std::size_t prefetch_;
+    Filter filter_;
+
+    mutable std::mutex mutex_;
+    std::condition_variable changed_;
+    std::deque<BarChunk> ready_;
+    bool finished_ = false;
+    bool stopping_ = false;
+    std::size_t chunks_ = 0;
+    std::thread thread_;
+};
+
+#endif // BAR_STREAM_H
@@ -0,0 +1,213 @@
+// Times the indicator loops the app used before indicator_kernels against the kernels. The kernel
+// path is picked once per process, so run it once per path to compare them:
+//
+//   BTE_INDICATOR_KERNELS=scalar indicator_kernels_bench
+//   BTE_INDICATOR_KERNELS=sse2   indicator_kernels_bench
+//   indicator_kernels_bench                                  (AVX2 where the CPU has it)
+//
+// Optional arguments: bars per series (default 5000) and repetitions (default 1000).
+
+#include "indicator_kernels.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <vector>
+
+namespace {
+
+struct Series {
+    std::vector<double> open, high, low, close, volume;
+};
+
+// Random walk with a plausible range and volume
+Series makeSeries(std::size_t n)
+{
+    std::mt19937_64 random(42);
+    std::normal_distribution<double> step(0.0, 0.01);
+    std::uniform_real_distribution<double> range(0.002, 0.03);
+    std::uniform_real_distribution<double> volume(1e5, 5e6);
+    Series s;
+    double price = 50.0;
+    for (std::size_t i = 0; i < n; ++i) {
+        const double open = price;
+        price *= 1.0 + step(random);
+        const double spread = price * range(random);
+        s.open.push_back(open);
+        s.close.push_back(price);
+        s.high.push_back(std::max(open, price) + spread / 2);
+        s.low.push_back(std::min(open, price) - spread / 2);
+        s.volume.push_back(volume(random));
+    }
+    return s;
+}
+
+// --- The loops the kernels replaced ---
+
+// Indicators::movingAverage / adr / avgVolume: the window summed again at every bar
+double windowMean(const double* values, std::size_t end, int length)
+{
+    if (end + 1 < static_cast<std::size_t>(length)) {
+        return 0;
+    }
+    double sum = 0.0;
+    for (std::size_t i = end + 1 - length; i <= end; ++i) {
+        sum += values[i];
+    }
+    return sum / length;
+}
+
+double windowRange(const double* high, const double* low, std::size_t end, int length)
+{
+    if (end + 1 < static_cast<std::size_t>(length)) {
+        return 0;
+    }
+    double sum = 0.0;
+    for (std::size_t i = end + 1 - length; i <= end; ++i) {
+        sum += high[i] - low[i];
+    }
+    return sum / length;
+}
+
+// computeSMA / computeADR / computeVWAP of the chart overlays: running sums
+void runningSma(const double* values, std::size_t n, int period, double* out)
+{
+    double sum = 0.0;
+    for (std::size_t i = 0; i < n; ++i) {
+        sum += values[i];
+        if (i >= static_cast<std::size_t>(period)) sum -= values[i - period];
+        out[i] = i + 1 >= static_cast<std::size_t>(period) ? sum / period : 0.0;
+    }
+}
+
+void runningAdr(const double* high, const double* low, std::size_t n, int period, double* out)
+{
+    double sum = 0.0;
+    for (std::size_t i = 0; i < n; ++i) {
+        sum += high[i] - low[i];
+        if (i >= static_cast<std::size_t>(period)) sum -= high[i - period] - low[i - period];
+        out[i] = i + 1 >= static_cast<std::size_t>(period) ? sum / period : 0.0;
+    }
+}
+
+void runningVwap(const Series& s, std::size_t n, int period, double* out)
+{
+    double priceVolume = 0.0;
+    double totalVolume = 0.0;
+    for (std::size_t i = 0; i < n; ++i) {
+        priceVolume += (s.high[i] + s.low[i] + s.close[i]) / 3.0 * s.volume[i];
+        totalVolume += s.volume[i];
+        if (i >= static_cast<std::size_t>(period)) {
+            const std::size_t j = i - period;
+            priceVolume -= (s.high[j] + s.low[j] + s.close[j]) / 3.0 * s.volume[j];
+            totalVolume -= s.volume[j];
+        }
+        out[i] = i + 1 >= static_cast<std::size_t>(period) && totalVolume > 0.0 ? priceVolume / totalVolume : 0.0;
+    }
+}
+
+// Donchian edge as a plain scan of each window
+void naiveRollingMax(const double* values, std::size_t n, int period, double* out)
+{
+    for (std::size_t i = 0; i < n; ++i) {
+        if (i + 1 < static_cast<std::size_t>(period)) {
+            out[i] = 0.0;
+            continue;
+        }
+        double best = values[i + 1 - period];
+        for (std::size_t j = i + 2 - period; j <= i; ++j) best = std::max(best, values[j]);
+        out[i] = best;
+    }
+}
+
+// --- Timing ---
+
+template <typename Body>
+double timeMs(int repetitions, Body body)
+{
+    body();   // warm-up
+    const auto start = std::chrono::steady_clock::now();
+    for (int r = 0; r < repetitions; ++r) {
+        body();
+    }
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+double maxDifference(const std::vector<double>& a, const std::vector<double>& b)
+{
+    double worst = 0.0;
+    for (std::size_t i = 0; i < a.size(); ++i) {
+        worst = std::max(worst, std::abs(a[i] - b[i]) / std::max(1.0, std::abs(b[i])));
+    }
+    return worst;
+}
+
+// Keeps results observable so the loops are not optimized away
+volatile double g_sink;
+
+void report(const char* name, double loopMs, double kernelMs, double difference)
+{
+    std::printf("%-34s %10.1f ms %10.1f ms %8.2fx   max rel. difference %.1e\n",
+                name, loopMs, kernelMs, kernelMs > 0.0 ? loopMs / kernelMs : 0.0, difference);
+}
+
+} // namespace
+
+int main(int argc, char** argv)
+{
+    const std::size_t n = argc > 1 ? static_cast<std::size_t>(std::strtoull(argv[1], nullptr, 10)) : 5000;
+    const int repetitions = argc > 2 ? std::atoi(argv[2]) : 1000;
+    if (n < 64 || repetitions <= 0) {
+        std::fprintf(stderr, "usage: indicator_kernels_bench [bars >= 64] [repetitions > 0]\n");
+        return 1;
+    }
+    const Series s = makeSeries(n);
+    std::printf("Kernel path %s, %zu bars, %d repetitions\n\n", indicatorKernelPath(), n, repetitions);
+    std::printf("%-34s %13s %13s %9s\n", "", "old loop", "kernel", "speedup");
+
+    std::vector<double> a(n), b(n), c(n), ka(n), kb(n), kc(n);
+
+    // The backtest's SMA 10, ADR 14 and average volume 14 at every bar
+    const double perBarMs = timeMs(repetitions, [&]() {
+        for (std::size_t i = 0; i < n; ++i) {
+            a[i] = windowMean(s.close.data(), i, 10);
+            b[i] = windowRange(s.high.data(), s.low.data(), i, 14);
+            c[i] = windowMean(s.volume.data(), i, 14);
+        }
+        g_sink = a[n - 1] + b[n - 1] + c[n - 1];
+    });
+    const double batchMs = timeMs(repetitions, [&]() {
+        smaSeries(s.close.data(), n, 10, ka.data());
+        adrSeries(s.high.data(), s.low.data(), n, 14, kb.data());
+        smaSeries(s.volume.data(), n, 14, kc.data());
+        g_sink = ka[n - 1] + kb[n - 1] + kc[n - 1];
+    });
+    report("Backtest SMA10 + ADR14 + avgvol14", perBarMs, batchMs,
+           std::max({maxDifference(ka, a), maxDifference(kb, b), maxDifference(kc, c)}));
+
+    // The chart overlays' running sums, over a long window
+    report("Overlay SMA 50",
+           timeMs(repetitions, [&]() { runningSma(s.close.data(), n, 50, a.data()); g_sink = a[n - 1]; }),
+           timeMs(repetitions, [&]() { smaSeries(s.close.data(), n, 50, ka.data()); g_sink = ka[n - 1]; }),
+           maxDifference(ka, a));
+    report("Overlay ADR 20",
+           timeMs(repetitions, [&]() { runningAdr(s.high.data(), s.low.data(), n, 20, a.data()); g_sink = a[n - 1]; }),
+           timeMs(repetitions, [&]() { adrSeries(s.high.data(), s.low.data(), n, 20, ka.data()); g_sink = ka[n - 1]; }),
+           maxDifference(ka, a));
+    report("Overlay VWAP 20",
+           timeMs(repetitions, [&]() { runningVwap(s, n, 20, a.data()); g_sink = a[n - 1]; }),
+           timeMs(repetitions, [&]() {
+               vwapSeries(s.high.data(), s.low.data(), s.close.data(), s.volume.data(), n, 20, ka.data());
+               g_sink = ka[n - 1];
+           }),
+           maxDifference(ka, a));
+
+    report("Donchian high 20",
+           timeMs(repetitions, [&]() { naiveRollingMax(s.high.data(), n, 20, a.data()); g_sink = a[n - 1]; }),
+           timeMs(repetitions, [&]() { rollingMaxSeries(s.high.data(), n, 20, ka.data()); g_sink = ka[n - 1]; }),
+           maxDifference(ka, a));
+    return 0;
+}
@@ -0,0 +1,435 @@
+#include "bulk_import.h"
+#include "bar_repository.h"
+#include "day_number.h"
+#include "db_schema.h"
+
+#include <algorithm>
+#include <atomic>
+#include <charconv>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <cstring>
+#include <deque>
+#include <iostream>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace {
+
+// Rows per multi-row INSERT. 7 columns * 128 rows stays below SQLite's default 999 variable limit.
+constexpr std::size_t kRowsPerStatement = 128;
+// Rows written between COMMITs.
+constexpr std::size_t kRowsPerTransaction = 500000;
+// Size of the slices handed to parser threads.
+constexpr std::size_t kChunkBytes = 8 * 1024 * 1024;
+
+// ------------------------
+// Memory Mapped File
+// ------------------------
+
+class MappedFile {
+public:
+    explicit MappedFile(const std::string& path) {
+#ifdef _WIN32
+        file_ = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING,
+                            FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+        if (file_ == INVALID_HANDLE_VALUE) {
+            return;
+        }
+        LARGE_INTEGER size;
+        if (!GetFileSizeEx(file_, &size) || size.QuadPart == 0) {
+            return;
+        }
+        mapping_ = CreateFileMappingA(file_, NULL, PAGE_READONLY, 0, 0, NULL);
+        if (!mapping_) {
+            return;
+        }
+        data_ = static_cast<const char*>(MapViewOfFile(mapping_, FILE_MAP_READ, 0, 0, 0));
+        if (data_) {
+            size_ = static_cast<std::size_t>(size.QuadPart);
+        }
+#else
+        fd_ = ::open(path.c_str(), O_RDONLY);
+        if (fd_ < 0) {
+            return;
+        }
+        struct stat st;
+        if (fstat(fd_, &st) != 0 || st.st_size == 0) {
+            return;
+        }
+        void* addr = mmap(nullptr, static_cast<std::size_t>(st.st_size), PROT_READ, MAP_PRIVATE, fd_, 0);
+        if (addr == MAP_FAILED) {
+            return;
+        }
+        madvise(addr, static_cast<std::size_t>(st.st_size), MADV_SEQUENTIAL);
+        data_ = static_cast<const char*>(addr);
+        size_ = static_cast<std::size_t>(st.st_size);
+#endif
+    }
+
+    ~MappedFile() {
+#ifdef _WIN32
+        if (data_) UnmapViewOfFile(data_);
+        if (mapping_) CloseHandle(mapping_);
+        if (file_ != INVALID_HANDLE_VALUE) CloseHandle(file_);
+#else
+        if (data_) munmap(const_cast<char*>(data_), size_);
+        if (fd_ >= 0) ::close(fd_);
+#endif
+    }
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    bool isOpen() const { return data_ != nullptr; }
+    const char* data() const { return data_; }
+    std::size_t size() const { return size_; }
+
+private:
+    const char* data_ = nullptr;
+    std::size_t size_ = 0;
+#ifdef _WIN32
+    HANDLE file_ = INVALID_HANDLE_VALUE;
+    HANDLE mapping_ = NULL;
+#else
+    int fd_ = -1;
+#endif
+};
+
+// ------------------------
+// Parsing
+// ------------------------
+
+// The ticker points into the mapped file and stays valid until it is unmapped.
+struct ParsedRow {
+    double open;
+    double high;
+    double low;
+    double close;
+    std::int64_t volume;
+    std::string_view ticker;
+    int day;
+};
+
+struct ParsedChunk {
+    std::vector<ParsedRow> rows;
+    std::size_t rejected = 0;
+    std::size_t bytes = 0;
+};
+
+std::string_view trimField(const char* begin, const char* end) {
+    while (begin < end && (*begin == ' ' || *begin == '"')) ++begin;
+    while (end > begin && (end[-1] == ' ' || end[-1] == '"' || end[-1] == '\r')) --end;
+    return std::string_view(begin, static_cast<std::size_t>(end - begin));
+}
+
+bool parseDouble(std::string_view field, double& out) {
+    auto result = std::from_chars(field.data(), field.data() + field.size(), out);
+    return result.ec == std::errc() && result.ptr == field.data() + field.size();
+}
+
+bool parseVolume(std::string_view field, std::int64_t& out) {
+    auto result = std::from_chars(field.data(), field.data() + field.size(), out);
+    if (result.ec == std::errc() && result.ptr == field.data() + field.size()) {
+        return true;
+    }
+    // Some exports write volume as "12345.0"
+    double value = 0.0;
+    if (!parseDouble(field, value)) {
+        return false;
+    }
+    out = static_cast<std::int64_t>(value);
+    return true;
+}
+
+bool parseLine(const char* begin, const char* end, ParsedRow& row) {
+    std::string_view fields[7];
+    int count = 0;
+    const char* fieldStart = begin;
+    for (const char* p = begin; p <= end && count < 7; ++p) {
+        if (p == end || *p == ',') {
+            fields[count++] = trimField(fieldStart, p);
+            fieldStart = p + 1;
+        }
+    }
+    if (count != 7) {
+        return false;
+    }
+
+    if (!parseDouble(fields[0], row.open) || !parseDouble(fields[1], row.high)
+        || !parseDouble(fields[2], row.low) || !parseDouble(fields[3], row.close)
+        || !parseVolume(fields[4], row.volume)) {
+        return false;
+    }
+    row.ticker = fields[5];
+    return !row.ticker.empty() && parseDayNumber(fields[6], row.day);
+}
+
+ParsedChunk parseChunk(const char* begin, const char* end) {
+    ParsedChunk chunk;
+    chunk.bytes = static_cast<std::size_t>(end - begin);
+    chunk.rows.reserve(chunk.bytes / 48);
+
+    const char* line = begin;
+    while (line < end) {
+        const char* lineEnd = static_cast<const char*>(std::memchr(line, '\n', static_cast<std::size_t>(end - line)));
+        if (!lineEnd) {
+            lineEnd = end;
+        }
+        if (lineEnd > line && !(lineEnd - line == 1 && *line == '\r')) {
+            ParsedRow row;
+            if (parseLine(line, lineEnd, row)) {
+                chunk.rows.push_back(row);
+            } else {
+                chunk.rejected++;
+            }
+        }
+        line = lineEnd + 1;
+    }
+    return chunk;
+}
+
+// Splits [begin, end) into pieces of roughly kChunkBytes that always end on a line break.
+std::vector<std::pair<const char*, const char*>> splitChunks(const char* begin, const char* end) {
+    std::vector<std::pair<const char*, const char*>> chunks;
+    const char* start = begin;
+    while (start < end) {
+        const char* stop = start + std::min<std::size_t>(kChunkBytes, static_cast<std::size_t>(end - start));
+        if (stop < end) {
+            const char* newline = static_cast<const char*>(std::memchr(stop, '\n', static_cast<std::size_t>(end - stop)));
+            stop = newline ? newline + 1 : end;
+        }
+        chunks.emplace_back(start, stop);
+        start = stop;
+    }
+    return chunks;
+}
+
+// ------------------------
+// Inserting
+// ------------------------
+
+std::string buildInsertSQL(std::size_t rows) {
+    std::string sql = "INSERT INTO Bars (ticker_id, day, open, high, low, close, volume) VALUES ";
+    sql.reserve(sql.size() + rows * 24);
+    for (std::size_t i = 0; i < rows; ++i) {
+        sql += (i == 0) ? "(?, ?, ?, ?, ?, ?, ?)" : ", (?, ?, ?, ?, ?, ?, ?)";
+    }
+    sql += " ON CONFLICT (ticker_id, day) DO UPDATE SET "
+           "open = excluded.open, high = excluded.high, low = excluded.low, "
+           "close = excluded.close, volume = excluded.volume;";
+    return sql;
+}
+
+void bindRow(sqlite3_stmt* stmt, int firstParam, sqlite3_int64 tickerId, const ParsedRow& row) {
+    sqlite3_bind_int64(stmt, firstParam, tickerId);
+    sqlite3_bind_int(stmt, firstParam + 1, row.day);
+    sqlite3_bind_double(stmt, firstParam + 2, row.open);
+    sqlite3_bind_double(stmt, firstParam + 3, row.high);
+    sqlite3_bind_double(stmt, firstParam + 4, row.low);
+    sqlite3_bind_double(stmt, firstParam + 5, row.close);
+    sqlite3_bind_int64(stmt, firstParam + 6, row.volume);
+}
+
+class RowWriter {
+public:
+    explicit RowWriter(DbConnection& db) : db_(db), DB_(db.handle()) {}
+
+    bool prepare() {
+        batch_ = db_.prepare("bulkImport.batch", buildInsertSQL(kRowsPerStatement).c_str());
+        single_ = db_.prepare("bulkImport.single", buildInsertSQL(1).c_str());
+        batchStmt_ = batch_.get();
+        singleStmt_ = single_.get();
+        return batch_ && single_;
+    }
+
+    // Returns the number of rows written.
+    std::size_t write(const std::vector<ParsedRow>& rows) {
+        std::size_t written = 0;
+        std::size_t i = 0;
+        for (; i + kRowsPerStatement <= rows.size(); i += kRowsPerStatement) {
+            bool resolved = true;
+            for (std::size_t r = 0; r < kRowsPerStatement && resolved; ++r) {
+                sqlite3_int64 id = tickerId(rows[i + r].ticker);
+                resolved = id >= 0;
+                bindRow(batchStmt_, static_cast<int>(r * 7 + 1), id, rows[i + r]);
+            }
+            if (resolved) {
+                written += step(batchStmt_, kRowsPerStatement);
+            } else {
+                sqlite3_reset(batchStmt_);
+                written += writeSingle(rows, i, i + kRowsPerStatement);
+            }
+        }
+        return written + writeSingle(rows, i, rows.size());
+    }
+
+private:
+    std::size_t writeSingle(const std::vector<ParsedRow>& rows, std::size_t from, std::size_t to) {
+        std::size_t written = 0;
+        for (std::size_t i = from; i < to; ++i) {
+            sqlite3_int64 id = tickerId(rows[i].ticker);
+            if (id < 0) {
+                continue;
+            }
+            bindRow(singleStmt_, 1, id, rows[i]);
+            written += step(singleStmt_, 1);
+        }
+        return written;
+    }
+
+    sqlite3_int64 tickerId(std::string_view symbol) {
+        auto it = tickerIds_.find(symbol);
+        if (it != tickerIds_.end()) {
+            return it->second;
+        }
+        sqlite3_int64 id = lookupTickerId(DB_, symbol, true);
+        // Keys view the mapped file, which outlives the writer.
+        tickerIds_.emplace(symbol, id);
+        return id;
+    }
+
+    std::size_t step(sqlite3_stmt* stmt, std::size_t rows) {
+        std::size_t written = rows;
+        if (sqlite3_step(stmt) != SQLITE_DONE) {
+            std::cerr << "Error inserting data: " << sqlite3_errmsg(DB_) << std::endl;
+            written = 0;
+        }
+        sqlite3_reset(stmt);
+        return written;
+    }
+
+    DbConnection& db_;
+    sqlite3* DB_;
+    CachedStatement batch_;
+    CachedStatement single_;
+    sqlite3_stmt* batchStmt_ = nullptr;
+    sqlite3_stmt* singleStmt_ = nullptr;
+    std::unordered_map<std::string_view, sqlite3_int64> tickerIds_;
+};
+
+} // namespace
+
+bool bulkImportCSV(DbConnection& db, const std::string& csvPath, ImportStats& stats,
+                   const ImportProgressCallback& progress) {
+    sqlite3* DB = db.handle();
+    auto startTime = std::chrono::steady_clock::now();
+    stats = ImportStats();
+
+    MappedFile file(csvPath);
+    if (!file.isOpen()) {
+        std::cerr << "Error opening CSV file: " << csvPath << std::endl;
+        return false;
+    }
+    stats.totalBytes = file.size();
+
+    // Skip the header line
+    const char* begin = file.data();
+    const char* end = file.data() + file.size();
+    const char* headerEnd = static_cast<const char*>(std::memchr(begin, '\n', file.size()));
+    begin = headerEnd ? headerEnd + 1 : end;
+    stats.bytesParsed = static_cast<std::size_t>(begin - file.data());
+
+    RowWriter writer(db);
+    if (!writer.prepare()) {
+        return false;
+    }
+
+    std::vector<std::pair<const char*, const char*>> chunks = splitChunks(begin, end);
+    unsigned int threadCount = std::max(1u, std::thread::hardware_concurrency());
+    threadCount = std::min<unsigned int>(threadCount, static_cast<unsigned int>(std::max<std::size_t>(1, chunks.size())));
+    // Bound the number of parsed-but-unwritten chunks so memory stays flat for multi-GB files.
+    const std::size_t maxPending = threadCount * 2;
+
+    std::mutex mutex;
+    std::condition_variable readyCv;
+    std::condition_variable spaceCv;
+    std::deque<ParsedChunk> ready;
+    std::atomic<std::size_t> nextChunk{0};
+    std::size_t finishedWorkers = 0;
+
+    std::vector<std::thread> workers;
+    workers.reserve(threadCount);
+    for (unsigned int t = 0; t < threadCount; ++t) {
+        workers.emplace_back([&]() {
+            for (;;) {
+                std::size_t index = nextChunk.fetch_add(1);
+                if (index >= chunks.size()) {
+                    break;
+                }
+                ParsedChunk parsed = parseChunk(chunks[index].first, chunks[index].second);
+                std::unique_lock<std::mutex> lock(mutex);
+                spaceCv.wait(lock, [&]() { return ready.size() < maxPending; });
+                ready.push_back(std::move(parsed));
+                readyCv.notify_one();
+            }
+            std::lock_guard<std::mutex> lock(mutex);
+            finishedWorkers++;
+            readyCv.notify_one();
+        });
+    }
+
+    sqlite3_exec(DB, "PRAGMA synchronous = OFF;", NULL, NULL, NULL);
+    sqlite3_exec(DB, "BEGIN TRANSACTION;", NULL, NULL, NULL);
+
+    std::size_t rowsInTransaction = 0;
+    for (;;) {
+        ParsedChunk chunk;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            readyCv.wait(lock, [&]() { return !ready.empty() || finishedWorkers == threadCount; });
+            if (ready.empty()) {
+                break;
+            }
+            chunk = std::move(ready.front());
+            ready.pop_front();
+            spaceCv.notify_one();
+        }
+
+        std::size_t written = writer.write(chunk.rows);
+        stats.rowsInserted += written;
+        stats.rowsRejected += chunk.rejected + (chunk.rows.size() - written);
+        stats.bytesParsed += chunk.bytes;
+        rowsInTransaction += written;
+
+        if (rowsInTransaction >= kRowsPerTransaction) {
+            sqlite3_exec(DB, "COMMIT; BEGIN TRANSACTION;", NULL, NULL, NULL);
+            rowsInTransaction = 0;
+        }
+
+        stats.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+        if (progress) {
+            progress(stats);
+        }
+    }
+
+    for (std::thread& worker : workers) {
+        worker.join();
+    }
+
+    // Imported rows may overwrite any day, so every stored feature series is stale
+    recordBulkWrite(DB);
+    sqlite3_exec(DB, "COMMIT;", NULL, NULL, NULL);
+    sqlite3_exec(DB, "PRAGMA synchronous = NORMAL;", NULL, NULL, NULL);
+    BarRepository::instance().invalidateAll();
+
+    stats.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+    std::cout << "Imported " << stats.rowsInserted << " rows (" << stats.rowsRejected << " rejected) in "
+              << stats.seconds << "s, " << static_cast<long long>(stats.rowsPerSecond()) << " rows/sec" << std::endl;
+    return true;
+}
@@ -0,0 +1,30 @@
+#ifndef BULK_IMPORT_H
+#define BULK_IMPORT_H
+
+#include "database.h"
+#include <cstddef>
+#include <functional>
+#include <string>
+
+// Progress / result of a bulk CSV import
+struct ImportStats {
+    std::size_t rowsInserted = 0;
+    std::size_t rowsRejected = 0;
+    std::size_t bytesParsed = 0;
+    std::size_t totalBytes = 0;
+    double seconds = 0.0;
+
+    double rowsPerSecond() const { return seconds > 0.0 ? rowsInserted / seconds : 0.0; }
+};
+
+using ImportProgressCallback = std::function<void(const ImportStats&)>;
+
+// Imports a CSV with the layout "open,high,low,close,volume,ticker,date" (first line is a header)
+// into the Bars table, updating rows that already exist for a (ticker, day). The file is memory
+// mapped, split into chunks that are parsed on worker threads, and written through prepared
+// multi-row INSERTs inside large transactions.
+// Returns false if the file could not be opened or the insert statements could not be prepared.
+bool bulkImportCSV(DbConnection& db, const std::string& csvPath, ImportStats& stats,
+                   const ImportProgressCallback& progress = nullptr);
+
+#endif // BULK_IMPORT_H
@@ -0,0 +1,155 @@
+#include "candle_renderer.h"
+
+#include <QLineF>
+#include <QPolygonF>
+#include <QVector>
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+
+void ChartMapping::visibleRange(std::size_t count, std::size_t& first, std::size_t& last) const
+{
+    double lo = std::floor(firstBar);
+    double hi = std::ceil(firstBar + barsVisible) + 1.0;
+    lo = std::clamp(lo, 0.0, static_cast<double>(count));
+    hi = std::clamp(hi, 0.0, static_cast<double>(count));
+    first = static_cast<std::size_t>(lo);
+    last = static_cast<std::size_t>(hi);
+}
+
+bool visiblePriceRange(const BarView& bars, std::size_t first, std::size_t last, double& minPrice, double& maxPrice)
+{
+    const double* high = bars.high();
+    const double* low = bars.low();
+    minPrice = DBL_MAX;
+    maxPrice = -DBL_MAX;
+    for (std::size_t i = first; i < last; ++i) {
+        minPrice = std::min(minPrice, low[i]);
+        maxPrice = std::max(maxPrice, high[i]);
+    }
+    return first < last;
+}
+
+double visibleVolumeMax(const BarView& bars, std::size_t first, std::size_t last)
+{
+    const double* volume = bars.volume();
+    double maxVolume = 0.0;
+    for (std::size_t i = first; i < last; ++i) {
+        maxVolume = std::max(maxVolume, volume[i]);
+    }
+    return maxVolume;
+}
+
+void paintCandles(QPainter& painter, const ChartMapping& mapping, const BarView& bars, const CandleStyle& style)
+{
+    std::size_t first, last;
+    mapping.visibleRange(bars.size(), first, last);
+    if (first >= last) {
+        return;
+    }
+
+    const double* open = bars.open();
+    const double* high = bars.high();
+    const double* low = bars.low();
+    const double* close = bars.close();
+
+    const double bodyWidth = mapping.pixelsPerBar() * style.bodyWidth;
+    const bool drawBodies = bodyWidth >= 2.0;
+
+    QVector<QLineF> wicksUp, wicksDown;
+    QVector<QRectF> bodiesUp, bodiesDown;
+    wicksUp.reserve(static_cast<int>(last - first));
+    wicksDown.reserve(static_cast<int>(last - first));
+    if (drawBodies) {
+        bodiesUp.reserve(static_cast<int>(last - first));
+        bodiesDown.reserve(static_cast<int>(last - first));
+    }
+
+    for (std::size_t i = first; i < last; ++i) {
+        const bool up = close[i] >= open[i];
+        const double x = std::round(mapping.xForBar(static_cast<double>(i))) + 0.5;
+        QLineF wick(x, mapping.yForValue(high[i]), x, mapping.yForValue(low[i]));
+        (up ? wicksUp : wicksDown).append(wick);
+
+        if (drawBodies) {
+            double top = mapping.yForValue(std::max(open[i], close[i]));
+            double bottom = mapping.yForValue(std::min(open[i], close[i]));
+            QRectF body(x - bodyWidth / 2.0, top, bodyWidth, std::max(1.0, bottom - top));
+            (up ? bodiesUp : bodiesDown).append(body);
+        }
+    }
+
+    painter.save();
+    painter.setRenderHint(QPainter::Antialiasing, false);
+
+    painter.setPen(QPen(style.increasing, 1));
+    painter.drawLines(wicksUp);
+    painter.setPen(QPen(style.decreasing, 1));
+    painter.drawLines(wicksDown);
+
+    if (drawBodies) {
+        painter.setPen(Qt::NoPen);
+        painter.setBrush(style.increasing);
+        painter.drawRects(bodiesUp);
+        painter.setBrush(style.decreasing);
+        painter.drawRects(bodiesDown);
+    }
+    painter.restore();
+}
+
+void paintVolume(QPainter& painter, const ChartMapping& mapping, const BarView& bars, const CandleStyle& style)
+{
+    std::size_t first, last;
+    mapping.visibleRange(bars.size(), first, last);
+    if (first >= last || mapping.maxValue <= mapping.minValue) {
+        return;
+    }
+
+    const double* volume = bars.volume();
+    const double width = std::max(1.0, mapping.pixelsPerBar() * style.bodyWidth);
+
+    QVector<QRectF> columns;
+    columns.reserve(static_cast<int>(last - first));
+    for (std::size_t i = first; i < last; ++i) {
+        const double x = mapping.xForBar(static_cast<double>(i));
+        const double top = mapping.yForValue(volume[i]);
+        columns.append(QRectF(x - width / 2.0, top, width, mapping.area.bottom() - top));
+    }
+
+    painter.save();
+    painter.setRenderHint(QPainter::Antialiasing, false);
+    painter.setPen(Qt::NoPen);
+    painter.setBrush(style.volume);
+    painter.drawRects(columns);
+    painter.restore();
+}
+
+void paintSeriesLine(QPainter& painter, const ChartMapping& mapping, const double* values, std::size_t count,
+                     const QPen& pen, std::size_t stride)
+{
+    std::size_t first, last;
+    mapping.visibleRange(count, first, last);
+    if (first >= last) {
+        return;
+    }
+    stride = std::max<std::size_t>(1, stride);
+
+    QPolygonF line;
+    line.reserve(static_cast<int>((last - first) / stride + 1));
+    painter.save();
+    painter.setPen(pen);
+    // Sample at multiples of stride so points don't shift while panning
+    for (std::size_t i = first - first % stride; i < last; i += stride) {
+        if (values[i] <= 0.0) {
+            // Break the line over warm-up gaps
+            if (line.size() > 1) painter.drawPolyline(line);
+            line.clear();
+            continue;
+        }
+        line.append(QPointF(mapping.xForBar(static_cast<double>(i)), mapping.yForValue(values[i])));
+    }
+    if (line.size() > 1) {
+        painter.drawPolyline(line);
+    }
+    painter.restore();
+}
@@ -0,0 +1,65 @@
+#ifndef CANDLE_RENDERER_H
+#define CANDLE_RENDERER_H
+
+#include <QColor>
+#include <QPainter>
+#include <QRectF>
+#include <cstddef>
+
+#include "bar_repository.h"
+
+// Maps bar indices and values to pixels inside one plot rectangle. Bar i is centred on
+// xForBar(i); firstBar may be fractional while panning.
+struct ChartMapping {
+    QRectF area;
+    double firstBar = 0.0;      // index at area.left()
+    double barsVisible = 1.0;   // number of bar slots across area.width()
+    double minValue = 0.0;
+    double maxValue = 1.0;
+
+    double pixelsPerBar() const { return area.width() / barsVisible; }
+    double xForBar(double index) const { return area.left() + (index - firstBar + 0.5) * pixelsPerBar(); }
+    double barAtX(double x) const { return firstBar + (x - area.left()) / pixelsPerBar() - 0.5; }
+    double yForValue(double value) const {
+        return area.bottom() - (value - minValue) / (maxValue - minValue) * area.height();
+    }
+    double valueAtY(double y) const {
+        return minValue + (area.bottom() - y) / area.height() * (maxValue - minValue);
+    }
+
+    // Index range [first, last) of bars that intersect the area, clamped to [0, count).
+    void visibleRange(std::size_t count, std::size_t& first, std::size_t& last) const;
+
+    // Same area and values for a series where one bar spans factor bars of this mapping.
+    ChartMapping coarsened(int factor) const {
+        ChartMapping mapping = *this;
+        mapping.firstBar = firstBar / factor;
+        mapping.barsVisible = barsVisible / factor;
+        return mapping;
+    }
+};
+
+struct CandleStyle {
+    QColor increasing = QColor(0, 197, 49);
+    QColor decreasing = QColor(255, 95, 95);
+    QColor volume = QColor(0, 0, 255, 128);
+    double bodyWidth = 0.6;     // fraction of a bar slot
+};
+
+// Lowest low / highest high over bars [first, last). Returns false if the range is empty.
+bool visiblePriceRange(const BarView& bars, std::size_t first, std::size_t last, double& minPrice, double& maxPrice);
+double visibleVolumeMax(const BarView& bars, std::size_t first, std::size_t last);
+
+// Draws the visible candles with one batched call per colour and primitive. Bodies collapse to
+// plain high-low lines once they would be narrower than two pixels.
+void paintCandles(QPainter& painter, const ChartMapping& mapping, const BarView& bars, const CandleStyle& style);
+
+// Volume bars growing up from mapping.area.bottom(); mapping's value range is 0..max volume.
+void paintVolume(QPainter& painter, const ChartMapping& mapping, const BarView& bars, const CandleStyle& style);
+
+// Polyline through values[i] for the visible bars, sampling every stride-th bar when zoomed
+// out. Values <= 0 (warm-up) are skipped.
+void paintSeriesLine(QPainter& painter, const ChartMapping& mapping, const double* values, std::size_t count,
+                     const QPen& pen, std::size_t stride = 1);
+
+#endif // CANDLE_RENDERER_H
@@ -0,0 +1,223 @@
+#include "chart_overlays.h"
+#include "indicator_kernels.h"
+
+#include <QPen>
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+
+QString overlayName(const OverlaySpec& spec)
+{
+    switch (spec.kind) {
+    case OverlayKind::SMA:      return QString("SMA %1").arg(spec.period);
+    case OverlayKind::EMA:      return QString("EMA %1").arg(spec.period);
+    case OverlayKind::ADRBands: return QString("ADR bands %1").arg(spec.period);
+    case OverlayKind::VWAP:     return QString("VWAP %1").arg(spec.period);
+    case OverlayKind::RSI:      return QString("RSI %1").arg(spec.period);
+    case OverlayKind::ADR:      return QString("ADR %1").arg(spec.period);
+    case OverlayKind::ATR:      return QString("ATR %1").arg(spec.period);
+    case OverlayKind::Bollinger: return QString("Bollinger %1").arg(spec.period);
+    case OverlayKind::Donchian: return QString("Donchian %1").arg(spec.period);
+    }
+    return QString();
+}
+
+// ------------------------
+// Indicator buffers
+// ------------------------
+
+QVector<double> computeSMA(const BarView& bars, int period)
+{
+    QVector<double> values(static_cast<int>(bars.size()));
+    smaSeries(bars.close(), bars.size(), period, values.data());
+    return values;
+}
+
+QVector<double> computeEMA(const BarView& bars, int period)
+{
+    QVector<double> values(static_cast<int>(bars.size()));
+    emaSeries(bars.close(), bars.size(), period, values.data());
+    return values;
+}
+
+QVector<double> computeADR(const BarView& bars, int period)
+{
+    QVector<double> values(static_cast<int>(bars.size()));
+    adrSeries(bars.high(), bars.low(), bars.size(), period, values.data());
+    return values;
+}
+
+QVector<double> computeATR(const BarView& bars, int period)
+{
+    QVector<double> values(static_cast<int>(bars.size()));
+    atrSeries(bars.high(), bars.low(), bars.close(), bars.size(), period, values.data());
+    return values;
+}
+
+QVector<double> computeVWAP(const BarView& bars, int period)
+{
+    QVector<double> values(static_cast<int>(bars.size()));
+    vwapSeries(bars.high(), bars.low(), bars.close(), bars.volume(), bars.size(), period, values.data());
+    return values;
+}
+
+QVector<double> computeRSI(const BarView& bars, int period)
+{
+    QVector<double> values(static_cast<int>(bars.size()));
+    rsiSeries(bars.close(), bars.size(), period, values.data());
+    // Lines skip values <= 0, so a flat or falling-only stretch is pinned just above zero
+    for (int i = period; i < values.size(); ++i) {
+        values[i] = std::max(1e-6, values[i]);
+    }
+    return values;
+}
+
+// ------------------------
+// OverlaySet
+// ------------------------
+
+int OverlaySet::add(const OverlaySpec& spec, bool enabled)
+{
+    Overlay overlay;
+    overlay.spec = spec;
+    overlay.enabled = enabled;
+    overlays_.push_back(std::move(overlay));
+    return count() - 1;
+}
+
+void OverlaySet::clear()
+{
+    overlays_.clear();
+}
+
+void OverlaySet::setEnabled(int index, bool enabled)
+{
+    overlays_[static_cast<std::size_t>(index)].enabled = enabled;
+}
+
+void OverlaySet::setBars(const BarView& bars)
+{
+    bars_ = bars;
+    for (Overlay& overlay : overlays_) {
+        overlay.computed = false;
+        overlay.lines.clear();
+    }
+}
+
+void OverlaySet::ensureComputed(Overlay& overlay)
+{
+    if (overlay.computed) {
+        return;
+    }
+    overlay.lines.clear();
+    const int period = overlay.spec.period;
+    switch (overlay.spec.kind) {
+    case OverlayKind::SMA:
+        overlay.lines.push_back(computeSMA(bars_, period));
+        break;
+    case OverlayKind::EMA:
+        overlay.lines.push_back(computeEMA(bars_, period));
+        break;
+    case OverlayKind::ADRBands: {
+        // Two ADRs either side of the SMA, the backtest's entry distance
+        QVector<double> mid = computeSMA(bars_, period);
+        QVector<double> adr = computeADR(bars_, period);
+        QVector<double> upper(mid.size(), 0.0);
+        QVector<double> lower(mid.size(), 0.0);
+        for (int i = 0; i < mid.size(); ++i) {
+            if (mid[i] > 0.0) {
+                upper[i] = mid[i] + 2.0 * adr[i];
+                lower[i] = mid[i] - 2.0 * adr[i];
+            }
+        }
+        overlay.lines.push_back(std::move(upper));
+        overlay.lines.push_back(std::move(mid));
+        overlay.lines.push_back(std::move(lower));
+        break;
+    }
+    case OverlayKind::VWAP:
+        overlay.lines.push_back(computeVWAP(bars_, period));
+        break;
+    case OverlayKind::RSI:
+        overlay.lines.push_back(computeRSI(bars_, period));
+        break;
+    case OverlayKind::ADR:
+        overlay.lines.push_back(computeADR(bars_, period));
+        break;
+    case OverlayKind::ATR:
+        overlay.lines.push_back(computeATR(bars_, period));
+        break;
+    case OverlayKind::Bollinger: {
+        // Two standard deviations either side of the SMA
+        const int count = static_cast<int>(bars_.size());
+        QVector<double> upper(count), middle(count), lower(count);
+        bollingerSeries(bars_.close(), bars_.size(), period, 2.0, middle.data(), upper.data(), lower.data());
+        overlay.lines.push_back(std::move(upper));
+        overlay.lines.push_back(std::move(middle));
+        overlay.lines.push_back(std::move(lower));
+        break;
+    }
+    case OverlayKind::Donchian: {
+        const int count = static_cast<int>(bars_.size());
+        QVector<double> upper(count), middle(count), lower(count);
+        rollingMaxSeries(bars_.high(), bars_.size(), period, upper.data());
+        rollingMinSeries(bars_.low(), bars_.size(), period, lower.data());
+        for (int i = 0; i < count; ++i) {
+            middle[i] = (upper[i] + lower[i]) / 2.0;
+        }
+        overlay.lines.push_back(std::move(upper));
+        overlay.lines.push_back(std::move(middle));
+        overlay.lines.push_back(std::move(lower));
+        break;
+    }
+    }
+    overlay.computed = true;
+}
+
+bool OverlaySet::valueRange(std::size_t first, std::size_t last, double& minValue, double& maxValue)
+{
+    minValue = DBL_MAX;
+    maxValue = -DBL_MAX;
+    for (Overlay& overlay : overlays_) {
+        if (!overlay.enabled || bars_.empty()) {
+            continue;
+        }
+        ensureComputed(overlay);
+        for (const QVector<double>& values : overlay.lines) {
+            const std::size_t end = std::min(last, static_cast<std::size_t>(values.size()));
+            for (std::size_t i = first; i < end; ++i) {
+                if (values[static_cast<int>(i)] > 0.0) {
+                    minValue = std::min(minValue, values[static_cast<int>(i)]);
+                    maxValue = std::max(maxValue, values[static_cast<int>(i)]);
+                }
+            }
+        }
+    }
+    return minValue <= maxValue;
+}
+
+void OverlaySet::paint(QPainter& painter, const ChartMapping& mapping, std::size_t stride)
+{
+    for (int i = 0; i < count(); ++i) {
+        if (overlays_[static_cast<std::size_t>(i)].enabled) {
+            paintOne(painter, i, mapping, stride);
+        }
+    }
+}
+
+void OverlaySet::paintOne(QPainter& painter, int index, const ChartMapping& mapping, std::size_t stride)
+{
+    Overlay& overlay = overlays_[static_cast<std::size_t>(index)];
+    if (bars_.empty()) {
+        return;
+    }
+    ensureComputed(overlay);
+
+    for (std::size_t line = 0; line < overlay.lines.size(); ++line) {
+        // Band edges are dashed so they read apart from the midline
+        const bool edge = overlay.lines.size() > 1 && line != overlay.lines.size() / 2;
+        QPen pen(overlay.spec.color, 1, edge ? Qt::DashLine : Qt::SolidLine);
+        const QVector<double>& values = overlay.lines[line];
+        paintSeriesLine(painter, mapping, values.constData(), static_cast<std::size_t>(values.size()), pen, stride);
+    }
+}
@@ -0,0 +1,77 @@
+#ifndef CHART_OVERLAYS_H
+#define CHART_OVERLAYS_H
+
+#include <QColor>
+#include <QPainter>
+#include <QString>
+#include <QVector>
+#include <cstddef>
+#include <vector>
+
+#include "bar_repository.h"
+#include "candle_renderer.h"
+
+enum class OverlayKind { SMA, EMA, ADRBands, VWAP, RSI, ADR, ATR, Bollinger, Donchian };
+
+struct OverlaySpec {
+    OverlayKind kind;
+    int period;
+    QColor color;
+};
+
+QString overlayName(const OverlaySpec& spec);
+
+// Indicator lines drawn over the candles. Buffers are computed the first time an overlay is shown
+// for a bar window and then reused for every repaint, pan and zoom until the window changes, so
+// enabling one overlay only computes that overlay.
+class OverlaySet
+{
+public:
+    // Returns the index of the new overlay.
+    int add(const OverlaySpec& spec, bool enabled = true);
+    void clear();
+
+    int count() const { return static_cast<int>(overlays_.size()); }
+    const OverlaySpec& spec(int index) const { return overlays_[static_cast<std::size_t>(index)].spec; }
+    bool isEnabled(int index) const { return overlays_[static_cast<std::size_t>(index)].enabled; }
+    void setEnabled(int index, bool enabled);
+
+    // Drops every cached buffer; enabled overlays are recomputed against bars on the next paint.
+    void setBars(const BarView& bars);
+
+    // Lowest and highest positive value of the enabled overlays over bars [first, last).
+    // Returns false if there is none.
+    bool valueRange(std::size_t first, std::size_t last, double& minValue, double& maxValue);
+
+    // Draws all enabled overlays, or just one. stride samples every stride-th bar when zoomed out.
+    void paint(QPainter& painter, const ChartMapping& mapping, std::size_t stride);
+    void paintOne(QPainter& painter, int index, const ChartMapping& mapping, std::size_t stride);
+
+private:
+    struct Overlay {
+        OverlaySpec spec;
+        bool enabled = true;
+        bool computed = false;
+        std::vector<QVector<double>> lines;   // one value per bar, <= 0 during warm-up
+    };
+
+    void ensureComputed(Overlay& overlay);
+
+    BarView bars_;
+    std::vector<Overlay> overlays_;
+};
+
+// One value per bar of bars; values before the first complete period are 0. Computed by the
+// shared kernels in indicator_kernels.h.
+QVector<double> computeSMA(const BarView& bars, int period);
+QVector<double> computeEMA(const BarView& bars, int period);
+// Average daily range (high - low), as used for the backtest's stops and targets
+QVector<double> computeADR(const BarView& bars, int period);
+// Wilder-smoothed average true range
+QVector<double> computeATR(const BarView& bars, int period);
+// Volume-weighted average of the typical price (high + low + close) / 3 over the last period bars
+QVector<double> computeVWAP(const BarView& bars, int period);
+// Wilder's relative strength index, 0..100
+QVector<double> computeRSI(const BarView& bars, int period);
+
+#endif // CHART_OVERLAYS_H
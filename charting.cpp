@@ -1,102 +1,137 @@
 #include "charting.h"
-#include <QVBoxLayout>
+#include "bar_repository.h"
+#include "database.h"
+#include "day_number.h"
+#include "profiler.h"
 #include <QPainter>
+#include <QPainterPath>
+#include <QPaintEvent>
+#include <QWheelEvent>
+#include <QCursor>
+#include <QContextMenuEvent>
+#include <QMenu>
+#include <QDebug>
 #include <cfloat>
 #include <QLocale>
+#include <QtConcurrent/QtConcurrentRun>
 #include <algorithm>
+#include <climits>
 #include <cmath>
 
+namespace {
+
+// Space reserved around the plot area for the axes
+constexpr int kRightAxisWidth = 64;
+constexpr int kBottomAxisHeight = 22;
+constexpr int kTopMargin = 8;
+constexpr int kLeftMargin = 8;
+
+// Vertical space between stacked panes
+constexpr int kPaneGap = 6;
+
+constexpr double kMinBarsVisible = 5.0;
+
+// Smallest page fetched when the view nears an edge of the loaded window, and the number of pages
+// the window may span before bars far from the viewport are dropped again.
+constexpr std::size_t kMinPageBars = 500;
+constexpr std::size_t kMaxWindowPages = 8;
+
+const QColor kBackground(16, 16, 16);
+const QColor kGridColor(68, 68, 68);
+
+// 1, 2 or 5 times a power of ten, at least raw
+double niceStep(double raw)
+{
+    if (raw <= 0.0) return 1.0;
+    double magnitude = std::pow(10.0, std::floor(std::log10(raw)));
+    double residual = raw / magnitude;
+    if (residual > 5.0) return 10.0 * magnitude;
+    if (residual > 2.0) return 5.0 * magnitude;
+    if (residual > 1.0) return 2.0 * magnitude;
+    return magnitude;
+}
+
+// Axis label; volume-sized values are shortened so they fit the axis strip
+QString axisLabel(double value, int decimals)
+{
+    const double magnitude = std::fabs(value);
+    if (magnitude >= 1e9) return QString::number(value / 1e9, 'f', 1) + "B";
+    if (magnitude >= 1e6) return QString::number(value / 1e6, 'f', 1) + "M";
+    if (magnitude >= 1e4) return QString::number(value / 1e3, 'f', 0) + "K";
+    return QString::number(value, 'f', decimals);
+}
+
+} // namespace
+
 // ----------------------------
 // CandlestickChart Implementation
 // ----------------------------
 CandlestickChart::CandlestickChart(QWidget *parent)
-    : QChartView(parent),
-    chart(new QChart()),
-    priceSeries(new QCandlestickSeries()),
-    volumeSeries(nullptr),
-    axisX(nullptr),
-    axisY(new QValueAxis()),
-    axisVolume(nullptr),
+    : QWidget(parent),
     tooltipLabel(new QLabel(this)),
-    db(nullptr),
     m_maxBars(120),
-    m_verticalLine(nullptr),
-    m_horizontalLine(nullptr),
+    m_loading(false),
+    m_viewFirst(0.0),
+    m_viewCount(1.0),
+    m_crosshairVisible(false),
+    m_hoverIndex(-1),
+    m_locale(QLocale::English, QLocale::UnitedStates),
     m_isDragging(false),
-    m_rubberBand(new QRubberBand(QRubberBand::Rectangle, this))
-{
-    // --- Chart Setup ---
-    // Enable caching on the chart to cache its rendered image
-    chart->setCacheMode(QGraphicsItem::DeviceCoordinateCache);
-    chart->addSeries(priceSeries);
-    chart->setAnimationOptions(QChart::NoAnimation);
-    setChart(chart);
-    setRenderHint(QPainter::Antialiasing);
-
-    // Enable caching for the QChartView background and smart viewport updates
-    setCacheMode(QGraphicsView::CacheBackground);
-    setViewportUpdateMode(QGraphicsView::SmartViewportUpdate);
-
-    // Dark background
-    QColor darkBackground(16, 16, 16);
-    chart->setBackgroundBrush(QBrush(darkBackground));
-    chart->setPlotAreaBackgroundBrush(QBrush(darkBackground));
-    chart->setDropShadowEnabled(false);
-
-    // --- Price Y-Axis Setup ---
-    axisY->setTitleText("Price");
-    axisY->setTitleBrush(QBrush(Qt::white));
-    axisY->setLabelsColor(Qt::white);
-    axisY->setLinePen(QPen(Qt::white));
-    axisY->setGridLinePen(QPen(QColor(68, 68, 68)));
-    chart->addAxis(axisY, Qt::AlignRight);
-    priceSeries->attachAxis(axisY);
-
-    // --- Candlestick Series Appearance ---
-    priceSeries->setBodyWidth(0.4);
-    priceSeries->setIncreasingColor(QColor(0, 197, 49));
-    priceSeries->setDecreasingColor(QColor(255, 95, 95));
-    chart->legend()->setVisible(false);
+    m_rubberBand(new QRubberBand(QRubberBand::Rectangle, this)),
+    m_isPanning(false),
+    m_panStartFirst(0.0),
+    m_hasOlder(false),
+    m_hasNewer(false),
+    m_pagePending(false),
+    m_pageOlder(false),
+    m_pageCount(0),
+    m_loadGeneration(0),
+    m_pageGeneration(0),
+    m_pageWatcher(new QFutureWatcher<std::shared_ptr<BarSeries>>(this)),
+    m_loadWatcher(new QFutureWatcher<WindowLoad>(this)),
+    m_latestLoad(std::make_shared<std::atomic<std::uint64_t>>(0))
+{
+    setAttribute(Qt::WA_OpaquePaintEvent);
+    setSizePolicy(QSizePolicy::Expanding, QSizePolicy::Expanding);
+    setMinimumSize(200, 150);
 
     // --- Tooltip Setup ---
-    connect(priceSeries, &QCandlestickSeries::hovered,
-            this, &CandlestickChart::handleHovered);
     tooltipLabel->setStyleSheet("background-color: black; color: white; border: 1px solid white; padding: 5px;");
     tooltipLabel->setWindowFlags(Qt::ToolTip);
     tooltipLabel->hide();
 
     // --- Crosshair Setup ---
     setMouseTracking(true);
-    m_verticalLine = new QGraphicsLineItem(chart);
-    m_horizontalLine = new QGraphicsLineItem(chart);
-
-    QPen crosshairPen(Qt::white, 1, Qt::DashLine);
-    m_verticalLine->setPen(crosshairPen);
-    m_horizontalLine->setPen(crosshairPen);
-
-    // Put them in front of other chart items
-    m_verticalLine->setZValue(999);
-    m_horizontalLine->setZValue(999);
-
-    // Initially hide them (will appear on mouse over).
-    m_verticalLine->hide();
-    m_horizontalLine->hide();
 
     // Initialize rubber band for zoom selection (hidden by default)
     m_rubberBand->hide();
-}
 
-CandlestickChart::~CandlestickChart() {
-    dataCache.clear();
-    if (axisVolume) {
-        chart->removeAxis(axisVolume);
-        delete axisVolume;
-    }
+    connect(m_pageWatcher, &QFutureWatcher<std::shared_ptr<BarSeries>>::finished, this,
+            &CandlestickChart::onPageLoaded);
+    connect(m_loadWatcher, &QFutureWatcher<WindowLoad>::finished, this, &CandlestickChart::onTickerLoaded);
+
+    // --- Pane Setup ---
+    ChartPane price;
+    price.kind = PaneKind::Price;
+    price.weight = 3.0;
+    price.overlays.add({OverlayKind::SMA, 10, Qt::cyan});
+    price.overlays.add({OverlayKind::SMA, 20, Qt::red});
+    price.overlays.add({OverlayKind::SMA, 50, Qt::green});
+    price.overlays.add({OverlayKind::EMA, 21, Qt::yellow}, false);
+    price.overlays.add({OverlayKind::ADRBands, 14, Qt::magenta}, false);
+    price.overlays.add({OverlayKind::VWAP, 20, QColor(255, 165, 0)}, false);
+    price.overlays.add({OverlayKind::Bollinger, 20, QColor(144, 202, 249)}, false);
+    price.overlays.add({OverlayKind::Donchian, 20, QColor(255, 241, 118)}, false);
+    m_panes.push_back(std::move(price));
+
+    ChartPane volume;
+    volume.kind = PaneKind::Volume;
+    volume.weight = 1.0;
+    m_panes.push_back(std::move(volume));
 }
 
-// Set DB and required functions
-void CandlestickChart::setDatabase(sqlite3* dbPtr) {
-    db = dbPtr;
+CandlestickChart::~CandlestickChart() {
+    dataCache = BarView();
 }
 
 void CandlestickChart::setMaxBars(int maxBars) {
@@ -106,12 +141,16 @@ void CandlestickChart::setMaxBars(int maxBars) {
 bool CandlestickChart::shouldReload(const QString &ticker, bool forceReload)
 {
     // Always reload if the ticker is different.
-    if (ticker != currentTicker) {
+    if (ticker != m_requestedTicker) {
         return true;
     }
+    // Same ticker still loading: let that load finish.
+    if (m_loading && !forceReload) {
+        return false;
+    }
     // If the ticker is the same and no forced reload, just reset the zoom.
-    if (!dataCache.isEmpty() && !forceReload) {
-        chart->zoomReset();
+    if (!dataCache.empty() && !forceReload) {
+        resetViewport();
         return false;
     }
     return true;
@@ -119,315 +158,748 @@ bool CandlestickChart::shouldReload(const QString &ticker, bool forceReload)
 
 void CandlestickChart::resetChart()
 {
-    // Clear the candlestick series data
-    priceSeries->clear();
-    dataCache.clear();
-
-    // Remove & delete old volume series
-    if (volumeSeries) {
-        chart->removeSeries(volumeSeries);
-        delete volumeSeries;
-        volumeSeries = nullptr;
+    dataCache = BarView();
+    fullData = BarView();
+    m_lod = BarPyramid();
+    updateMemoryCharge();
+    m_hasOlder = m_hasNewer = false;
+    m_pagePending = false;      // a page still in flight is dropped by the generation check
+    m_loadGeneration++;
+    m_latestLoad->store(m_loadGeneration);
+    for (ChartPane &pane : m_panes) {
+        pane.overlays.setBars(BarView());
     }
+    invalidateCache();
+}
 
-    for (QLineSeries* sma : std::as_const(m_smaLines)) {
-        chart->removeSeries(sma);
-        delete sma;
+// Query and Organize Data. Runs on the thread pool; touches no member state.
+CandlestickChart::WindowLoad CandlestickChart::queryTickerData(const std::string &ticker, std::size_t wanted)
+{
+    BTE_PROFILE_SCOPE("CandlestickChart::queryTickerData");
+    WindowLoad result;
+
+    // A history the repository already holds is sliced instead of queried again
+    result.fullData = BarRepository::instance().peek(ticker);
+    if (!result.fullData.empty()) {
+        result.window = result.fullData.last(wanted);
+        result.hasOlder = result.window.size() < result.fullData.size();
+        return result;
     }
-    m_smaLines.clear();
-    clearPriceLevelLines();
 
-    // Remove & delete old axes
-    if (axisX) {
-        chart->removeAxis(axisX);
-        delete axisX;
-        axisX = nullptr;
-    }
-    if (axisVolume) {
-        chart->removeAxis(axisVolume);
-        delete axisVolume;
-        axisVolume = nullptr;
+    DbLease db = Database::instance().reader();
+    if (!db) {
+        return result;
     }
+    std::shared_ptr<BarSeries> page = BarRepository::loadPage(*db, ticker, INT_MAX, wanted, true);
+    result.hasOlder = page->size() == wanted;
+    result.window = BarView(std::move(page));
+    return result;
 }
 
-// Query and Organize Data
-bool CandlestickChart::queryTickerData(const QString &ticker, QVector<CandleData> &outData)
+void CandlestickChart::updateDataCache(const BarView &window)
 {
-    if (!db) {
-        qWarning() << "Database not set. Call setDatabase() before loading a ticker.";
-        return false;
-    }
+    currentTicker.clear();  // We'll set it again after we confirm success.
 
-    // Prepare statement
-    const std::string querySQL =
-        "SELECT open, high, low, close, volume, date "
-        "FROM Stocks "
-        "WHERE ticker = ? "
-        "ORDER BY date ASC;";
-    sqlite3_stmt* stmt = nullptr;
+    if (window.empty()) {
+        return; // No data to process
+    }
 
-    if (sqlite3_prepare_v2(db, querySQL.c_str(), -1, &stmt, nullptr) != SQLITE_OK) {
-        qWarning() << "Error preparing query:" << sqlite3_errmsg(db);
-        return false;
+    dataCache = window;
+    m_lod = BarPyramid(dataCache);
+    updateMemoryCharge();
+    for (ChartPane &pane : m_panes) {
+        pane.overlays.setBars(dataCache);
     }
+}
 
-    QByteArray tickerBytes = ticker.toUtf8();
-    sqlite3_bind_text(stmt, 1, tickerBytes.constData(), -1, SQLITE_STATIC);
+// Bars the chart holds itself (a window the repository does not cache), its merged levels and
+// its pixmaps
+void CandlestickChart::updateMemoryCharge()
+{
+    std::size_t bytes = m_lod.bytes();
+    if (fullData.empty() && dataCache.series()) {
+        bytes += dataCache.series()->bytes();
+    }
+    for (const QPixmap *pixmap : {&m_cachedPixmap, &m_overlayPixmap}) {
+        bytes += static_cast<std::size_t>(pixmap->width()) * pixmap->height() * pixmap->depth() / 8;
+    }
+    m_memory.set(bytes);
+}
 
-    // Fetch data
-    QVector<CandleData> tempData;
-    while (sqlite3_step(stmt) == SQLITE_ROW) {
-        CandleData cd;
-        cd.open   = sqlite3_column_double(stmt, 0);
-        cd.high   = sqlite3_column_double(stmt, 1);
-        cd.low    = sqlite3_column_double(stmt, 2);
-        cd.close  = sqlite3_column_double(stmt, 3);
-        cd.volume = sqlite3_column_double(stmt, 4);
+// --- Overlays ---
 
-        const unsigned char* dateChars = sqlite3_column_text(stmt, 5);
-        if (!dateChars) continue;
-        QString dateString = QString::fromUtf8(reinterpret_cast<const char*>(dateChars));
-        QDateTime dt = QDateTime::fromString(dateString, "yyyy-MM-dd");
-        if (!dt.isValid()) continue;
-        cd.timestamp = dt.toMSecsSinceEpoch();
+int CandlestickChart::addOverlay(const OverlaySpec &spec, bool enabled)
+{
+    int index = m_panes[0].overlays.add(spec, false);
+    setOverlayEnabled(index, enabled);
+    return index;
+}
 
-        tempData.append(cd);
+void CandlestickChart::setOverlayEnabled(int index, bool enabled)
+{
+    ChartPane &price = m_panes[0];
+    if (index < 0 || index >= price.overlays.count() || price.overlays.isEnabled(index) == enabled) {
+        return;
     }
-    sqlite3_finalize(stmt);
+    price.overlays.setEnabled(index, enabled);
+
+    if (enabled && !price.overlayDirty && !m_cacheDirty && !m_overlayPixmap.isNull()) {
+        // Draw just the new overlay on top of the ones already in the layer
+        QPainter painter(&m_overlayPixmap);
+        painter.setClipRect(price.mapping.area);
+        painter.setRenderHint(QPainter::Antialiasing, true);
+        price.overlays.paintOne(painter, index, price.mapping, static_cast<std::size_t>(m_cachedLodFactor));
+        update(paneRect(price));
+    } else {
+        invalidatePane(price);
+    }
+}
 
-    outData = tempData;
-    return true;
+void CandlestickChart::setTradeMarkers(std::shared_ptr<const TradeMarkerIndex> markers)
+{
+    m_tradeMarkers = std::move(markers);
+    m_hoverIndex = -1;
+    invalidatePane(m_panes[0]);
 }
 
-void CandlestickChart::updateDataCache(const QVector<CandleData> &allData)
+int CandlestickChart::addIndicatorPane(const OverlaySpec &spec)
 {
-    currentTicker.clear();  // We'll set it again after we confirm success.
+    ChartPane pane;
+    pane.kind = PaneKind::Indicator;
+    pane.weight = 1.0;
+    pane.overlays.add(spec);
+    pane.overlays.setBars(dataCache);
+    m_panes.push_back(std::move(pane));
+
+    // Every band moves, so the whole chart is laid out and rendered again
+    layoutPanes();
+    invalidateCache();
+    return static_cast<int>(m_panes.size()) - 1;
+}
 
-    // Keep only the most recent m_maxBars entries.
-    int total = allData.size();
-    if (total <= 0) {
-        return; // No data to process
+void CandlestickChart::removePane(int index)
+{
+    if (index < 2 || index >= static_cast<int>(m_panes.size())) {
+        return;
+    }
+    m_panes.erase(m_panes.begin() + index);
+    layoutPanes();
+    invalidateCache();
+}
+
+// Main loading function
+void CandlestickChart::loadTicker(const QString &ticker, bool forceReload)
+{
+    BTE_PROFILE_SCOPE("CandlestickChart::loadTicker");
+    // 1) Decide if we need to reload
+    if (!shouldReload(ticker, forceReload)) {
+        return; // just reset zoom if needed (in shouldReload)
     }
 
-    QVector<CandleData> trimmedData = allData;
-    if (total > m_maxBars) {
-        trimmedData = allData.mid(total - m_maxBars, m_maxBars);
+    // 2) Reset everything; this also supersedes any load still in flight. Price levels belong to
+    // the ticker, so a reload of the same one (e.g. back to the latest bars) keeps them.
+    if (ticker != m_requestedTicker) {
+        clearPriceLevelLines();
+    }
+    resetChart();
+    currentTicker.clear();
+    m_symbol.clear();
+    m_requestedTicker = ticker;
+
+    if (!Database::instance().isOpen()) {
+        qWarning() << "Database is not open.";
+        m_loading = false;
+        update();
+        return;
     }
 
-    dataCache = trimmedData;
+    // 3) Query the most recent m_maxBars bars plus one page of margin for panning back
+    const std::string symbol = ticker.toStdString();
+    const std::size_t wanted = static_cast<std::size_t>(std::max(m_maxBars, 1)) + kMinPageBars;
+    const std::uint64_t generation = m_loadGeneration;
+    std::shared_ptr<std::atomic<std::uint64_t>> latest = m_latestLoad;
+
+    m_loading = true;
+    m_loadWatcher->setFuture(QtConcurrent::run([symbol, wanted, generation, latest]() {
+        // Skip the query entirely if another ticker was requested while this one was queued
+        WindowLoad result = latest->load() == generation ? queryTickerData(symbol, wanted) : WindowLoad();
+        result.generation = generation;
+        return result;
+    }));
 }
 
-void CandlestickChart::setupCandleSeries()
+void CandlestickChart::onTickerLoaded()
 {
-    // 1) Price range
-    double minPrice = DBL_MAX;
-    double maxPrice = -DBL_MAX;
-    for (const CandleData &cd : std::as_const(dataCache)) {
-        minPrice = std::min(minPrice, cd.low);
-        maxPrice = std::max(maxPrice, cd.high);
+    BTE_PROFILE_SCOPE("CandlestickChart::onTickerLoaded");
+    WindowLoad result = m_loadWatcher->result();
+    if (result.generation != m_loadGeneration) {
+        return; // superseded by a newer loadTicker call
     }
-    if (minPrice == DBL_MAX || maxPrice == -DBL_MAX) {
-        // No valid data
+    m_loading = false;
+
+    // 4) Update the dataCache with the results
+    updateDataCache(result.window);
+    if (dataCache.empty()) {
+        qWarning() << "No data returned for ticker:" << m_requestedTicker;
+        invalidateCache();
         return;
     }
+    fullData = result.fullData;
+    updateMemoryCharge();    // the window is the repository's when fullData is set
+    m_hasOlder = result.hasOlder;
+    m_hasNewer = false;
+    currentTicker = m_requestedTicker; // we have valid data now
+    m_symbol = currentTicker.toStdString();
+
+    // 5) Show the most recent m_maxBars bars; the rest of the window is panning margin
+    resetViewport();
+    invalidateCache();
+}
 
-    // 2) Create Candlestick Sets
-    QVector<QCandlestickSet*> setList;
-    for (int i = 0; i < dataCache.size(); ++i) {
-        const CandleData &cd = dataCache[i];
-        setList.append(new QCandlestickSet(cd.open, cd.high, cd.low, cd.close, i));
+// --- Viewport ---
+
+void CandlestickChart::resetViewport()
+{
+    if (m_hasNewer) {
+        // Panned far enough back that the latest bars were dropped from the window
+        loadTicker(currentTicker, true);
+        return;
     }
-    priceSeries->append(setList);
+    const double total = static_cast<double>(dataCache.size());
+    const double count = std::max(std::min(static_cast<double>(std::max(m_maxBars, 1)), total), kMinBarsVisible);
+    setViewport(total - count, count);
+}
 
-    // 3) Create Category X-Axis
-    QStringList categories;
-    for (int i = 0; i < dataCache.size(); ++i) {
-        categories << QString::number(i);
+void CandlestickChart::setViewport(double firstBar, double barsVisible)
+{
+    const double total = static_cast<double>(dataCache.size());
+    barsVisible = std::clamp(barsVisible, kMinBarsVisible, std::max(total, kMinBarsVisible));
+    firstBar = std::clamp(firstBar, 0.0, std::max(0.0, total - barsVisible));
+
+    if (firstBar == m_viewFirst && barsVisible == m_viewCount) {
+        return;
     }
-    axisX = new QBarCategoryAxis();
-    axisX->append(categories);
-    axisX->setTitleText("Index");
-    axisX->setLabelsColor(Qt::white);
-    axisX->setLinePen(QPen(Qt::white));
-    axisX->setGridLinePen(Qt::NoPen);
-    chart->addAxis(axisX, Qt::AlignBottom);
-    priceSeries->attachAxis(axisX);
+    m_viewFirst = firstBar;
+    m_viewCount = barsVisible;
+    invalidateCache();
+    prefetchIfNearEdge();
+}
+
+// --- Windowed paging ---
 
-    // 4) Set Price Y-Axis range
-    axisY->setRange(minPrice * 0.99, maxPrice * 1.01);
+// Pages cover a couple of screens so a steady pan only triggers a fetch every so often
+std::size_t CandlestickChart::pageSize() const
+{
+    return std::max(kMinPageBars, static_cast<std::size_t>(m_viewCount * 2.0));
 }
 
-void CandlestickChart::setupVolumeSeries()
+// Starts fetching the next page once less than one screen of loaded bars is left beyond the view
+void CandlestickChart::prefetchIfNearEdge()
 {
-    volumeSeries = new QBarSeries();
-    QBarSet *volSet = new QBarSet("Volume");
+    if (m_pagePending || dataCache.empty()) {
+        return;
+    }
+    const double total = static_cast<double>(dataCache.size());
+    if (m_hasOlder && m_viewFirst < m_viewCount) {
+        requestPage(true);
+    } else if (m_hasNewer && total - (m_viewFirst + m_viewCount) < m_viewCount) {
+        requestPage(false);
+    }
+}
 
-    QColor volumeColor(0, 0, 255, 128); // Blue with 50% transparency
-    volSet->setBrush(volumeColor);
-    volSet->setBorderColor(Qt::transparent);
+void CandlestickChart::requestPage(bool older)
+{
+    const std::size_t count = pageSize();
+
+    if (!fullData.empty()) {
+        // Whole history is resident: widen the slice, no query needed
+        const std::size_t windowFirst = dataCache.offset() - fullData.offset();
+        const std::size_t windowEnd = windowFirst + dataCache.size();
+        if (older) {
+            const std::size_t take = std::min(count, windowFirst);
+            applyPage(true, fullData.slice(windowFirst - take, take), windowFirst > take);
+        } else {
+            const std::size_t take = std::min(count, fullData.size() - windowEnd);
+            applyPage(false, fullData.slice(windowEnd, take), windowEnd + take < fullData.size());
+        }
+        return;
+    }
 
-    double maxVolume = 0.0;
-    for (int i = 0; i < dataCache.size(); ++i) {
-        double scaledVolume = dataCache[i].volume / 4.0; // scale for display
-        *volSet << scaledVolume;
-        maxVolume = std::max(maxVolume, dataCache[i].volume);
+    const std::string symbol = m_symbol;
+    const int boundary = older ? dataCache.day()[0] : dataCache.day()[dataCache.size() - 1];
+    m_pagePending = true;
+    m_pageOlder = older;
+    m_pageCount = count;
+    m_pageGeneration = m_loadGeneration;
+    m_pageWatcher->setFuture(QtConcurrent::run([symbol, boundary, count, older]() {
+        DbLease db = Database::instance().reader();
+        return db ? BarRepository::loadPage(*db, symbol, boundary, count, older) : std::make_shared<BarSeries>();
+    }));
+}
+
+void CandlestickChart::onPageLoaded()
+{
+    if (!m_pagePending || m_pageGeneration != m_loadGeneration) {
+        return; // ticker changed while the page was loading
     }
-    volumeSeries->append(volSet);
-    chart->addSeries(volumeSeries);
-    volumeSeries->attachAxis(axisX);
+    m_pagePending = false;
 
-    // Volume Y-axis
-    axisVolume = new QValueAxis();
-    axisVolume->setRange(0, maxVolume * 1.1);
-    axisVolume->setTitleText("Volume");
-    axisVolume->setTitleBrush(QBrush(Qt::white));
-    axisVolume->setLabelsColor(Qt::white);
-    axisVolume->setLinePen(QPen(Qt::white));
-    axisVolume->setGridLinePen(QPen(QColor(68, 68, 68)));
-    axisVolume->setLabelsVisible(false);
-    axisVolume->setLabelFormat("%.0f");
-    chart->addAxis(axisVolume, Qt::AlignLeft);
-    volumeSeries->attachAxis(axisVolume);
+    std::shared_ptr<BarSeries> page = m_pageWatcher->result();
+    const bool more = page->size() == m_pageCount;
+    if (page->size() == 0 || dataCache.empty()) {
+        (m_pageOlder ? m_hasOlder : m_hasNewer) = false;
+        return;
+    }
+    // Guard against the window having moved since the request was made
+    if (m_pageOlder ? page->day.back() >= dataCache.day()[0]
+                    : page->day.front() <= dataCache.day()[dataCache.size() - 1]) {
+        prefetchIfNearEdge();
+        return;
+    }
+    applyPage(m_pageOlder, BarView(std::move(page)), more);
 }
 
-void CandlestickChart::setupAxesAndReorderSeries()
+// Joins page onto one end of the window, drops the far end if the window outgrew its cap and
+// shifts the viewport so the bars on screen stay put.
+void CandlestickChart::applyPage(bool older, const BarView &page, bool more)
 {
-    // Remove then add them back in the order we want (volume behind candlesticks)
-    chart->removeSeries(volumeSeries);
-    chart->removeSeries(priceSeries);
+    (older ? m_hasOlder : m_hasNewer) = more;
+    if (page.empty()) {
+        return;
+    }
 
-    chart->addSeries(volumeSeries);
-    chart->addSeries(priceSeries);
+    BarView merged;
+    if (!fullData.empty()) {
+        const std::size_t first = older ? page.offset() : dataCache.offset();
+        merged = fullData.slice(first - fullData.offset(), dataCache.size() + page.size());
+    } else {
+        const BarView &head = older ? page : dataCache;
+        const BarView &tail = older ? dataCache : page;
+        auto series = std::make_shared<BarSeries>();
+        series->ticker = dataCache.ticker();
+        series->reserve(head.size() + tail.size());
+        for (const BarView *part : {&head, &tail}) {
+            const std::size_t n = part->size();
+            series->day.insert(series->day.end(), part->day(), part->day() + n);
+            series->open.insert(series->open.end(), part->open(), part->open() + n);
+            series->high.insert(series->high.end(), part->high(), part->high() + n);
+            series->low.insert(series->low.end(), part->low(), part->low() + n);
+            series->close.insert(series->close.end(), part->close(), part->close() + n);
+            series->volume.insert(series->volume.end(), part->volume(), part->volume() + n);
+        }
+        merged = BarView(std::move(series));
+    }
 
-    priceSeries->attachAxis(axisX);
-    priceSeries->attachAxis(axisY);
-    volumeSeries->attachAxis(axisX);
-    volumeSeries->attachAxis(axisVolume);
+    double shift = older ? static_cast<double>(page.size()) : 0.0;
+    const std::size_t cap = kMaxWindowPages * pageSize();
+    if (merged.size() > cap) {
+        if (older) {
+            merged = merged.slice(0, cap);
+            m_hasNewer = true;
+        } else {
+            const std::size_t excess = merged.size() - cap;
+            merged = merged.slice(excess, cap);
+            shift -= static_cast<double>(excess);
+            m_hasOlder = true;
+        }
+    }
+
+    dataCache = merged;
+    m_lod = BarPyramid(dataCache);
+    updateMemoryCharge();
+    for (ChartPane &pane : m_panes) {
+        pane.overlays.setBars(dataCache);
+    }
+    m_viewFirst += shift;
+    m_panStartFirst += shift;
+    invalidateCache();
+    prefetchIfNearEdge();
 }
 
-// Set up Moving Averages
-QVector<double> computeSMA(const QVector<CandleData>& data, int period)
+QRectF CandlestickChart::plotArea() const
 {
-    QVector<double> smaValues;
-    smaValues.resize(data.size());
+    return QRectF(kLeftMargin, kTopMargin,
+                  std::max(1, width() - kLeftMargin - kRightAxisWidth),
+                  std::max(1, height() - kTopMargin - kBottomAxisHeight));
+}
 
-    if (data.size() < period || period <= 0) {
-        // handle edge cases
-        return smaValues;
-    }
+// Horizontal mapping only; enough for pixel <-> bar lookups and free of any scan over the bars
+ChartMapping CandlestickChart::barMapping() const
+{
+    ChartMapping mapping;
+    mapping.area = plotArea();
+    mapping.firstBar = m_viewFirst;
+    mapping.barsVisible = m_viewCount;
+    return mapping;
+}
+
+// --- Panes ---
 
-    double runningSum = 0.0;
-    for (int i = 0; i < period; ++i) {
-        runningSum += data[i].close;
+// Splits the plot area between the panes by weight, top to bottom
+void CandlestickChart::layoutPanes()
+{
+    const QRectF area = plotArea();
+    double totalWeight = 0.0;
+    for (const ChartPane &pane : m_panes) {
+        totalWeight += pane.weight;
+    }
+    const double gaps = kPaneGap * static_cast<double>(m_panes.size() - 1);
+    const double unit = std::max(0.0, area.height() - gaps) / totalWeight;
+
+    double top = area.top();
+    for (ChartPane &pane : m_panes) {
+        const double height = std::max(1.0, pane.weight * unit);
+        pane.area = QRectF(area.left(), top, area.width(), height);
+        top += height + kPaneGap;
     }
+}
 
-    // first 'period' values
-    for (int i = 0; i < period; ++i) {
-        if (i < period - 1) {
-            smaValues[i] = 0;
-        } else {
-            smaValues[i] = runningSum / period;
+int CandlestickChart::paneAt(const QPoint &pos) const
+{
+    for (std::size_t i = 0; i < m_panes.size(); ++i) {
+        if (m_panes[i].area.contains(pos)) {
+            return static_cast<int>(i);
         }
     }
+    return -1;
+}
+
+// Band of the widget owned by pane: its plot area, its axis strip and half the gap either side
+QRect CandlestickChart::paneRect(const ChartPane &pane) const
+{
+    const int top = static_cast<int>(std::floor(pane.area.top())) - kPaneGap / 2;
+    const int bottom = static_cast<int>(std::ceil(pane.area.bottom())) + kPaneGap / 2;
+    return QRect(0, top, width(), bottom - top);
+}
+
+// Redraws pane's overlays (and trade markers) only; its candles and axis stay cached
+void CandlestickChart::invalidatePane(ChartPane &pane)
+{
+    pane.overlayDirty = true;
+    update(paneRect(pane));
+}
 
-    // sliding window
-    for (int i = period; i < data.size(); ++i) {
-        runningSum += data[i].close;
-        runningSum -= data[i - period].close;
-        smaValues[i] = runningSum / period;
+ChartMapping CandlestickChart::paneMapping(ChartPane &pane) const
+{
+    ChartMapping mapping;
+    mapping.area = pane.area;
+    mapping.firstBar = m_viewFirst;
+    mapping.barsVisible = m_viewCount;
+    if (m_lod.levelCount() == 0) {
+        return mapping;
     }
 
-    return smaValues;
+    // Fit the value axis to the bars currently on screen. Merged buckets keep the true extremes
+    // and summed volume, so the level being drawn gives the range at a fraction of the cost.
+    const int level = lodLevel();
+    const BarView &bars = m_lod.level(level);
+    std::size_t first, last;
+    mapping.coarsened(1 << level).visibleRange(bars.size(), first, last);
+
+    switch (pane.kind) {
+    case PaneKind::Price: {
+        double minPrice, maxPrice;
+        if (visiblePriceRange(bars, first, last, minPrice, maxPrice) && maxPrice > minPrice) {
+            mapping.minValue = minPrice * 0.99;
+            mapping.maxValue = maxPrice * 1.01;
+        } else if (first < last) {
+            mapping.minValue = minPrice * 0.99;
+            mapping.maxValue = maxPrice * 1.01 + 1.0;
+        }
+        break;
+    }
+    case PaneKind::Volume:
+        mapping.minValue = 0.0;
+        mapping.maxValue = std::max(1.0, visibleVolumeMax(bars, first, last) * 1.05);
+        break;
+    case PaneKind::Indicator: {
+        if (pane.overlays.count() > 0 && pane.overlays.spec(0).kind == OverlayKind::RSI) {
+            mapping.minValue = 0.0;
+            mapping.maxValue = 100.0;
+            break;
+        }
+        // Indicator buffers are full resolution
+        std::size_t barFirst, barLast;
+        mapping.visibleRange(dataCache.size(), barFirst, barLast);
+        double minValue, maxValue;
+        if (pane.overlays.valueRange(barFirst, barLast, minValue, maxValue)) {
+            const double pad = std::max((maxValue - minValue) * 0.05, 1e-6);
+            mapping.minValue = minValue - pad;
+            mapping.maxValue = maxValue + pad;
+        }
+        break;
+    }
+    }
+    return mapping;
 }
 
-void CandlestickChart::createMovingAverageLine(int period, const QColor &color)
+// Pyramid level to draw: the finest one whose buckets are at least a few pixels wide
+int CandlestickChart::lodLevel() const
 {
-    if (dataCache.isEmpty()) return;
+    return m_lod.levelFor(plotArea().width() / m_viewCount);
+}
 
-    QVector<double> smaValues = computeSMA(dataCache, period);
+void CandlestickChart::invalidateCache()
+{
+    m_cacheDirty = true;
+    m_hoverIndex = -1;      // bar indices may have shifted
+    update();
+}
 
-    // Create a QLineSeries for SMA
-    QLineSeries* smaSeries = new QLineSeries();
-    smaSeries->setName(QString("SMA %1").arg(period));
+// --- Rendering ---
 
-    // Append data: x-values will match candlestick indices
-    for (int i = 0; i < dataCache.size(); ++i) {
-        if (smaValues[i] > 0.0) {
-            smaSeries->append(i, smaValues[i]);
+void CandlestickChart::renderStaticLayer()
+{
+    const qreal ratio = devicePixelRatioF();
+    const QSize pixelSize = size() * ratio;
+    if (m_cachedPixmap.size() != pixelSize) {
+        m_cachedPixmap = QPixmap(pixelSize);
+        m_overlayPixmap = QPixmap(pixelSize);
+        updateMemoryCharge();
+    }
+    m_cachedPixmap.setDevicePixelRatio(ratio);
+    m_overlayPixmap.setDevicePixelRatio(ratio);
+    m_cachedPixmap.fill(kBackground);
+    m_overlayPixmap.fill(Qt::transparent);
+    layoutPanes();
+
+    QPainter painter(&m_cachedPixmap);
+    if (dataCache.empty()) {
+        painter.setPen(Qt::gray);
+        painter.drawText(rect(), Qt::AlignCenter,
+                         m_loading ? QString("Loading %1...").arg(m_requestedTicker) : QString("No data"));
+        for (ChartPane &pane : m_panes) {
+            pane.mapping = ChartMapping();
+            pane.overlayDirty = false;
         }
+        m_cacheDirty = false;
+        return;
     }
 
-    // Add it to the chart and attach to the axes
-    chart->addSeries(smaSeries);
-    smaSeries->attachAxis(axisX);
-    smaSeries->attachAxis(axisY);
+    // Zoomed out, draw one merged candle per few pixels instead of every bar
+    m_cachedLodFactor = 1 << lodLevel();
 
-    // Adjust style
-    QPen smaPen(color);
-    smaPen.setWidth(1);
-    smaSeries->setPen(smaPen);
+    // All panes share the X viewport, so one date axis under the bottom pane serves them all
+    paintDateAxis(painter, barMapping());
+    for (ChartPane &pane : m_panes) {
+        renderPane(painter, pane);
+    }
+    m_cacheDirty = false;
+}
+
+void CandlestickChart::renderPane(QPainter &painter, ChartPane &pane)
+{
+    pane.mapping = paneMapping(pane);
+    const ChartMapping &mapping = pane.mapping;
+    const int factor = m_cachedLodFactor;
+    const BarView &bars = m_lod.level(lodLevel());
+
+    painter.save();
+    painter.setClipRect(paneRect(pane));
+    paintValueAxis(painter, mapping);
+
+    painter.save();
+    painter.setClipRect(mapping.area);
+    if (pane.kind == PaneKind::Price) {
+        paintCandles(painter, mapping.coarsened(factor), bars, m_style);
+    } else if (pane.kind == PaneKind::Volume) {
+        paintVolume(painter, mapping.coarsened(factor), bars, m_style);
+    }
+    painter.restore();
+
+    if (pane.kind == PaneKind::Indicator && pane.overlays.count() > 0) {
+        painter.setPen(Qt::gray);
+        painter.drawText(mapping.area.adjusted(4, 2, -4, -2), Qt::AlignLeft | Qt::AlignTop,
+                         overlayName(pane.overlays.spec(0)));
+    }
+    painter.setPen(QPen(Qt::white));
+    painter.drawLine(mapping.area.topRight(), mapping.area.bottomRight());
+    painter.drawLine(mapping.area.bottomLeft(), mapping.area.bottomRight());
+    painter.restore();
 
-    // Store the SMA line pointer for later removal
-    m_smaLines.append(smaSeries);
+    pane.overlayDirty = true;
 }
 
-// Main loading function
-void CandlestickChart::loadTicker(const QString &ticker, bool forceReload)
+// Overlays get their own transparent layer so toggling one doesn't redraw the candles. Only the
+// bands of panes marked dirty are cleared and repainted.
+void CandlestickChart::renderOverlayLayer()
 {
-    // 2) Reset everything
-    resetChart();
+    if (m_overlayPixmap.isNull()) return;
+
+    QPainter painter(&m_overlayPixmap);
+    for (ChartPane &pane : m_panes) {
+        if (!pane.overlayDirty) continue;
+
+        const QRect band = paneRect(pane);
+        painter.setCompositionMode(QPainter::CompositionMode_Source);
+        painter.fillRect(band, Qt::transparent);
+        painter.setCompositionMode(QPainter::CompositionMode_SourceOver);
+
+        if (!dataCache.empty()) {
+            painter.save();
+            painter.setClipRect(pane.mapping.area);
+            painter.setRenderHint(QPainter::Antialiasing, true);
+            pane.overlays.paint(painter, pane.mapping, static_cast<std::size_t>(m_cachedLodFactor));
+            if (pane.kind == PaneKind::Price) {
+                paintTradeMarkers(painter);
+            }
+            painter.restore();
+        }
+        pane.overlayDirty = false;
+    }
+}
 
-    // 1) Decide if we need to reload
-    if (!shouldReload(ticker, forceReload)) {
-        return; // just reset zoom if needed (in shouldReload)
+// Triangles at the fill price: entries point up from below, exits point down from above
+void CandlestickChart::paintTradeMarkers(QPainter &painter)
+{
+    if (!m_tradeMarkers) return;
+
+    const ChartMapping &mapping = m_panes[0].mapping;
+    std::size_t first, last;
+    mapping.visibleRange(dataCache.size(), first, last);
+    if (first >= last) return;
+
+    const int *day = dataCache.day();
+    TradeMarkerIndex::Range markers = m_tradeMarkers->range(m_symbol, day[first], day[last - 1]);
+    if (markers.first == markers.second) return;
+
+    QPainterPath paths[4];
+    const double size = std::clamp(mapping.pixelsPerBar() * 0.4, 3.0, 7.0);
+    // Markers are sorted by day, so the matching bar only ever moves forward
+    const int *bar = day + first;
+    for (const TradeMarker *marker = markers.first; marker != markers.second; ++marker) {
+        bar = std::lower_bound(bar, day + last, marker->day);
+        if (bar == day + last) break;
+        const double x = mapping.xForBar(static_cast<double>(bar - day));
+        const double y = mapping.yForValue(marker->price);
+        QPainterPath &path = paths[static_cast<int>(marker->kind)];
+        if (marker->kind == MarkerKind::Buy) {
+            path.addPolygon(QPolygonF({QPointF(x, y), QPointF(x - size, y + 2 * size), QPointF(x + size, y + 2 * size)}));
+        } else {
+            path.addPolygon(QPolygonF({QPointF(x, y), QPointF(x - size, y - 2 * size), QPointF(x + size, y - 2 * size)}));
+        }
+        path.closeSubpath();
     }
 
-    // 3) Query the new data
-    QVector<CandleData> allData;
-    if (!queryTickerData(ticker, allData)) {
-        qWarning() << "Failed to query data for ticker:" << ticker;
-        return;
+    const QColor colors[4] = {QColor(0, 230, 118), QColor(41, 182, 246), QColor(255, 213, 79), QColor(255, 61, 0)};
+    painter.setPen(Qt::NoPen);
+    for (int kind = 0; kind < 4; ++kind) {
+        if (!paths[kind].isEmpty()) painter.fillPath(paths[kind], colors[kind]);
     }
+}
 
-    // 4) Update the dataCache with the results (trim to max bars, etc.)
-    updateDataCache(allData);
-    if (dataCache.isEmpty()) {
-        qWarning() << "No data returned for ticker:" << ticker;
-        return;
+void CandlestickChart::paintValueAxis(QPainter &painter, const ChartMapping &mapping)
+{
+    const double range = mapping.maxValue - mapping.minValue;
+    if (range <= 0.0) return;
+
+    const double step = niceStep(range / std::max(2.0, mapping.area.height() / 50.0));
+    const int decimals = step < 1.0 ? std::min(4, static_cast<int>(std::ceil(-std::log10(step)))) : 0;
+
+    for (double value = std::ceil(mapping.minValue / step) * step; value <= mapping.maxValue; value += step) {
+        double y = std::round(mapping.yForValue(value)) + 0.5;
+        painter.setPen(QPen(kGridColor));
+        painter.drawLine(QPointF(mapping.area.left(), y), QPointF(mapping.area.right(), y));
+        painter.setPen(Qt::white);
+        painter.drawText(QRectF(mapping.area.right() + 6, y - 8, kRightAxisWidth - 8, 16),
+                         Qt::AlignLeft | Qt::AlignVCenter, axisLabel(value, decimals));
     }
-    currentTicker = ticker; // we have valid data now
+}
 
-    // 5) Setup candlestick series & axis
-    setupCandleSeries();
+void CandlestickChart::paintDateAxis(QPainter &painter, const ChartMapping &mapping)
+{
+    std::size_t first, last;
+    mapping.visibleRange(dataCache.size(), first, last);
+    if (first >= last) return;
+
+    // One label roughly every 90 pixels, aligned to multiples of the step so labels don't jitter while panning
+    const std::size_t step = std::max<std::size_t>(1, static_cast<std::size_t>(std::ceil(90.0 / mapping.pixelsPerBar())));
+    const int *day = dataCache.day();
+    painter.setPen(Qt::white);
+    for (std::size_t i = ((first + step - 1) / step) * step; i < last; i += step) {
+        double x = mapping.xForBar(static_cast<double>(i));
+        if (x < mapping.area.left() || x > mapping.area.right()) continue;
+        painter.drawText(QRectF(x - 40, mapping.area.bottom() + 3, 80, kBottomAxisHeight - 4),
+                         Qt::AlignHCenter | Qt::AlignTop, QString::fromStdString(dayToString(day[i])));
+    }
+}
 
-    // 6) Setup volume series
-    setupVolumeSeries();
+// Drawn over the cached pixmap with the mapping it was rendered with
+void CandlestickChart::paintPriceLevels(QPainter &painter)
+{
+    const ChartMapping &price = m_panes[0].mapping;
+    if (m_priceLevels.isEmpty() || dataCache.empty() || price.maxValue <= price.minValue) return;
+
+    painter.save();
+    painter.setClipRect(price.area);
+    for (const PriceLevel &level : std::as_const(m_priceLevels)) {
+        double y = std::round(price.yForValue(level.price)) + 0.5;
+        painter.setPen(QPen(level.color, 1));
+        painter.drawLine(QPointF(price.area.left(), y), QPointF(price.area.right(), y));
+    }
+    painter.restore();
+}
 
-    // 7) Reorder so volume is behind candlesticks
-    setupAxesAndReorderSeries();
+// The vertical line runs through every pane; the horizontal one only through the pane under the cursor
+void CandlestickChart::paintCrosshair(QPainter &painter)
+{
+    const int index = paneAt(m_mousePos);
+    if (!m_crosshairVisible || index < 0) return;
+
+    QRectF area = plotArea();
+    const QRectF &pane = m_panes[static_cast<std::size_t>(index)].area;
+    painter.setPen(QPen(Qt::white, 1, Qt::DashLine));
+    painter.drawLine(QPointF(m_mousePos.x() + 0.5, area.top()), QPointF(m_mousePos.x() + 0.5, area.bottom()));
+    painter.drawLine(QPointF(pane.left(), m_mousePos.y() + 0.5), QPointF(pane.right(), m_mousePos.y() + 0.5));
+}
 
-    // 8) Optionally add moving averages
-    createMovingAverageLine(10, Qt::cyan);
-    createMovingAverageLine(20, Qt::red);
-    createMovingAverageLine(50, Qt::green);
+// One-pixel strips covered by the crosshair lines at pos
+QRegion CandlestickChart::crosshairRegion(const QPoint &pos) const
+{
+    QRect area = plotArea().toAlignedRect();
+    QRegion region(QRect(pos.x() - 1, area.top(), 3, area.height()));
+    region += QRect(area.left(), pos.y() - 1, area.width(), 3);
+    return region;
+}
 
-    // Optionally reset chart zoom
-    chart->zoomReset();
+void CandlestickChart::paintEvent(QPaintEvent *event)
+{
+    if (m_cacheDirty || m_cachedPixmap.size() != size() * devicePixelRatioF()) {
+        renderStaticLayer();
+    }
+    renderOverlayLayer();
+
+    // Copy back only the damaged part of the cached layers; for crosshair moves that is two strips
+    QPainter painter(this);
+    const qreal ratio = m_cachedPixmap.devicePixelRatio();
+    for (const QRect &dirty : event->region()) {
+        const QRectF source(dirty.x() * ratio, dirty.y() * ratio, dirty.width() * ratio, dirty.height() * ratio);
+        painter.drawPixmap(QRectF(dirty), m_cachedPixmap, source);
+        painter.drawPixmap(QRectF(dirty), m_overlayPixmap, source);
+    }
+    paintPriceLevels(painter);
+    paintCrosshair(painter);
 }
 
-// --- New Event Handlers for Zooming & Panning ---
+// --- Event Handlers for Zooming & Panning ---
 
-// Handle mouse press for drag-to-zoom
+// Handle mouse press for drag-to-zoom (left button) and panning (middle button or shift + left)
 void CandlestickChart::mousePressEvent(QMouseEvent *event)
 {
-    if (event->button() == Qt::LeftButton) {
+    if (event->button() == Qt::MiddleButton
+        || (event->button() == Qt::LeftButton && (event->modifiers() & Qt::ShiftModifier))) {
+        m_isPanning = true;
+        m_dragStartPos = event->pos();
+        m_panStartFirst = m_viewFirst;
+        setCursor(Qt::ClosedHandCursor);
+    } else if (event->button() == Qt::LeftButton) {
         // Begin drag selection for zoom
         m_dragStartPos = event->pos();
         m_isDragging = true;
         m_rubberBand->setGeometry(QRect(m_dragStartPos, QSize()));
         m_rubberBand->show();
     }
-    QChartView::mousePressEvent(event);
+    QWidget::mousePressEvent(event);
 }
 
 // Extend mouse move to update both crosshair and rubber band
@@ -439,33 +911,38 @@ void CandlestickChart::mouseMoveEvent(QMouseEvent *event)
         m_rubberBand->setGeometry(rect.normalized());
     }
 
-    // Existing crosshair code
-    QPointF mouseScenePos = mapToScene(event->pos());
-    QPointF chartPos = chart->mapFromScene(mouseScenePos);
-    QRectF plotArea = chart->plotArea();
-
-    if (plotArea.contains(chartPos)) {
-        m_verticalLine->show();
-        m_horizontalLine->show();
+    if (m_isPanning) {
+        double barsMoved = (event->pos().x() - m_dragStartPos.x()) / barMapping().pixelsPerBar();
+        setViewport(m_panStartFirst - barsMoved, m_viewCount);
+    }
 
-        QPointF topScene(mouseScenePos.x(), plotArea.top() + chart->scenePos().y());
-        QPointF bottomScene(mouseScenePos.x(), plotArea.bottom() + chart->scenePos().y());
-        m_verticalLine->setLine(QLineF(topScene, bottomScene));
+    const QPoint previousPos = m_mousePos;
+    const bool wasVisible = m_crosshairVisible;
+    m_mousePos = event->pos();
+    m_crosshairVisible = plotArea().contains(m_mousePos);
+    updateHover(event->pos());
 
-        QPointF leftScene(plotArea.left() + chart->scenePos().x(), mouseScenePos.y());
-        QPointF rightScene(plotArea.right() + chart->scenePos().x(), mouseScenePos.y());
-        m_horizontalLine->setLine(QLineF(leftScene, rightScene));
+    // Unless the layers need rebuilding, only the strips under the old and new crosshair change
+    if (m_cacheDirty) {
+        update();
     } else {
-        m_verticalLine->hide();
-        m_horizontalLine->hide();
+        QRegion dirty;
+        if (wasVisible) dirty += crosshairRegion(previousPos);
+        if (m_crosshairVisible) dirty += crosshairRegion(m_mousePos);
+        if (!dirty.isEmpty()) update(dirty);
     }
 
-    QChartView::mouseMoveEvent(event);
+    QWidget::mouseMoveEvent(event);
 }
 
 // Handle mouse release to apply zoom based on drag selection
 void CandlestickChart::mouseReleaseEvent(QMouseEvent *event)
 {
+    if (m_isPanning && (event->button() == Qt::MiddleButton || event->button() == Qt::LeftButton)) {
+        m_isPanning = false;
+        unsetCursor();
+    }
+
     if (event->button() == Qt::LeftButton && m_isDragging) {
         m_isDragging = false;
         m_rubberBand->hide();
@@ -473,168 +950,156 @@ void CandlestickChart::mouseReleaseEvent(QMouseEvent *event)
         QRect selectionRect = m_rubberBand->geometry();
         // Ignore very small selections
         if (selectionRect.width() < 10) {
-            QChartView::mouseReleaseEvent(event);
+            QWidget::mouseReleaseEvent(event);
             return;
         }
 
-        // Map the rubber band rectangle (only horizontal) to scene coordinates
-        QPointF sceneTopLeft = mapToScene(selectionRect.topLeft());
-        QPointF sceneTopRight = mapToScene(QPoint(selectionRect.topRight().x(), selectionRect.topLeft().y()));
-
-        // Use the candlestick series (priceSeries) for mapping, not the axis
-        qreal x1 = chart->mapToValue(sceneTopLeft, priceSeries).x();
-        qreal x2 = chart->mapToValue(sceneTopRight, priceSeries).x();
-
-        // Clamp the values to the full data range [0, dataCache.size()-1]
-        qreal newX1 = std::max(0.0, std::min(x1, x2));
-        qreal newX2 = std::min(double(dataCache.size() - 1), std::max(x1, x2));
-
-        // Instead of using chart->zoom() with a QRectF (which is not supported in Qt6),
-        // we update the x-axis (a QBarCategoryAxis) range using setRange.
-        // The axis expects string labels so we convert our index values to strings.
-        int startIndex = static_cast<int>(std::round(newX1));
-        int endIndex   = static_cast<int>(std::round(newX2));
-        axisX->setRange(QString::number(startIndex), QString::number(endIndex));
+        // Only the horizontal extent of the selection matters; the price axis refits itself.
+        ChartMapping mapping = barMapping();
+        double x1 = mapping.barAtX(selectionRect.left());
+        double x2 = mapping.barAtX(selectionRect.right());
+        setViewport(std::min(x1, x2) + 0.5, std::fabs(x2 - x1));
     }
-    QChartView::mouseReleaseEvent(event);
+    QWidget::mouseReleaseEvent(event);
 }
 
 // On double click, reset the zoom to full view
 void CandlestickChart::mouseDoubleClickEvent(QMouseEvent *event)
 {
-    // Reset the x-axis to show the full range (from index 0 to last index)
-    if (!dataCache.isEmpty()) {
-        axisX->setRange(QString::number(0),
-                        QString::number(dataCache.size()-1));
-    }
-    chart->zoomReset(); // Optional: resets any other zoom state
-    QChartView::mouseDoubleClickEvent(event);
+    resetViewport();
+    QWidget::mouseDoubleClickEvent(event);
 }
 
-// Handle mouse wheel event for smooth horizontal scrolling
+// Mouse wheel scrolls horizontally; with Ctrl held it zooms around the cursor
 void CandlestickChart::wheelEvent(QWheelEvent *event)
 {
-    if (dataCache.isEmpty()) {
-        QChartView::wheelEvent(event);
+    if (dataCache.empty()) {
+        QWidget::wheelEvent(event);
         return;
     }
 
-    // Get the current visible x-axis range using the candlestick series for mapping
-    QPointF leftValue = chart->mapToValue(chart->plotArea().topLeft(), priceSeries);
-    QPointF rightValue = chart->mapToValue(chart->plotArea().topRight(), priceSeries);
-    double currentMin = leftValue.x();
-    double currentMax = rightValue.x();
-    double visibleRange = currentMax - currentMin;
-
-    // Define a scroll step equal to 10% of the visible range per wheel notch.
-    double step = visibleRange * 0.1;
-    double offset = (event->angleDelta().y() > 0) ? -step : step;  // scroll direction
-
-    // Clamp so we do not scroll beyond the full data range.
-    double fullMin = 0;
-    double fullMax = dataCache.size() - 1;
-    if (currentMin + offset < fullMin) {
-        offset = fullMin - currentMin;
-    }
-    if (currentMax + offset > fullMax) {
-        offset = fullMax - currentMax;
+    const int delta = event->angleDelta().y();
+    if (event->modifiers() & Qt::ControlModifier) {
+        ChartMapping mapping = barMapping();
+        double anchor = mapping.barAtX(event->position().x());
+        double factor = delta > 0 ? 1.0 / 1.2 : 1.2;
+        double newCount = m_viewCount * factor;
+        setViewport(anchor - (anchor - m_viewFirst) * factor, newCount);
+    } else {
+        // Scroll step equal to 10% of the visible range per wheel notch.
+        double step = m_viewCount * 0.1;
+        setViewport(m_viewFirst + (delta > 0 ? -step : step), m_viewCount);
     }
 
-    // Instead of using chart->scroll() directly with pixel offsets,
-    // you might consider adjusting the axis range. However, here we compute a pixel offset.
-    double pixelOffset = offset * chart->plotArea().width() / visibleRange;
-    chart->scroll(pixelOffset, 0);
-
+    updateHover(event->position().toPoint());
     event->accept();
 }
 
-void CandlestickChart::handleHovered(bool state, QCandlestickSet *set)
-{
-    if (state && set) {
-        int index = static_cast<int>(set->timestamp());
-        if (index >= 0 && index < dataCache.size()) {
-            QDateTime dt = QDateTime::fromMSecsSinceEpoch(dataCache[index].timestamp);
-            QString volumeStr = QLocale(QLocale::English, QLocale::UnitedStates)
-                                    .toString(dataCache[index].volume, 'f', 0);
-            QString tooltip = QString("Date: %1\nOpen: %2\nHigh: %3\nLow: %4\nClose: %5\nVolume: %6")
-                                  .arg(dt.toString("yyyy-MM-dd"))
-                                  .arg(set->open())
-                                  .arg(set->high())
-                                  .arg(set->low())
-                                  .arg(set->close())
-                                  .arg(volumeStr);
-            QPoint globalPos = QCursor::pos();
-            tooltipLabel->setText(tooltip);
-            tooltipLabel->move(globalPos.x() + 10, globalPos.y() + 10);
-            tooltipLabel->show();
-        }
-    } else {
+// Resolves the bar under the cursor arithmetically and only rebuilds the tooltip text when that
+// bar changes; otherwise the existing label is just moved along with the cursor.
+void CandlestickChart::updateHover(const QPoint &pos)
+{
+    ChartMapping mapping = barMapping();
+    if (dataCache.empty() || !mapping.area.contains(pos) || m_isDragging || m_isPanning) {
+        m_hoverIndex = -1;
         tooltipLabel->hide();
+        return;
     }
+
+    int index = static_cast<int>(std::lround(mapping.barAtX(pos.x())));
+    if (index < 0 || index >= static_cast<int>(dataCache.size())) {
+        m_hoverIndex = -1;
+        tooltipLabel->hide();
+        return;
+    }
+
+    if (index != m_hoverIndex) {
+        m_hoverIndex = index;
+        QString tooltip = QString("Date: %1\nOpen: %2\nHigh: %3\nLow: %4\nClose: %5\nVolume: %6")
+                              .arg(QString::fromStdString(dayToString(dataCache.day()[index])))
+                              .arg(dataCache.open()[index])
+                              .arg(dataCache.high()[index])
+                              .arg(dataCache.low()[index])
+                              .arg(dataCache.close()[index])
+                              .arg(m_locale.toString(dataCache.volume()[index], 'f', 0));
+
+        // Fills of the selected backtest run on this bar
+        if (m_tradeMarkers) {
+            const int day = dataCache.day()[index];
+            TradeMarkerIndex::Range markers = m_tradeMarkers->range(m_symbol, day, day);
+            for (const TradeMarker *marker = markers.first; marker != markers.second; ++marker) {
+                const TradeRecord &trade = m_tradeMarkers->trades()[marker->tradeIndex];
+                tooltip += QString("\n%1 %2 @ %3").arg(markerKindName(marker->kind)).arg(trade.quantity).arg(marker->price, 0, 'f', 2);
+                if (marker->kind != MarkerKind::Buy) {
+                    tooltip += QString(" (P/L %1)").arg((trade.sellPrice - trade.buyPrice) * trade.quantity, 0, 'f', 2);
+                }
+            }
+        }
+        tooltipLabel->setText(tooltip);
+        tooltipLabel->adjustSize();
+    }
+
+    QPoint globalPos = mapToGlobal(pos);
+    tooltipLabel->move(globalPos.x() + 10, globalPos.y() + 10);
+    tooltipLabel->show();
 }
 
 // (Existing event handlers)
 void CandlestickChart::leaveEvent(QEvent *event)
 {
-    if (m_verticalLine) m_verticalLine->hide();
-    if (m_horizontalLine) m_horizontalLine->hide();
-    QChartView::leaveEvent(event);
+    m_crosshairVisible = false;
+    tooltipLabel->hide();
+    update();
+    QWidget::leaveEvent(event);
 }
 
 void CandlestickChart::resizeEvent(QResizeEvent *event) {
-    QChartView::resizeEvent(event);
-    // (Optional) reposition tooltip or adjust other elements on resize.
+    QWidget::resizeEvent(event);
+    layoutPanes();
+    invalidateCache();
 }
 
-void CandlestickChart::drawPriceLevels(double entryPrice, const QColor &lineColor)
+// Right click lists the price overlays as checkable entries, plus indicator panes to add or remove
+void CandlestickChart::contextMenuEvent(QContextMenuEvent *event)
 {
-    QLineSeries *entryPriceSeries = new QLineSeries();
-    entryPriceSeries->setColor(lineColor);
-
-    QList<QAbstractAxis *> xAxes = chart->axes(Qt::Horizontal);
-    if (xAxes.isEmpty()) {
-        qWarning() << "No horizontal axis found.";
-        return;
+    QMenu menu(this);
+    const OverlaySet &priceOverlays = m_panes[0].overlays;
+    for (int i = 0; i < priceOverlays.count(); ++i) {
+        QAction *action = menu.addAction(overlayName(priceOverlays.spec(i)));
+        action->setCheckable(true);
+        action->setChecked(priceOverlays.isEnabled(i));
+        connect(action, &QAction::toggled, this, [this, i](bool checked) { setOverlayEnabled(i, checked); });
     }
 
-    QBarCategoryAxis *categoryAxis = qobject_cast<QBarCategoryAxis*>(xAxes.first());
-    if (!categoryAxis) {
-        qWarning() << "Horizontal axis is not a QBarCategoryAxis.";
-        return;
+    menu.addSeparator();
+    QMenu *paneMenu = menu.addMenu("Add pane");
+    const OverlaySpec paneSpecs[] = {
+        {OverlayKind::RSI, 14, QColor(186, 104, 200)},
+        {OverlayKind::ADR, 14, Qt::magenta},
+        {OverlayKind::ATR, 14, QColor(255, 138, 101)},
+    };
+    for (const OverlaySpec &spec : paneSpecs) {
+        QAction *action = paneMenu->addAction(overlayName(spec));
+        connect(action, &QAction::triggered, this, [this, spec]() { addIndicatorPane(spec); });
     }
 
-    QStringList categories = categoryAxis->categories();
-    if (categories.isEmpty()) {
-        qWarning() << "No categories in the horizontal axis.";
-        return;
+    const int paneIndex = paneAt(event->pos());
+    if (paneIndex >= 2) {
+        QAction *action = menu.addAction("Remove pane");
+        connect(action, &QAction::triggered, this, [this, paneIndex]() { removePane(paneIndex); });
     }
+    menu.exec(event->globalPos());
+}
 
-    qreal xMin = 0;
-    qreal xMax = categories.size() - 1;
-
-    entryPriceSeries->append(xMin, entryPrice);
-    entryPriceSeries->append(xMax, entryPrice);
-
-    chart->addSeries(entryPriceSeries);
-
-    QList<QAbstractAxis *> yAxes = chart->axes(Qt::Vertical);
-    if (yAxes.isEmpty()) {
-        qWarning() << "No vertical axis found.";
-        return;
-    }
-    QAbstractAxis *axisY = yAxes.first();
-
-    entryPriceSeries->attachAxis(categoryAxis);
-    entryPriceSeries->attachAxis(axisY);
-
-    m_priceLevelLines.append(entryPriceSeries);
+// Levels may be set while a ticker is still loading; they appear once its bars arrive.
+void CandlestickChart::drawPriceLevels(double entryPrice, const QColor &lineColor)
+{
+    m_priceLevels.append({entryPrice, lineColor});
+    update();
 }
 
 void CandlestickChart::clearPriceLevelLines()
 {
-    for (QLineSeries* series : std::as_const(m_priceLevelLines)) {
-        chart->removeSeries(series);
-        delete series;
-    }
-    m_priceLevelLines.clear();
+    m_priceLevels.clear();
+    update();
 }
@@ -1,51 +1,65 @@
 #ifndef CHARTING_H
 #define CHARTING_H
 
-#include <QtCharts/QChartView>
-#include <QtCharts/QValueAxis>
-#include <QtCharts/QCandlestickSeries>
-#include <QtCharts/QCandlestickSet>
-#include <QtCharts/QBarSeries>
-#include <QtCharts/QBarSet>
-#include <QtCharts/QBarCategoryAxis>
-#include <QtCharts/QLineSeries>
-#include <QGraphicsLineItem>
 #include <QMouseEvent>
 #include <QWidget>
 #include <QLabel>
 #include <QRubberBand>
 #include <QVector>
 #include <QList>
-#include <QTimer>
-#include <QDateTime>
-#include <sqlite3.h>
-
-// Structure to hold candlestick data (with volume)
-struct CandleData {
-    double open;
-    double high;
-    double low;
-    double close;
-    qint64 timestamp;
-    double volume; // volume data
-};
+#include <QPixmap>
+#include <QColor>
+#include <QLocale>
+#include <QRegion>
+#include <QFutureWatcher>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "bar_lod.h"
+#include "bar_repository.h"
+#include "candle_renderer.h"
+#include "chart_overlays.h"
+#include "memory_usage.h"
+#include "trade_markers.h"
 
-class CandlestickChart : public QChartView {
+// Candlestick chart painted directly from the shared columnar bar buffer. The plot is split into
+// stacked panes (price, volume, then any indicator panes) that share one bar buffer and one X
+// viewport, so a pan or zoom is applied once for all of them. Each pane renders into its own band
+// of a cached pixmap and is only redrawn when it is marked dirty; the crosshair is drawn on top
+// on every mouse move.
+//
+// Only a window of the ticker's history is held: the last m_maxBars bars plus a page of margin on
+// load, then further pages fetched in the background as the view approaches either edge. All
+// loading runs on the thread pool, so switching tickers never blocks the GUI thread.
+class CandlestickChart : public QWidget {
     Q_OBJECT
 public:
     explicit CandlestickChart(QWidget *parent = nullptr);
     ~CandlestickChart();
 
-    void setDatabase(sqlite3* dbPtr);
     void setMaxBars(int maxBars);
+    // Starts loading ticker in the background; a newer call supersedes any load still running.
     void loadTicker(const QString &ticker, bool forceReload = false);
+    // Price levels live on the overlay layer and never trigger a reload or a full re-render.
     void drawPriceLevels(double entryPrice, const QColor &lineColor);
+    void clearPriceLevelLines();
+
+    // Indicator overlays on the price pane; also toggled from the chart's context menu.
+    int addOverlay(const OverlaySpec &spec, bool enabled = true);
+    void setOverlayEnabled(int index, bool enabled);
 
-public slots:
-    void handleHovered(bool state, QCandlestickSet *set);
+    // Adds a pane below the others plotting spec (e.g. RSI) and returns its index. Only indicator
+    // panes can be removed; the price and volume panes are always present.
+    int addIndicatorPane(const OverlaySpec &spec);
+    void removePane(int index);
+
+    // Entry and exit markers of a backtest run for whichever ticker is shown; nullptr hides them.
+    void setTradeMarkers(std::shared_ptr<const TradeMarkerIndex> markers);
 
 protected:
-    // Override additional mouse events
+    void paintEvent(QPaintEvent *event) override;
     void mousePressEvent(QMouseEvent *event) override;
     void mouseMoveEvent(QMouseEvent *event) override;
     void mouseReleaseEvent(QMouseEvent *event) override;
@@ -53,51 +67,123 @@ protected:
     void wheelEvent(QWheelEvent *event) override;
     void leaveEvent(QEvent *event) override;
     void resizeEvent(QResizeEvent *event) override;
+    void contextMenuEvent(QContextMenuEvent *event) override;
 
 private:
+    // Result of one background ticker load
+    struct WindowLoad {
+        std::uint64_t generation = 0;
+        BarView window;
+        BarView fullData;
+        bool hasOlder = false;
+    };
+
     bool shouldReload(const QString &ticker, bool forceReload);
     void resetChart();
-    bool queryTickerData(const QString &ticker, QVector<CandleData> &outData);
-    void updateDataCache(const QVector<CandleData> &allData);
-    void setupCandleSeries();
-    void setupVolumeSeries();
-    void setupAxesAndReorderSeries();
-    void createMovingAverageLine(int period, const QColor &color);
-    void clearPriceLevelLines();
+    static WindowLoad queryTickerData(const std::string &ticker, std::size_t wanted);
+    void onTickerLoaded();
+    void updateDataCache(const BarView &window);
+    void updateMemoryCharge();
+
+    // Windowed paging
+    std::size_t pageSize() const;
+    void prefetchIfNearEdge();
+    void requestPage(bool older);
+    void onPageLoaded();
+    void applyPage(bool older, const BarView &page, bool more);
+
+    // Viewport handling
+    void resetViewport();
+    void setViewport(double firstBar, double barsVisible);
+    QRectF plotArea() const;
+    ChartMapping barMapping() const;
+    int lodLevel() const;
+    void invalidateCache();
+
+    // Panes
+    enum class PaneKind { Price, Volume, Indicator };
+    struct ChartPane {
+        PaneKind kind;
+        double weight;               // share of the plot height
+        OverlaySet overlays;         // price overlays, or the indicator of an indicator pane
+        QRectF area;                 // set by layoutPanes()
+        ChartMapping mapping;        // as last rendered
+        bool overlayDirty = true;    // pane band of m_overlayPixmap needs repainting
+    };
+    void layoutPanes();
+    int paneAt(const QPoint &pos) const;
+    QRect paneRect(const ChartPane &pane) const;
+    void invalidatePane(ChartPane &pane);
+    ChartMapping paneMapping(ChartPane &pane) const;
+
+    // Rendering
+    void renderStaticLayer();
+    void renderPane(QPainter &painter, ChartPane &pane);
+    void renderOverlayLayer();
+    void paintTradeMarkers(QPainter &painter);
+    void paintValueAxis(QPainter &painter, const ChartMapping &mapping);
+    void paintDateAxis(QPainter &painter, const ChartMapping &mapping);
+    void paintPriceLevels(QPainter &painter);
+    void paintCrosshair(QPainter &painter);
+    QRegion crosshairRegion(const QPoint &pos) const;
+
+    void updateHover(const QPoint &pos);
 
 private:
-    QChart *chart;
-    QCandlestickSeries *priceSeries;   // Price (candlestick) series
-    QBarSeries *volumeSeries;          // Volume (bar) series
-    QBarCategoryAxis *axisX;           // Shared X-axis (categories as indices)
-    QValueAxis *axisY;                 // Y-axis for Price (will be on the right)
-    QValueAxis *axisVolume;            // Y-axis for Volume (will be on the left)
+    struct PriceLevel {
+        double price;
+        QColor color;
+    };
+
     QLabel *tooltipLabel;
-    QList<QLineSeries*> m_smaLines;
-    QList<QLineSeries*> m_priceLevelLines;
-    QVector<CandleData> dataCache;
-    sqlite3* db;
+    std::vector<ChartPane> m_panes;        // [0] price, [1] volume, then indicator panes
+    std::shared_ptr<const TradeMarkerIndex> m_tradeMarkers;
+    QList<PriceLevel> m_priceLevels;
+    BarView dataCache;                     // Loaded window around the viewport, oldest bar first
+    BarPyramid m_lod;                      // dataCache pre-aggregated for zoomed-out views
     QString currentTicker;
+    std::string m_symbol;                  // currentTicker as used by the repository and trade markers
+    QString m_requestedTicker;             // Ticker of the latest loadTicker call, loaded or not
+    bool m_loading;
     int m_maxBars;
+    CandleStyle m_style;
+
+    // Visible range in bar-index units
+    double m_viewFirst;
+    double m_viewCount;
 
-    // Crosshair items
-    QGraphicsLineItem *m_verticalLine;
-    QGraphicsLineItem *m_horizontalLine;
+    // Crosshair and hover
+    bool m_crosshairVisible;
+    QPoint m_mousePos;
+    int m_hoverIndex;                      // Bar the tooltip text was built for, -1 if none
+    QLocale m_locale;                      // Volume formatting, built once
 
     // Members for drag-to-zoom and panning
     bool m_isDragging;           // Flag to indicate if a drag is in progress
     QPoint m_dragStartPos;       // The starting point of the drag
     QRubberBand *m_rubberBand;   // Visual rectangle to show selected zoom area
+    bool m_isPanning;
+    double m_panStartFirst;
 
-    // New members for incremental updates during panning
-    QVector<CandleData> fullData;          // Holds the complete dataset
-    int m_windowStartIndex;                // Start index of the current visible window
-    int m_windowSize;                      // Size of the current visible window (<= m_maxBars)
-    QList<QCandlestickSet*> m_candleSets;  // List of currently displayed candlestick sets
+    // Windowed paging while panning through history
+    BarView fullData;                      // Complete history when the repository already holds it
+    bool m_hasOlder;                       // More bars exist before / after dataCache
+    bool m_hasNewer;
+    bool m_pagePending;
+    bool m_pageOlder;
+    std::size_t m_pageCount;               // Bars requested by the pending page
+    std::uint64_t m_loadGeneration;        // Bumped on every ticker load; stale results are dropped
+    std::uint64_t m_pageGeneration;
+    QFutureWatcher<std::shared_ptr<BarSeries>> *m_pageWatcher;
+    QFutureWatcher<WindowLoad> *m_loadWatcher;
+    // Shared with queued loads so superseded ones return before touching the database
+    std::shared_ptr<std::atomic<std::uint64_t>> m_latestLoad;
 
-    QPixmap m_cachedPixmap; //Disable anti-alliasing
-    bool m_cacheDirty = true;
-    QTimer m_cacheTimer;
+    QPixmap m_cachedPixmap;                // Candles, volume, indicator panes and axes
+    int m_cachedLodFactor = 1;             // Bars per candle in m_cachedPixmap
+    bool m_cacheDirty = true;              // Viewport, data or size changed: every pane is stale
+    QPixmap m_overlayPixmap;               // Indicator overlays and trade markers, transparent elsewhere
+    MemoryCharge m_memory{MemorySubsystem::ChartBuffers};
 };
 
 #endif // CHARTING_H
@@ -8,13 +8,17 @@ ChartingPage::ChartingPage(QWidget *parent) :
 {
     ui->setupUi(this);
 
-    // Connect QLineEdit signals to the updateChart slot
+    // Connect QLineEdit signals. Only the symbol and bar count need new data; the price level
+    // fields just redraw their lines over the chart.
     connect(ui->enterSymbol, &QLineEdit::editingFinished, this, &ChartingPage::updateChart);
     connect(ui->enterBars, &QLineEdit::editingFinished, this, &ChartingPage::updateChart);
-    connect(ui->enterEntryPrice, &QLineEdit::editingFinished, this, &ChartingPage::updateChart);
-    connect(ui->enterTakeProfit, &QLineEdit::editingFinished, this, &ChartingPage::updateChart);
-    connect(ui->enterStopLoss, &QLineEdit::editingFinished, this, &ChartingPage::updateChart);
-    connect(ui->enterRisk, &QLineEdit::editingFinished, this, &ChartingPage::updateChart);
+    connect(ui->enterEntryPrice, &QLineEdit::editingFinished, this, &ChartingPage::updatePriceLevels);
+    connect(ui->enterTakeProfit, &QLineEdit::editingFinished, this, &ChartingPage::updatePriceLevels);
+    connect(ui->enterStopLoss, &QLineEdit::editingFinished, this, &ChartingPage::updatePriceLevels);
+    connect(ui->enterRisk, &QLineEdit::editingFinished, this, &ChartingPage::updatePriceLevels);
+
+    ui->backtestRunSelect->addItem("None");
+    connect(ui->backtestRunSelect, &QComboBox::currentIndexChanged, this, &ChartingPage::selectBacktestRun);
 }
 
 ChartingPage::~ChartingPage()
@@ -28,42 +32,70 @@ CandlestickChart* ChartingPage::getChartWidget() const {
 
 void ChartingPage::updateChart() {
 
-    QString newTicker = ui->enterSymbol->text().toUpper();
-
     // Read user inputs
     QString symbol = ui->enterSymbol->text().toUpper();
     int bars = ui->enterBars->text().toInt();
-    int entryPrice = ui->enterEntryPrice->text().toInt();
-    int takeProfit = ui->enterTakeProfit->text().toInt();
-    int stopLoss = ui->enterStopLoss->text().toInt();
-    int risk = ui->enterRisk->text().toInt();
-
-    qDebug() << "Updating chart with symbol:" << symbol << "bars:" << bars;
 
-    if (risk == 0) {
-        ui->maxShares->setText("Invalid risk");
-    } else {
-        ui->maxShares->setText(QString::number(risk/(entryPrice - stopLoss)));
+    // editingFinished also fires on focus changes; skip if nothing that affects the data changed
+    if (symbol == m_lastTicker && bars == m_lastBars) {
+        return;
     }
 
+    qDebug() << "Updating chart with symbol:" << symbol << "bars:" << bars;
+
     // Set symbol above chart
     ui->currentTicker->setText("Current symbol: " + symbol);
 
     // If the ticker has changed, clear the price level fields
-    if (newTicker != m_lastTicker) {
+    if (symbol != m_lastTicker) {
         ui->enterEntryPrice->clear();
         ui->enterTakeProfit->clear();
         ui->enterStopLoss->clear();
-        m_lastTicker = newTicker;
+        m_lastTicker = symbol;
     }
+    m_lastBars = bars;
 
-
-    // Update the chart: set max bars and reload the ticker
+    // Update the chart: set max bars and start loading the ticker
     ui->chartWidget->setMaxBars(bars);
     ui->chartWidget->loadTicker(symbol, true);
 
+    updatePriceLevels();
+}
+
+void ChartingPage::updatePriceLevels() {
+
+    int entryPrice = ui->enterEntryPrice->text().toInt();
+    int takeProfit = ui->enterTakeProfit->text().toInt();
+    int stopLoss = ui->enterStopLoss->text().toInt();
+    int risk = ui->enterRisk->text().toInt();
+
+    if (risk == 0) {
+        ui->maxShares->setText("Invalid risk");
+    } else if (entryPrice == stopLoss) {
+        // Cleared on every ticker change; don't divide by zero before the levels are re-entered
+        ui->maxShares->setText("");
+    } else {
+        ui->maxShares->setText(QString::number(risk/(entryPrice - stopLoss)));
+    }
+
     // Need to create lines to represent each price level.
+    ui->chartWidget->clearPriceLevelLines();
     ui->chartWidget->drawPriceLevels(entryPrice, Qt::gray);
     ui->chartWidget->drawPriceLevels(takeProfit, Qt::green);
     ui->chartWidget->drawPriceLevels(stopLoss, Qt::red);
 }
+
+void ChartingPage::showSymbol(const QString &symbol) {
+    ui->enterSymbol->setText(symbol);
+    updateChart();
+}
+
+void ChartingPage::addBacktestRun(const QString &name, std::shared_ptr<const TradeMarkerIndex> run) {
+    m_runs.append(std::move(run));
+    ui->backtestRunSelect->addItem(name);
+    ui->backtestRunSelect->setCurrentIndex(ui->backtestRunSelect->count() - 1);
+}
+
+void ChartingPage::selectBacktestRun(int index) {
+    ui->chartWidget->setTradeMarkers(index > 0 && index <= m_runs.size() ? m_runs[index - 1] : nullptr);
+}
@@ -2,7 +2,10 @@
 #define CHARTINGPAGE_H
 
 #include <QWidget>
+#include <QList>
+#include <memory>
 #include "ui_chartingpage.h"  // Generated from ChartingPage.ui
+#include "trade_markers.h"
 
 // Forward declare your custom chart widget class if needed
 class CandlestickChart;
@@ -18,12 +21,22 @@ public:
     // Public getter to access the promoted chart widget (CandlestickChart)
     CandlestickChart* getChartWidget() const;
 
+public slots:
+    // Loads symbol as if it had been typed into the symbol field.
+    void showSymbol(const QString &symbol);
+    // Adds a finished backtest run to the run selector and shows its trades on the chart.
+    void addBacktestRun(const QString &name, std::shared_ptr<const TradeMarkerIndex> run);
+
 private slots:
-    void updateChart();  // Slot that reads the QLineEdit inputs and updates the chart
+    void updateChart();        // Symbol or bar count changed: reload the chart in the background
+    void updatePriceLevels();  // Entry, take profit, stop or risk changed: redraw the level lines only
+    void selectBacktestRun(int index);
 
 private:
     Ui::ChartingPage *ui;
     QString m_lastTicker;
+    int m_lastBars = -1;
+    QList<std::shared_ptr<const TradeMarkerIndex>> m_runs;   // index + 1 matches the run selector
 };
 
 #endif // CHARTINGPAGE_H
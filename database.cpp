@@ -0,0 +1,207 @@
+#include "database.h"
+#include "db_schema.h"
+
+#include <iostream>
+
+namespace {
+
+// Applied to every connection. mmap and a 64 MB page cache keep repeated range scans off the
+// read() path; temporary b-trees for ORDER BY / window functions stay in memory.
+const char* kConnectionPragmas =
+    "PRAGMA busy_timeout = 5000;"
+    "PRAGMA temp_store = MEMORY;"
+    "PRAGMA cache_size = -65536;"
+    "PRAGMA mmap_size = 268435456;";
+
+} // namespace
+
+// ------------------------
+// DbConnection
+// ------------------------
+
+DbConnection::~DbConnection()
+{
+    for (auto& entry : statements_) {
+        sqlite3_finalize(entry.second);
+    }
+    statements_.clear();
+    sqlite3_close(handle_);
+}
+
+CachedStatement DbConnection::prepare(const std::string& key, const char* sql)
+{
+    auto it = statements_.find(key);
+    if (it != statements_.end()) {
+        return CachedStatement(it->second);
+    }
+
+    sqlite3_stmt* stmt = nullptr;
+    if (sqlite3_prepare_v3(handle_, sql, -1, SQLITE_PREPARE_PERSISTENT, &stmt, NULL) != SQLITE_OK) {
+        std::cerr << "Error preparing " << key << ": " << sqlite3_errmsg(handle_) << std::endl;
+        sqlite3_finalize(stmt);
+        return CachedStatement();
+    }
+    statements_.emplace(key, stmt);
+    return CachedStatement(stmt);
+}
+
+// ------------------------
+// DbLease
+// ------------------------
+
+DbLease::~DbLease()
+{
+    release();
+}
+
+DbLease::DbLease(DbLease&& other) noexcept
+    : owner_(other.owner_), connection_(other.connection_), isWriter_(other.isWriter_)
+{
+    other.owner_ = nullptr;
+    other.connection_ = nullptr;
+}
+
+DbLease& DbLease::operator=(DbLease&& other) noexcept
+{
+    if (this != &other) {
+        release();
+        owner_ = other.owner_;
+        connection_ = other.connection_;
+        isWriter_ = other.isWriter_;
+        other.owner_ = nullptr;
+        other.connection_ = nullptr;
+    }
+    return *this;
+}
+
+void DbLease::release()
+{
+    if (owner_ && connection_) {
+        owner_->release(connection_, isWriter_);
+    }
+    owner_ = nullptr;
+    connection_ = nullptr;
+}
+
+// ------------------------
+// Database
+// ------------------------
+
+Database& Database::instance()
+{
+    static Database database;
+    return database;
+}
+
+Database::~Database()
+{
+    close();
+}
+
+std::unique_ptr<DbConnection> Database::openConnection(bool readOnly)
+{
+    sqlite3* handle = nullptr;
+    int flags = SQLITE_OPEN_READWRITE | SQLITE_OPEN_NOMUTEX | (readOnly ? 0 : SQLITE_OPEN_CREATE);
+    if (sqlite3_open_v2(path_.c_str(), &handle, flags, NULL) != SQLITE_OK) {
+        lastError_ = handle ? sqlite3_errmsg(handle) : "out of memory";
+        sqlite3_close(handle);
+        return nullptr;
+    }
+
+    auto connection = std::make_unique<DbConnection>(handle);
+    sqlite3_exec(handle, kConnectionPragmas, NULL, NULL, NULL);
+    if (readOnly) {
+        sqlite3_exec(handle, "PRAGMA query_only = 1;", NULL, NULL, NULL);
+    }
+    return connection;
+}
+
+bool Database::open(const std::string& path, int readerCount)
+{
+    close();
+    path_ = path;
+    lastError_.clear();
+
+    writer_ = openConnection(false);
+    if (!writer_) {
+        std::cerr << "Error opening database: " << lastError_ << std::endl;
+        return false;
+    }
+
+    // WAL is persistent in the file; readers see the last commit while the writer appends.
+    sqlite3_exec(writer_->handle(), "PRAGMA journal_mode = WAL;", NULL, NULL, NULL);
+    sqlite3_exec(writer_->handle(), "PRAGMA synchronous = NORMAL;", NULL, NULL, NULL);
+
+    // A schema this build cannot bring to kSchemaVersion (a failed step, or a newer build's
+    // file) must never be read or written, so the database stays closed.
+    if (!ensureSchema(writer_->handle())) {
+        lastError_ = "schema migration failed";
+        std::cerr << "Error migrating database schema." << std::endl;
+        writer_.reset();
+        return false;
+    }
+
+    for (int i = 0; i < readerCount; ++i) {
+        std::unique_ptr<DbConnection> reader = openConnection(true);
+        if (!reader) {
+            std::cerr << "Error opening reader connection: " << lastError_ << std::endl;
+            break;
+        }
+        idleReaders_.push_back(reader.get());
+        readers_.push_back(std::move(reader));
+    }
+    return true;
+}
+
+void Database::close()
+{
+    {
+        std::unique_lock<std::mutex> lock(readerMutex_);
+        readerCv_.wait(lock, [&]() { return idleReaders_.size() == readers_.size(); });
+        idleReaders_.clear();
+        readers_.clear();
+    }
+    {
+        std::unique_lock<std::mutex> lock(writerMutex_);
+        writerCv_.wait(lock, [&]() { return !writerBusy_; });
+        writer_.reset();
+    }
+}
+
+DbLease Database::writer()
+{
+    std::unique_lock<std::mutex> lock(writerMutex_);
+    if (!writer_) {
+        return DbLease();
+    }
+    writerCv_.wait(lock, [&]() { return !writerBusy_; });
+    writerBusy_ = true;
+    return DbLease(this, writer_.get(), true);
+}
+
+DbLease Database::reader()
+{
+    std::unique_lock<std::mutex> lock(readerMutex_);
+    if (readers_.empty()) {
+        lock.unlock();
+        // No pool (e.g. reader connections failed to open): fall back to the writer.
+        return writer();
+    }
+    readerCv_.wait(lock, [&]() { return !idleReaders_.empty(); });
+    DbConnection* connection = idleReaders_.back();
+    idleReaders_.pop_back();
+    return DbLease(this, connection, false);
+}
+
+void Database::release(DbConnection* connection, bool isWriter)
+{
+    if (isWriter) {
+        std::lock_guard<std::mutex> lock(writerMutex_);
+        writerBusy_ = false;
+        writerCv_.notify_one();
+    } else {
+        std::lock_guard<std::mutex> lock(readerMutex_);
+        idleReaders_.push_back(connection);
+        readerCv_.notify_all();
+    }
+}
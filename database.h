@@ -0,0 +1,142 @@
+#ifndef DATABASE_H
+#define DATABASE_H
+
+#include <sqlite3.h>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// Prepared statement handed out by DbConnection::prepare. The statement itself stays cached on the
+// connection; destroying this handle only resets it and clears its bindings.
+class CachedStatement
+{
+public:
+    CachedStatement() = default;
+    explicit CachedStatement(sqlite3_stmt* stmt) : stmt_(stmt) {}
+    ~CachedStatement() { release(); }
+
+    CachedStatement(CachedStatement&& other) noexcept : stmt_(other.stmt_) { other.stmt_ = nullptr; }
+    CachedStatement& operator=(CachedStatement&& other) noexcept {
+        if (this != &other) {
+            release();
+            stmt_ = other.stmt_;
+            other.stmt_ = nullptr;
+        }
+        return *this;
+    }
+    CachedStatement(const CachedStatement&) = delete;
+    CachedStatement& operator=(const CachedStatement&) = delete;
+
+    sqlite3_stmt* get() const { return stmt_; }
+    explicit operator bool() const { return stmt_ != nullptr; }
+
+private:
+    void release() {
+        if (stmt_) {
+            sqlite3_reset(stmt_);
+            sqlite3_clear_bindings(stmt_);
+            stmt_ = nullptr;
+        }
+    }
+
+    sqlite3_stmt* stmt_ = nullptr;
+};
+
+// One SQLite connection plus its prepared statement cache. A connection is only ever used by the
+// thread currently holding its DbLease.
+class DbConnection
+{
+public:
+    explicit DbConnection(sqlite3* handle) : handle_(handle) {}
+    ~DbConnection();
+
+    DbConnection(const DbConnection&) = delete;
+    DbConnection& operator=(const DbConnection&) = delete;
+
+    sqlite3* handle() const { return handle_; }
+
+    // Returns the statement cached under key, preparing sql the first time the key is used.
+    // The same key must not be held twice at once on one connection.
+    CachedStatement prepare(const std::string& key, const char* sql);
+
+private:
+    sqlite3* handle_;
+    std::unordered_map<std::string, sqlite3_stmt*> statements_;
+};
+
+class Database;
+
+// Exclusive use of a pooled connection; returns it to the pool when destroyed.
+class DbLease
+{
+public:
+    DbLease() = default;
+    DbLease(Database* owner, DbConnection* connection, bool isWriter)
+        : owner_(owner), connection_(connection), isWriter_(isWriter) {}
+    ~DbLease();
+
+    DbLease(DbLease&& other) noexcept;
+    DbLease& operator=(DbLease&& other) noexcept;
+    DbLease(const DbLease&) = delete;
+    DbLease& operator=(const DbLease&) = delete;
+
+    explicit operator bool() const { return connection_ != nullptr; }
+    DbConnection& operator*() const { return *connection_; }
+    DbConnection* operator->() const { return connection_; }
+    sqlite3* handle() const { return connection_ ? connection_->handle() : nullptr; }
+
+private:
+    void release();
+
+    Database* owner_ = nullptr;
+    DbConnection* connection_ = nullptr;
+    bool isWriter_ = false;
+};
+
+// Shared access to Universe_OHLCV.db: one writer connection and a pool of read-only connections,
+// all in WAL mode so ingestion never blocks chart or backtest reads.
+class Database
+{
+public:
+    static Database& instance();
+
+    // Opens (and migrates, see db_schema.h) the database. Safe to call once at startup.
+    bool open(const std::string& path, int readerCount = 4);
+    void close();
+
+    bool isOpen() const { return writer_ != nullptr; }
+    const std::string& path() const { return path_; }
+    const std::string& lastError() const { return lastError_; }
+
+    // Blocks until the writer connection is free.
+    DbLease writer();
+    // Blocks until a reader connection is free.
+    DbLease reader();
+
+private:
+    friend class DbLease;
+
+    Database() = default;
+    ~Database();
+
+    std::unique_ptr<DbConnection> openConnection(bool readOnly);
+    void release(DbConnection* connection, bool isWriter);
+
+    std::string path_;
+    std::string lastError_;
+
+    std::unique_ptr<DbConnection> writer_;
+    std::mutex writerMutex_;
+    bool writerBusy_ = false;
+    std::condition_variable writerCv_;
+
+    std::vector<std::unique_ptr<DbConnection>> readers_;
+    std::vector<DbConnection*> idleReaders_;
+    std::mutex readerMutex_;
+    std::condition_variable readerCv_;
+};
+
+#endif // DATABASE_H
@@ -0,0 +1,78 @@
+#ifndef DAY_NUMBER_H
+#define DAY_NUMBER_H
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+// Bars are keyed by day number: whole days since 1970-01-01 (UTC calendar).
+// Conversions follow Howard Hinnant's days_from_civil / civil_from_days.
+
+constexpr std::int64_t kMsecsPerDay = 86400000LL;
+
+inline int dayFromCivil(int y, unsigned m, unsigned d) {
+    y -= m <= 2;
+    const int era = (y >= 0 ? y : y - 399) / 400;
+    const unsigned yoe = static_cast<unsigned>(y - era * 400);
+    const unsigned doy = (153 * (m + (m > 2 ? -3 : 9)) + 2) / 5 + d - 1;
+    const unsigned doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+    return era * 146097 + static_cast<int>(doe) - 719468;
+}
+
+inline void civilFromDay(int day, int& y, unsigned& m, unsigned& d) {
+    day += 719468;
+    const int era = (day >= 0 ? day : day - 146096) / 146097;
+    const unsigned doe = static_cast<unsigned>(day - era * 146097);
+    const unsigned yoe = (doe - doe / 1460 + doe / 36524 - doe / 146096) / 365;
+    const unsigned doy = doe - (365 * yoe + yoe / 4 - yoe / 100);
+    const unsigned mp = (5 * doy + 2) / 153;
+    d = doy - (153 * mp + 2) / 5 + 1;
+    m = mp < 10 ? mp + 3 : mp - 9;
+    y = static_cast<int>(yoe) + era * 400 + (m <= 2);
+}
+
+// Parses "YYYY-MM-DD" (anything after the day, such as a time, is ignored).
+inline bool parseDayNumber(std::string_view text, int& day) {
+    if (text.size() < 10 || text[4] != '-' || text[7] != '-') {
+        return false;
+    }
+    auto digits = [&](std::size_t pos, std::size_t count, unsigned& out) {
+        out = 0;
+        for (std::size_t i = pos; i < pos + count; ++i) {
+            if (text[i] < '0' || text[i] > '9') return false;
+            out = out * 10 + static_cast<unsigned>(text[i] - '0');
+        }
+        return true;
+    };
+    unsigned y, m, d;
+    if (!digits(0, 4, y) || !digits(5, 2, m) || !digits(8, 2, d) || m < 1 || m > 12 || d < 1 || d > 31) {
+        return false;
+    }
+    day = dayFromCivil(static_cast<int>(y), m, d);
+    return true;
+}
+
+inline std::string dayToString(int day) {
+    int y;
+    unsigned m, d;
+    civilFromDay(day, y, m, d);
+    char buf[11];
+    buf[0] = static_cast<char>('0' + (y / 1000) % 10);
+    buf[1] = static_cast<char>('0' + (y / 100) % 10);
+    buf[2] = static_cast<char>('0' + (y / 10) % 10);
+    buf[3] = static_cast<char>('0' + y % 10);
+    buf[4] = '-';
+    buf[5] = static_cast<char>('0' + m / 10);
+    buf[6] = static_cast<char>('0' + m % 10);
+    buf[7] = '-';
+    buf[8] = static_cast<char>('0' + d / 10);
+    buf[9] = static_cast<char>('0' + d % 10);
+    buf[10] = '\0';
+    return std::string(buf, 10);
+}
+
+inline std::int64_t dayToMsecsSinceEpoch(int day) {
+    return static_cast<std::int64_t>(day) * kMsecsPerDay;
+}
+
+#endif // DAY_NUMBER_H
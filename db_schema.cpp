@@ -0,0 +1,261 @@
+#include "db_schema.h"
+
+#include <iostream>
+#include <string>
+
+namespace {
+
+bool execSQL(sqlite3* DB, const char* sql, const char* what) {
+    char* errorMessage = nullptr;
+    if (sqlite3_exec(DB, sql, NULL, NULL, &errorMessage) != SQLITE_OK) {
+        std::cerr << "Error " << what << ": " << (errorMessage ? errorMessage : sqlite3_errmsg(DB)) << std::endl;
+        sqlite3_free(errorMessage);
+        return false;
+    }
+    return true;
+}
+
+bool tableExists(sqlite3* DB, const char* name) {
+    sqlite3_stmt* stmt = nullptr;
+    if (sqlite3_prepare_v2(DB, "SELECT 1 FROM sqlite_master WHERE type = 'table' AND name = ?;", -1, &stmt, NULL) != SQLITE_OK) {
+        return false;
+    }
+    sqlite3_bind_text(stmt, 1, name, -1, SQLITE_STATIC);
+    bool exists = sqlite3_step(stmt) == SQLITE_ROW;
+    sqlite3_finalize(stmt);
+    return exists;
+}
+
+bool setVersion(sqlite3* DB, int version) {
+    std::string sql = "PRAGMA user_version = " + std::to_string(version) + ";";
+    return execSQL(DB, sql.c_str(), "updating schema version");
+}
+
+// Runs body inside a transaction and bumps user_version on success.
+template <typename Body>
+bool migrationStep(sqlite3* DB, int toVersion, Body body) {
+    if (!execSQL(DB, "BEGIN IMMEDIATE;", "starting migration")) {
+        return false;
+    }
+    if (!body() || !setVersion(DB, toVersion)) {
+        execSQL(DB, "ROLLBACK;", "rolling back migration");
+        return false;
+    }
+    if (!execSQL(DB, "COMMIT;", "committing migration")) {
+        return false;
+    }
+    std::cout << "Database schema migrated to version " << toVersion << std::endl;
+    return true;
+}
+
+const char* kCreateStocksV1 =
+    "CREATE TABLE Stocks ("
+    "open REAL, "
+    "high REAL, "
+    "low REAL, "
+    "close REAL, "
+    "volume INTEGER, "
+    "ticker TEXT NOT NULL, "
+    "date TEXT NOT NULL, "
+    "PRIMARY KEY (ticker, date)"
+    ") WITHOUT ROWID;";
+
+// v0 -> v1: rebuild Stocks with a (ticker, date) primary key. Duplicates are dropped once here,
+// keeping the first inserted row like removeDuplicates used to.
+bool migrateToV1(sqlite3* DB) {
+    if (!tableExists(DB, "Stocks")) {
+        return execSQL(DB, kCreateStocksV1, "creating Stocks table");
+    }
+
+    std::string createNew = kCreateStocksV1;
+    createNew.replace(createNew.find("Stocks"), 6, "Stocks_v1");
+
+    return execSQL(DB, createNew.c_str(), "creating keyed Stocks table")
+        && execSQL(DB,
+                   "INSERT OR IGNORE INTO Stocks_v1 (open, high, low, close, volume, ticker, date) "
+                   "SELECT open, high, low, close, volume, ticker, date FROM Stocks "
+                   "WHERE ticker IS NOT NULL AND date IS NOT NULL ORDER BY rowid;",
+                   "copying rows into keyed Stocks table")
+        && execSQL(DB, "DROP TABLE Stocks;", "dropping legacy Stocks table")
+        && execSQL(DB, "ALTER TABLE Stocks_v1 RENAME TO Stocks;", "renaming keyed Stocks table");
+}
+
+const char* kCreateTickersV2 =
+    "CREATE TABLE Tickers ("
+    "id INTEGER PRIMARY KEY, "
+    "symbol TEXT NOT NULL UNIQUE"
+    ");";
+
+const char* kCreateBarsV2 =
+    "CREATE TABLE Bars ("
+    "ticker_id INTEGER NOT NULL REFERENCES Tickers(id), "
+    "day INTEGER NOT NULL, "
+    "open REAL, "
+    "high REAL, "
+    "low REAL, "
+    "close REAL, "
+    "volume INTEGER, "
+    "PRIMARY KEY (ticker_id, day)"
+    ") WITHOUT ROWID;";
+
+bool createV2Tables(sqlite3* DB) {
+    return execSQL(DB, kCreateTickersV2, "creating Tickers table")
+        && execSQL(DB, kCreateBarsV2, "creating Bars table");
+}
+
+// v1 -> v2: move Stocks into the Tickers dictionary and integer-day Bars. julianday() of the
+// epoch is 2440587.5, so the difference is the day number used by day_number.h.
+bool migrateToV2(sqlite3* DB) {
+    return createV2Tables(DB)
+        && execSQL(DB, "INSERT INTO Tickers (symbol) SELECT DISTINCT ticker FROM Stocks ORDER BY ticker;",
+                   "filling Tickers table")
+        && execSQL(DB,
+                   "INSERT OR IGNORE INTO Bars (ticker_id, day, open, high, low, close, volume) "
+                   "SELECT t.id, CAST(julianday(s.date) - 2440587.5 AS INTEGER), "
+                   "       s.open, s.high, s.low, s.close, s.volume "
+                   "FROM Stocks s JOIN Tickers t ON t.symbol = s.ticker "
+                   "WHERE julianday(s.date) IS NOT NULL;",
+                   "copying rows into Bars table")
+        && execSQL(DB, "DROP TABLE Stocks;", "dropping Stocks table");
+}
+
+// v2 -> v3: data versions on Tickers and the persistent indicator store. Rows of Features are
+// only trusted while their version matches the ticker's, see feature_store.h.
+bool migrateToV3(sqlite3* DB) {
+    return execSQL(DB, "ALTER TABLE Tickers ADD COLUMN version INTEGER NOT NULL DEFAULT 0;",
+                   "adding Tickers.version")
+        && execSQL(DB, "ALTER TABLE Tickers ADD COLUMN last_day INTEGER;", "adding Tickers.last_day")
+        && execSQL(DB, "UPDATE Tickers SET last_day = (SELECT MAX(day) FROM Bars WHERE ticker_id = Tickers.id);",
+                   "filling Tickers.last_day")
+        && execSQL(DB,
+                   "CREATE TABLE Features ("
+                   "ticker_id INTEGER NOT NULL REFERENCES Tickers(id), "
+                   "name TEXT NOT NULL, "
+                   "version INTEGER NOT NULL, "
+                   "first_day INTEGER NOT NULL, "
+                   "last_day INTEGER NOT NULL, "
+                   "vals BLOB NOT NULL, "
+                   "PRIMARY KEY (ticker_id, name)"
+                   ");",
+                   "creating Features table");
+}
+
+// v3 -> v4: finished backtest results per ticker, strategy and bar count. Like Features, a row
+// is only reused while its version and last_day match the ticker's, see run_cache.h.
+bool migrateToV4(sqlite3* DB) {
+    return execSQL(DB,
+                   "CREATE TABLE RunResults ("
+                   "ticker_id INTEGER NOT NULL REFERENCES Tickers(id), "
+                   "strategy INTEGER NOT NULL, "
+                   "bars INTEGER NOT NULL, "
+                   "version INTEGER NOT NULL, "
+                   "last_day INTEGER NOT NULL, "
+                   "trades BLOB NOT NULL, "
+                   "PRIMARY KEY (ticker_id, strategy, bars)"
+                   ");",
+                   "creating RunResults table");
+}
+
+} // namespace
+
+int schemaVersion(sqlite3* DB) {
+    sqlite3_stmt* stmt = nullptr;
+    int version = 0;
+    if (sqlite3_prepare_v2(DB, "PRAGMA user_version;", -1, &stmt, NULL) == SQLITE_OK) {
+        if (sqlite3_step(stmt) == SQLITE_ROW) {
+            version = sqlite3_column_int(stmt, 0);
+        }
+        sqlite3_finalize(stmt);
+    }
+    return version;
+}
+
+bool ensureSchema(sqlite3* DB) {
+    if (!DB) {
+        return false;
+    }
+
+    int version = schemaVersion(DB);
+    if (version > kSchemaVersion) {
+        std::cerr << "Database schema version " << version << " is newer than this build supports ("
+                  << kSchemaVersion << ")" << std::endl;
+        return false;
+    }
+
+    // A brand new database starts at the normalized layout instead of replaying the Stocks steps.
+    if (version == 0 && !tableExists(DB, "Stocks")) {
+        if (!migrationStep(DB, 2, [&]() { return createV2Tables(DB); })) {
+            return false;
+        }
+        version = 2;
+    }
+
+    if (version < 1 && !migrationStep(DB, 1, [&]() { return migrateToV1(DB); })) {
+        return false;
+    }
+    if (version < 2) {
+        if (!migrationStep(DB, 2, [&]() { return migrateToV2(DB); })) {
+            return false;
+        }
+        // Give the space of the dropped text-keyed table back to the file system.
+        execSQL(DB, "VACUUM;", "compacting database");
+    }
+    if (version < 3 && !migrationStep(DB, 3, [&]() { return migrateToV3(DB); })) {
+        return false;
+    }
+    if (version < 4 && !migrationStep(DB, 4, [&]() { return migrateToV4(DB); })) {
+        return false;
+    }
+    return true;
+}
+
+sqlite3_int64 lookupTickerId(sqlite3* DB, std::string_view symbol, bool create) {
+    sqlite3_stmt* stmt = nullptr;
+    if (create) {
+        if (sqlite3_prepare_v2(DB, "INSERT OR IGNORE INTO Tickers (symbol) VALUES (?);", -1, &stmt, NULL) != SQLITE_OK) {
+            std::cerr << "Error preparing ticker insert: " << sqlite3_errmsg(DB) << std::endl;
+            return -1;
+        }
+        sqlite3_bind_text(stmt, 1, symbol.data(), static_cast<int>(symbol.size()), SQLITE_STATIC);
+        sqlite3_step(stmt);
+        sqlite3_finalize(stmt);
+    }
+
+    if (sqlite3_prepare_v2(DB, "SELECT id FROM Tickers WHERE symbol = ?;", -1, &stmt, NULL) != SQLITE_OK) {
+        std::cerr << "Error preparing ticker lookup: " << sqlite3_errmsg(DB) << std::endl;
+        return -1;
+    }
+    sqlite3_bind_text(stmt, 1, symbol.data(), static_cast<int>(symbol.size()), SQLITE_STATIC);
+    sqlite3_int64 id = -1;
+    if (sqlite3_step(stmt) == SQLITE_ROW) {
+        id = sqlite3_column_int64(stmt, 0);
+    }
+    sqlite3_finalize(stmt);
+    return id;
+}
+
+bool recordTickerWrite(sqlite3* DB, sqlite3_int64 tickerId, int lastDay, bool rewroteHistory) {
+    sqlite3_stmt* stmt = nullptr;
+    const char* updateSQL =
+        "UPDATE Tickers SET version = version + ?1, last_day = MAX(COALESCE(last_day, ?2), ?2) WHERE id = ?3;";
+    if (sqlite3_prepare_v2(DB, updateSQL, -1, &stmt, NULL) != SQLITE_OK) {
+        std::cerr << "Error preparing ticker version update: " << sqlite3_errmsg(DB) << std::endl;
+        return false;
+    }
+    sqlite3_bind_int(stmt, 1, rewroteHistory ? 1 : 0);
+    sqlite3_bind_int(stmt, 2, lastDay);
+    sqlite3_bind_int64(stmt, 3, tickerId);
+    bool ok = sqlite3_step(stmt) == SQLITE_DONE;
+    if (!ok) {
+        std::cerr << "Error updating ticker version: " << sqlite3_errmsg(DB) << std::endl;
+    }
+    sqlite3_finalize(stmt);
+    return ok;
+}
+
+bool recordBulkWrite(sqlite3* DB) {
+    return execSQL(DB,
+                   "UPDATE Tickers SET version = version + 1, "
+                   "last_day = (SELECT MAX(day) FROM Bars WHERE ticker_id = Tickers.id);",
+                   "updating ticker versions");
+}
@@ -0,0 +1,32 @@
+#ifndef DB_SCHEMA_H
+#define DB_SCHEMA_H
+
+#include <sqlite3.h>
+#include <string_view>
+
+// Current on-disk layout, stored in PRAGMA user_version.
+//   0 - legacy Stocks table without any key
+//   1 - Stocks keyed by (ticker, date), WITHOUT ROWID
+//   2 - Tickers(id, symbol) dictionary and Bars keyed by (ticker_id, day), see day_number.h
+//   3 - Tickers.version / Tickers.last_day and the Features table, see feature_store.h
+//   4 - RunResults table of per-ticker backtest results, see run_cache.h
+constexpr int kSchemaVersion = 4;
+
+int schemaVersion(sqlite3* DB);
+
+// Creates the tables on an empty database or migrates an older layout to kSchemaVersion.
+// Each migration step runs in its own transaction. Returns false if any step failed.
+bool ensureSchema(sqlite3* DB);
+
+// Returns the Tickers.id for symbol, inserting it when create is true. Returns -1 if the symbol is
+// unknown (and create is false) or the lookup failed.
+sqlite3_int64 lookupTickerId(sqlite3* DB, std::string_view symbol, bool create);
+
+// Tickers.version counts writes that changed bars a ticker already had; appending days after
+// Tickers.last_day leaves it alone, so series derived from the bars only need extending.
+// Records a write of bars up to lastDay, bumping the version if rewroteHistory is set.
+bool recordTickerWrite(sqlite3* DB, sqlite3_int64 tickerId, int lastDay, bool rewroteHistory);
+// Bumps every ticker's version and recomputes last_day from Bars, after bulk rewrites.
+bool recordBulkWrite(sqlite3* DB);
+
+#endif // DB_SCHEMA_H
@@ -0,0 +1,292 @@
+#include "feature_store.h"
+#include "database.h"
+#include "indicator_kernels.h"
+#include "memory_usage.h"
+#include "profiler.h"
+
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+
+namespace {
+
+void computeFeature(const BarSeries& bars, std::size_t first, FeatureKind kind, int period, double* out)
+{
+    const std::size_t n = bars.size() - first;
+    switch (kind) {
+    case FeatureKind::SMA:
+        smaSeries(bars.close.data() + first, n, period, out);
+        break;
+    case FeatureKind::EMA:
+        emaSeries(bars.close.data() + first, n, period, out);
+        break;
+    case FeatureKind::ADR:
+        adrSeries(bars.high.data() + first, bars.low.data() + first, n, period, out);
+        break;
+    case FeatureKind::ATR:
+        atrSeries(bars.high.data() + first, bars.low.data() + first, bars.close.data() + first, n, period, out);
+        break;
+    case FeatureKind::AvgVolume:
+        smaSeries(bars.volume.data() + first, n, period, out);
+        break;
+    }
+}
+
+// Fills values[from, bars.size()) given the values before from. Window means are recomputed over
+// the last period bars; the recurrences continue from the last stored value exactly as the
+// kernels would have. Returns false if from is still inside the warm-up, where there is nothing
+// to continue from.
+bool extendFeature(const BarSeries& bars, std::size_t from, FeatureKind kind, int period, std::vector<double>& values)
+{
+    const std::size_t n = bars.size();
+    if (from < static_cast<std::size_t>(period)) {
+        return false;
+    }
+
+    if (kind == FeatureKind::EMA) {
+        const double alpha = 2.0 / (period + 1.0);
+        double ema = values[from - 1];
+        for (std::size_t i = from; i < n; ++i) {
+            ema += alpha * (bars.close[i] - ema);
+            values[i] = ema;
+        }
+        return true;
+    }
+    if (kind == FeatureKind::ATR) {
+        double atr = values[from - 1];
+        for (std::size_t i = from; i < n; ++i) {
+            const double range = std::max(bars.high[i], bars.close[i - 1]) - std::min(bars.low[i], bars.close[i - 1]);
+            atr = (atr * (period - 1) + range) / period;
+            values[i] = atr;
+        }
+        return true;
+    }
+
+    // The window ending at from starts period - 1 bars earlier; its value is the first the
+    // kernel defines over the tail
+    const std::size_t first = from + 1 - static_cast<std::size_t>(period);
+    std::vector<double> tail(n - first);
+    computeFeature(bars, first, kind, period, tail.data());
+    std::copy(tail.begin() + (from - first), tail.end(), values.begin() + static_cast<std::ptrdiff_t>(from));
+    return true;
+}
+
+struct StoredRow {
+    std::int64_t tickerId = -1;
+    bool present = false;
+    std::int64_t version = 0;
+    int firstDay = 0;
+    int lastDay = 0;
+    std::vector<double> values;
+};
+
+// Reads the ticker id and, if there is one, the stored row of name
+bool readRow(DbConnection& db, const std::string& ticker, const std::string& name, StoredRow& row)
+{
+    const char* querySQL =
+        "SELECT t.id, f.version, f.first_day, f.last_day, f.vals "
+        "FROM Tickers t LEFT JOIN Features f ON f.ticker_id = t.id AND f.name = ? "
+        "WHERE t.symbol = ?;";
+    CachedStatement query = db.prepare("features.get", querySQL);
+    if (!query) {
+        return false;
+    }
+    sqlite3_stmt* stmt = query.get();
+    sqlite3_bind_text(stmt, 1, name.c_str(), -1, SQLITE_TRANSIENT);
+    sqlite3_bind_text(stmt, 2, ticker.c_str(), -1, SQLITE_TRANSIENT);
+    if (sqlite3_step(stmt) != SQLITE_ROW) {
+        return false;
+    }
+    row.tickerId = sqlite3_column_int64(stmt, 0);
+    if (sqlite3_column_type(stmt, 1) != SQLITE_NULL) {
+        row.present = true;
+        row.version = sqlite3_column_int64(stmt, 1);
+        row.firstDay = sqlite3_column_int(stmt, 2);
+        row.lastDay = sqlite3_column_int(stmt, 3);
+        const int bytes = sqlite3_column_bytes(stmt, 4);
+        row.values.resize(static_cast<std::size_t>(bytes) / sizeof(double));
+        if (!row.values.empty()) {
+            std::memcpy(row.values.data(), sqlite3_column_blob(stmt, 4), row.values.size() * sizeof(double));
+        }
+    }
+    return true;
+}
+
+// The stored values cover a prefix of bars that has not been rewritten since
+bool rowMatches(const StoredRow& row, const BarSeries& bars)
+{
+    const std::size_t count = row.values.size();
+    return row.present && row.version == bars.version && count > 0 && count <= bars.size()
+           && bars.day.front() == row.firstDay && bars.day[count - 1] == row.lastDay;
+}
+
+// Heap held by an in-memory series, as charged to MemorySubsystem::Features
+std::int64_t valuesBytes(const std::shared_ptr<const std::vector<double>>& values)
+{
+    return values ? static_cast<std::int64_t>(values->capacity() * sizeof(double)) : 0;
+}
+
+} // namespace
+
+std::string featureName(FeatureKind kind, int period)
+{
+    const char* indicator = "sma";
+    switch (kind) {
+    case FeatureKind::SMA: indicator = "sma"; break;
+    case FeatureKind::EMA: indicator = "ema"; break;
+    case FeatureKind::ADR: indicator = "adr"; break;
+    case FeatureKind::ATR: indicator = "atr"; break;
+    case FeatureKind::AvgVolume: indicator = "avgvol"; break;
+    }
+    return std::string(indicator) + "(" + std::to_string(period) + ")";
+}
+
+FeatureStore& FeatureStore::instance()
+{
+    static FeatureStore store;
+    return store;
+}
+
+std::shared_ptr<const std::vector<double>> FeatureStore::get(const BarView& bars, FeatureKind kind, int period)
+{
+    BTE_PROFILE_SCOPE("FeatureStore::get");
+    const std::shared_ptr<const BarSeries>& series = bars.series();
+    if (!series || series->size() == 0) {
+        return std::make_shared<const std::vector<double>>();
+    }
+
+    const std::string name = featureName(kind, period);
+    const std::string key = series->ticker + '\0' + name;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto it = entries_.find(key);
+        if (it != entries_.end() && it->second.series.lock() == series) {
+            stats_.memoryHits++;
+            return it->second.values;
+        }
+    }
+
+    // Computed without holding the lock; two threads asking for the same series at once both
+    // compute it, which is harmless
+    StoredRow row;
+    const bool persistent = series->version >= 0 && Database::instance().isOpen();
+    if (persistent) {
+        DbLease db = Database::instance().reader();
+        if (db) {
+            readRow(*db, series->ticker, name, row);
+        }
+    }
+
+    auto values = std::make_shared<std::vector<double>>(series->size());
+    bool changed = true;
+    enum { Loaded, Extended, Computed } source = Computed;
+    if (rowMatches(row, *series)) {
+        const std::size_t stored = row.values.size();
+        std::copy(row.values.begin(), row.values.end(), values->begin());
+        if (stored == series->size()) {
+            source = Loaded;
+            changed = false;
+        } else if (extendFeature(*series, stored, kind, period, *values)) {
+            source = Extended;
+        }
+    }
+    if (source == Computed) {
+        computeFeature(*series, 0, kind, period, values->data());
+    }
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    switch (source) {
+    case Loaded: stats_.loaded++; break;
+    case Extended: stats_.extended++; break;
+    case Computed: stats_.computed++; break;
+    }
+    if (changed && persistent && row.tickerId >= 0) {
+        pending_.push_back({row.tickerId, name, series->version, series->day.front(), series->day.back(), values});
+    }
+    sweepLocked();
+    Entry& entry = entries_[key];
+    MemoryUsage::instance().add(MemorySubsystem::Features, valuesBytes(values) - valuesBytes(entry.values));
+    entry = Entry{series, values};
+    return values;
+}
+
+// Forgets series whose bars have been evicted or invalidated
+void FeatureStore::sweepLocked()
+{
+    if (entries_.size() < sweepAt_) {
+        return;
+    }
+    for (auto it = entries_.begin(); it != entries_.end();) {
+        if (it->second.series.expired()) {
+            MemoryUsage::instance().add(MemorySubsystem::Features, -valuesBytes(it->second.values));
+            it = entries_.erase(it);
+        } else {
+            ++it;
+        }
+    }
+    sweepAt_ = std::max<std::size_t>(1024, entries_.size() * 2);
+}
+
+std::size_t FeatureStore::flush()
+{
+    BTE_PROFILE_SCOPE("FeatureStore::flush");
+    std::vector<PendingRow> rows;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        rows.swap(pending_);
+    }
+    if (rows.empty()) {
+        return 0;
+    }
+
+    DbLease db = Database::instance().writer();
+    if (!db) {
+        return 0;
+    }
+    const char* upsertSQL =
+        "INSERT INTO Features (ticker_id, name, version, first_day, last_day, vals) VALUES (?, ?, ?, ?, ?, ?) "
+        "ON CONFLICT (ticker_id, name) DO UPDATE SET "
+        "version = excluded.version, first_day = excluded.first_day, "
+        "last_day = excluded.last_day, vals = excluded.vals;";
+    CachedStatement upsert = db->prepare("features.put", upsertSQL);
+    if (!upsert) {
+        return 0;
+    }
+    sqlite3* DB = db.handle();
+    sqlite3_stmt* stmt = upsert.get();
+
+    std::size_t written = 0;
+    sqlite3_exec(DB, "BEGIN TRANSACTION;", nullptr, nullptr, nullptr);
+    for (const PendingRow& row : rows) {
+        sqlite3_bind_int64(stmt, 1, row.tickerId);
+        sqlite3_bind_text(stmt, 2, row.name.c_str(), -1, SQLITE_STATIC);
+        sqlite3_bind_int64(stmt, 3, row.version);
+        sqlite3_bind_int(stmt, 4, row.firstDay);
+        sqlite3_bind_int(stmt, 5, row.lastDay);
+        sqlite3_bind_blob(stmt, 6, row.values->data(), static_cast<int>(row.values->size() * sizeof(double)),
+                          SQLITE_STATIC);
+        if (sqlite3_step(stmt) != SQLITE_DONE) {
+            std::cerr << "Error storing feature " << row.name << ": " << sqlite3_errmsg(DB) << std::endl;
+        } else {
+            written++;
+        }
+        sqlite3_reset(stmt);
+    }
+    sqlite3_exec(DB, "COMMIT;", nullptr, nullptr, nullptr);
+    return written;
+}
+
+void FeatureStore::clear()
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (const auto& entry : entries_) {
+        MemoryUsage::instance().add(MemorySubsystem::Features, -valuesBytes(entry.second.values));
+    }
+    entries_.clear();
+}
+
+FeatureStore::Stats FeatureStore::stats() const
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    return stats_;
+}
@@ -0,0 +1,76 @@
+#ifndef FEATURE_STORE_H
+#define FEATURE_STORE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "bar_repository.h"
+
+enum class FeatureKind { SMA, EMA, ADR, ATR, AvgVolume };
+
+// Name a series is stored under, indicator and parameters together, e.g. "sma(10)"
+std::string featureName(FeatureKind kind, int period);
+
+// Indicator series over a ticker's full history, computed by the kernels in indicator_kernels.h
+// and kept in the Features table keyed by (ticker, name). A stored row is reused while its
+// version matches Tickers.version (see db_schema.h): days appended since it was written are
+// computed on top of it, and only a rewrite of older bars forces a full recompute.
+//
+// Series are also held in memory for as long as the BarSeries they were computed from is alive,
+// so repeated runs over cached bars are lookups.
+class FeatureStore
+{
+public:
+    static FeatureStore& instance();
+
+    // Values of the feature for every bar of bars.series(), oldest first; index with
+    // bars.offset() + i. Values before the first complete period are 0. Partial series (pages,
+    // merged levels) are computed but never stored.
+    std::shared_ptr<const std::vector<double>> get(const BarView& bars, FeatureKind kind, int period);
+
+    // Writes series computed or extended since the last flush, in one transaction on the writer.
+    // Returns the number of rows written.
+    std::size_t flush();
+
+    // Drops the in-memory series; stored rows are kept.
+    void clear();
+
+    struct Stats {
+        std::size_t memoryHits = 0;
+        std::size_t loaded = 0;      // read back unchanged
+        std::size_t extended = 0;    // read back and extended over new days
+        std::size_t computed = 0;    // computed from scratch
+    };
+    Stats stats() const;
+
+private:
+    FeatureStore() = default;
+
+    struct Entry {
+        std::weak_ptr<const BarSeries> series;
+        std::shared_ptr<const std::vector<double>> values;
+    };
+    struct PendingRow {
+        std::int64_t tickerId;
+        std::string name;
+        std::int64_t version;
+        int firstDay;
+        int lastDay;
+        std::shared_ptr<const std::vector<double>> values;
+    };
+
+    void sweepLocked();
+
+    mutable std::mutex mutex_;
+    std::unordered_map<std::string, Entry> entries_;    // ticker + '\0' + name
+    std::size_t sweepAt_ = 1024;
+    std::vector<PendingRow> pending_;
+    Stats stats_;
+};
+
+#endif // FEATURE_STORE_H
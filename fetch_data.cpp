@@ -8,16 +8,22 @@
 #include <curl/curl.h>
 #include <json/json.h>
 #include <ctime>
+#include <unordered_map>
 #include <QDebug>  // Added for QDebug logging
 
 #include "authenticate.h"
 #include "fetch_data.h"
+#include "bar_repository.h"
+#include "db_schema.h"
+#include "day_number.h"
+#include "profiler.h"
 
 // ------------------------
 // Inserting New Data
 // ------------------------
 
 std::string fetchStockData(const std::string& ticker, const std::string& initialAccessToken) {
+    BTE_PROFILE_SCOPE("fetchStockData");
     CURL* curl;
     CURLcode res;
     long httpCode = 0;
@@ -111,6 +117,7 @@ std::string fetchStockData(const std::string& ticker, const std::string& initial
 }
 
 std::vector<Candle> parseCandles(const std::string& jsonResponse) {
+    BTE_PROFILE_SCOPE("parseCandles");
     std::vector<Candle> candlesVector;
 
     // Parse JSON using JsonCpp
@@ -156,40 +163,102 @@ std::vector<Candle> parseCandles(const std::string& jsonResponse) {
     return candlesVector;
 }
 
-void insertCandlesToDB(sqlite3* DB, const std::vector<Candle>& candles) {
-    sqlite3_stmt* stmt;
-    const std::string insertSQL =
-        "INSERT OR IGNORE INTO Stocks (open, high, low, close, volume, ticker, date) VALUES (?, ?, ?, ?, ?, ?, ?);";
-
-    if (sqlite3_prepare_v2(DB, insertSQL.c_str(), -1, &stmt, nullptr) != SQLITE_OK) {
-        std::cerr << "Error preparing insert statement: " << sqlite3_errmsg(DB) << std::endl;
+void insertCandlesToDB(DbConnection& db, const std::vector<Candle>& candles) {
+    BTE_PROFILE_SCOPE("insertCandlesToDB");
+    BTE_PROFILE_COUNT("candles written", candles.size());
+    sqlite3* DB = db.handle();
+    const char* insertSQL =
+        "INSERT INTO Bars (ticker_id, day, open, high, low, close, volume) VALUES (?, ?, ?, ?, ?, ?, ?) "
+        "ON CONFLICT (ticker_id, day) DO UPDATE SET "
+        "open = excluded.open, high = excluded.high, low = excluded.low, "
+        "close = excluded.close, volume = excluded.volume "
+        "WHERE open IS NOT excluded.open OR high IS NOT excluded.high OR low IS NOT excluded.low "
+        "OR close IS NOT excluded.close OR volume IS NOT excluded.volume;";
+
+    CachedStatement insert = db.prepare("insertCandles", insertSQL);
+    if (!insert) {
         return;
     }
+    sqlite3_stmt* stmt = insert.get();
 
     // Begin a transaction for efficiency.
     sqlite3_exec(DB, "BEGIN TRANSACTION;", nullptr, nullptr, nullptr);
 
+    // Per ticker: the last day stored before this write and what the write did relative to it
+    struct TickerWrite {
+        sqlite3_int64 id = -1;
+        int previousLastDay = -1;
+        int lastDay = -1;
+        bool rewroteHistory = false;
+    };
+    CachedStatement lastDayQuery = db.prepare("tickers.lastDay", "SELECT last_day FROM Tickers WHERE id = ?;");
+
+    std::unordered_map<std::string, TickerWrite> tickerIds;
     for (const auto& candle : candles) {
-        sqlite3_bind_double(stmt, 1, candle.open);
-        sqlite3_bind_double(stmt, 2, candle.high);
-        sqlite3_bind_double(stmt, 3, candle.low);
-        sqlite3_bind_double(stmt, 4, candle.close);
-        sqlite3_bind_int(stmt, 5, candle.volume);
-        sqlite3_bind_text(stmt, 6, candle.ticker.c_str(), -1, SQLITE_STATIC);
-        sqlite3_bind_text(stmt, 7, candle.date.c_str(), -1, SQLITE_STATIC);
+        int day = 0;
+        if (!parseDayNumber(candle.date, day)) {
+            std::cerr << "Skipping candle with invalid date: " << candle.ticker << " " << candle.date << std::endl;
+            continue;
+        }
+
+        auto idIt = tickerIds.find(candle.ticker);
+        if (idIt == tickerIds.end()) {
+            TickerWrite write;
+            write.id = lookupTickerId(DB, candle.ticker, true);
+            if (write.id >= 0 && lastDayQuery) {
+                sqlite3_bind_int64(lastDayQuery.get(), 1, write.id);
+                if (sqlite3_step(lastDayQuery.get()) == SQLITE_ROW
+                    && sqlite3_column_type(lastDayQuery.get(), 0) != SQLITE_NULL) {
+                    write.previousLastDay = sqlite3_column_int(lastDayQuery.get(), 0);
+                }
+                sqlite3_reset(lastDayQuery.get());
+            }
+            idIt = tickerIds.emplace(candle.ticker, write).first;
+        }
+        TickerWrite& write = idIt->second;
+        if (write.id < 0) {
+            continue;
+        }
+
+        sqlite3_bind_int64(stmt, 1, write.id);
+        sqlite3_bind_int(stmt, 2, day);
+        sqlite3_bind_double(stmt, 3, candle.open);
+        sqlite3_bind_double(stmt, 4, candle.high);
+        sqlite3_bind_double(stmt, 5, candle.low);
+        sqlite3_bind_double(stmt, 6, candle.close);
+        sqlite3_bind_int64(stmt, 7, candle.volume);
 
         if (sqlite3_step(stmt) != SQLITE_DONE) {
             std::cerr << "Error inserting candle data: " << sqlite3_errmsg(DB) << std::endl;
+        } else {
+            // Re-fetched days with unchanged values are skipped by the upsert and change nothing
+            if (day <= write.previousLastDay && sqlite3_changes(DB) > 0) {
+                write.rewroteHistory = true;
+            }
+            write.lastDay = std::max(write.lastDay, day);
         }
         sqlite3_reset(stmt);
     }
 
+    // Derived series of tickers that only gained new days stay valid, see feature_store.h
+    for (const auto& entry : tickerIds) {
+        const TickerWrite& write = entry.second;
+        if (write.id >= 0 && write.lastDay >= 0) {
+            recordTickerWrite(DB, write.id, write.lastDay, write.rewroteHistory);
+        }
+    }
+
     sqlite3_exec(DB, "COMMIT;", nullptr, nullptr, nullptr);
-    sqlite3_finalize(stmt);
+
+    // Cached histories of the touched tickers are stale now
+    for (const auto& entry : tickerIds) {
+        BarRepository::instance().invalidate(entry.first);
+    }
     std::cout << "Stock data inserted into the database successfully!" << std::endl;
 }
 
-void handleFetchStockData(sqlite3* DB, const std::string& ticker) {
+void handleFetchStockData(const std::string& ticker) {
+    BTE_PROFILE_SCOPE("handleFetchStockData");
     std::string accessToken = getAccessToken();
 
     if (accessToken.empty()) {
@@ -221,7 +290,12 @@ void handleFetchStockData(sqlite3* DB, const std::string& ticker) {
                          << c.ticker << "\t"
                          << c.date << "\n";
         }
-        insertCandlesToDB(DB, candles);
+        DbLease db = Database::instance().writer();
+        if (db) {
+            insertCandlesToDB(*db, candles);
+        } else {
+            std::cerr << "Error: Database is not open.\n";
+        }
         std::cout << outputStream.str();  // This will be captured in MainWindow
     }
 }
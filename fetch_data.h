@@ -6,6 +6,8 @@
 #include <algorithm>
 #include <sqlite3.h>
 
+#include "database.h"
+
 std::string fetchStockData(const std::string& ticker, const std::string& initialAccessToken);
 
 struct Candle {
@@ -21,7 +23,8 @@ struct Candle {
 };
 
 std::vector<Candle> parseCandles(const std::string& jsonResponse);
-void insertCandlesToDB(sqlite3* DB, const std::vector<Candle>& candles);
-void handleFetchStockData(sqlite3* DB, const std::string& ticker);
+void insertCandlesToDB(DbConnection& db, const std::vector<Candle>& candles);
+// Fetches one ticker and writes it through the shared writer connection.
+void handleFetchStockData(const std::string& ticker);
 
 #endif // FETCH_DATA_H
@@ -0,0 +1,631 @@
+#include "indicator_kernels.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+#if defined(__x86_64__) || defined(_M_X64)
+#define BTE_KERNELS_X86 1
+#include <immintrin.h>
+#if defined(_MSC_VER) && !defined(__clang__)
+#include <intrin.h>
+// MSVC accepts AVX2 intrinsics in any function; the CPU check below guards their use
+#define BTE_TARGET_AVX2
+#else
+#define BTE_TARGET_AVX2 __attribute__((target("avx2")))
+#endif
+#endif
+
+namespace {
+
+// ------------------------
+// Element-wise primitives
+// ------------------------
+
+// One implementation of each primitive per instruction set. All of them handle any n, including
+// the tail that does not fill a whole vector.
+struct KernelOps {
+    const char* name;
+    // out[i] = (prefix[i + period] - prefix[i]) / period for i in [0, n)
+    void (*windowMean)(const double* prefix, std::size_t n, int period, double* out);
+    // out[i] = (values[i] + ... + values[i + period - 1]) / period for i in [0, n), added left to
+    // right like a plain loop; vectorized across i
+    void (*windowMeanDirect)(const double* values, std::size_t n, int period, double* out);
+    void (*difference)(const double* a, const double* b, std::size_t n, double* out);
+    void (*maxOf)(const double* a, const double* b, std::size_t n, double* out);
+    void (*minOf)(const double* a, const double* b, std::size_t n, double* out);
+    // out[i] = max(high[i], prevClose[i]) - min(low[i], prevClose[i])
+    void (*trueRange)(const double* high, const double* low, const double* prevClose, std::size_t n, double* out);
+    void (*typicalVolume)(const double* high, const double* low, const double* close, const double* volume,
+                          std::size_t n, double* out);
+    // out[i] = b[i] > 0 ? a[i] / b[i] : 0
+    void (*safeRatio)(const double* a, const double* b, std::size_t n, double* out);
+    // upper/lower = mean +- width * sqrt(max(0, meanSquare - mean^2))
+    void (*bands)(const double* mean, const double* meanSquare, std::size_t n, double width, double* upper, double* lower);
+    // mask[i] &= aScale * a[i] > bScale * b[i] (>= with orEqual)
+    void (*andGreater)(const double* a, double aScale, const double* b, double bScale, std::size_t n, bool orEqual,
+                       unsigned char* mask);
+};
+
+// Bytes of 0 or 1 for each bit of a 4-bit comparison mask, lowest bit in the first byte
+constexpr std::uint32_t maskBytes(unsigned bits)
+{
+    return (bits & 1u) | ((bits >> 1) & 1u) << 8 | ((bits >> 2) & 1u) << 16 | ((bits >> 3) & 1u) << 24;
+}
+
+constexpr std::uint32_t kMaskBytes[16] = {
+    maskBytes(0), maskBytes(1), maskBytes(2), maskBytes(3), maskBytes(4), maskBytes(5), maskBytes(6), maskBytes(7),
+    maskBytes(8), maskBytes(9), maskBytes(10), maskBytes(11), maskBytes(12), maskBytes(13), maskBytes(14), maskBytes(15),
+};
+
+// --- Scalar ---
+
+void windowMeanScalar(const double* prefix, std::size_t n, int period, double* out)
+{
+    for (std::size_t i = 0; i < n; ++i) out[i] = (prefix[i + period] - prefix[i]) / period;
+}
+
+void windowMeanDirectScalar(const double* values, std::size_t n, int period, double* out)
+{
+    for (std::size_t i = 0; i < n; ++i) {
+        double sum = 0.0;
+        for (int k = 0; k < period; ++k) sum += values[i + k];
+        out[i] = sum / period;
+    }
+}
+
+void differenceScalar(const double* a, const double* b, std::size_t n, double* out)
+{
+    for (std::size_t i = 0; i < n; ++i) out[i] = a[i] - b[i];
+}
+
+void maxOfScalar(const double* a, const double* b, std::size_t n, double* out)
+{
+    for (std::size_t i = 0; i < n; ++i) out[i] = std::max(a[i], b[i]);
+}
+
+void minOfScalar(const double* a, const double* b, std::size_t n, double* out)
+{
+    for (std::size_t i = 0; i < n; ++i) out[i] = std::min(a[i], b[i]);
+}
+
+void trueRangeScalar(const double* high, const double* low, const double* prevClose, std::size_t n, double* out)
+{
+    for (std::size_t i = 0; i < n; ++i) out[i] = std::max(high[i], prevClose[i]) - std::min(low[i], prevClose[i]);
+}
+
+void typicalVolumeScalar(const double* high, const double* low, const double* close, const double* volume,
+                         std::size_t n, double* out)
+{
+    for (std::size_t i = 0; i < n; ++i) out[i] = (high[i] + low[i] + close[i]) / 3.0 * volume[i];
+}
+
+void safeRatioScalar(const double* a, const double* b, std::size_t n, double* out)
+{
+    for (std::size_t i = 0; i < n; ++i) out[i] = b[i] > 0.0 ? a[i] / b[i] : 0.0;
+}
+
+void bandsScalar(const double* mean, const double* meanSquare, std::size_t n, double width, double* upper, double* lower)
+{
+    for (std::size_t i = 0; i < n; ++i) {
+        const double deviation = std::sqrt(std::max(0.0, meanSquare[i] - mean[i] * mean[i]));
+        upper[i] = mean[i] + width * deviation;
+        lower[i] = mean[i] - width * deviation;
+    }
+}
+
+void andGreaterScalar(const double* a, double aScale, const double* b, double bScale, std::size_t n, bool orEqual,
+                      unsigned char* mask)
+{
+    if (orEqual) {
+        for (std::size_t i = 0; i < n; ++i) mask[i] &= aScale * a[i] >= bScale * b[i];
+    } else {
+        for (std::size_t i = 0; i < n; ++i) mask[i] &= aScale * a[i] > bScale * b[i];
+    }
+}
+
+const KernelOps kScalarOps = {
+    "scalar", windowMeanScalar, windowMeanDirectScalar, differenceScalar, maxOfScalar, minOfScalar,
+    trueRangeScalar, typicalVolumeScalar, safeRatioScalar, bandsScalar, andGreaterScalar,
+};
+
+#ifdef BTE_KERNELS_X86
+
+// --- SSE2 (baseline on x86-64) ---
+
+void windowMeanSse2(const double* prefix, std::size_t n, int period, double* out)
+{
+    const __m128d divisor = _mm_set1_pd(period);
+    std::size_t i = 0;
+    for (; i + 2 <= n; i += 2) {
+        __m128d sum = _mm_sub_pd(_mm_loadu_pd(prefix + i + period), _mm_loadu_pd(prefix + i));
+        _mm_storeu_pd(out + i, _mm_div_pd(sum, divisor));
+    }
+    windowMeanScalar(prefix + i, n - i, period, out + i);
+}
+
+void windowMeanDirectSse2(const double* values, std::size_t n, int period, double* out)
+{
+    const __m128d divisor = _mm_set1_pd(period);
+    std::size_t i = 0;
+    for (; i + 2 <= n; i += 2) {
+        __m128d sum = _mm_setzero_pd();
+        for (int k = 0; k < period; ++k) sum = _mm_add_pd(sum, _mm_loadu_pd(values + i + k));
+        _mm_storeu_pd(out + i, _mm_div_pd(sum, divisor));
+    }
+    windowMeanDirectScalar(values + i, n - i, period, out + i);
+}
+
+void differenceSse2(const double* a, const double* b, std::size_t n, double* out)
+{
+    std::size_t i = 0;
+    for (; i + 2 <= n; i += 2) _mm_storeu_pd(out + i, _mm_sub_pd(_mm_loadu_pd(a + i), _mm_loadu_pd(b + i)));
+    differenceScalar(a + i, b + i, n - i, out + i);
+}
+
+void maxOfSse2(const double* a, const double* b, std::size_t n, double* out)
+{
+    std::size_t i = 0;
+    for (; i + 2 <= n; i += 2) _mm_storeu_pd(out + i, _mm_max_pd(_mm_loadu_pd(a + i), _mm_loadu_pd(b + i)));
+    maxOfScalar(a + i, b + i, n - i, out + i);
+}
+
+void minOfSse2(const double* a, const double* b, std::size_t n, double* out)
+{
+    std::size_t i = 0;
+    for (; i + 2 <= n; i += 2) _mm_storeu_pd(out + i, _mm_min_pd(_mm_loadu_pd(a + i), _mm_loadu_pd(b + i)));
+    minOfScalar(a + i, b + i, n - i, out + i);
+}
+
+void trueRangeSse2(const double* high, const double* low, const double* prevClose, std::size_t n, double* out)
+{
+    std::size_t i = 0;
+    for (; i + 2 <= n; i += 2) {
+        const __m128d c = _mm_loadu_pd(prevClose + i);
+        const __m128d top = _mm_max_pd(_mm_loadu_pd(high + i), c);
+        const __m128d bottom = _mm_min_pd(_mm_loadu_pd(low + i), c);
+        _mm_storeu_pd(out + i, _mm_sub_pd(top, bottom));
+    }
+    trueRangeScalar(high + i, low + i, prevClose + i, n - i, out + i);
+}
+
+void typicalVolumeSse2(const double* high, const double* low, const double* close, const double* volume,
+                       std::size_t n, double* out)
+{
+    const __m128d three = _mm_set1_pd(3.0);
+    std::size_t i = 0;
+    for (; i + 2 <= n; i += 2) {
+        __m128d typical = _mm_add_pd(_mm_add_pd(_mm_loadu_pd(high + i), _mm_loadu_pd(low + i)), _mm_loadu_pd(close + i));
+        _mm_storeu_pd(out + i, _mm_mul_pd(_mm_div_pd(typical, three), _mm_loadu_pd(volume + i)));
+    }
+    typicalVolumeScalar(high + i, low + i, close + i, volume + i, n - i, out + i);
+}
+
+void safeRatioSse2(const double* a, const double* b, std::size_t n, double* out)
+{
+    const __m128d zero = _mm_setzero_pd();
+    std::size_t i = 0;
+    for (; i + 2 <= n; i += 2) {
+        const __m128d denominator = _mm_loadu_pd(b + i);
+        const __m128d positive = _mm_cmpgt_pd(denominator, zero);
+        _mm_storeu_pd(out + i, _mm_and_pd(positive, _mm_div_pd(_mm_loadu_pd(a + i), denominator)));
+    }
+    safeRatioScalar(a + i, b + i, n - i, out + i);
+}
+
+void bandsSse2(const double* mean, const double* meanSquare, std::size_t n, double width, double* upper, double* lower)
+{
+    const __m128d zero = _mm_setzero_pd();
+    const __m128d w = _mm_set1_pd(width);
+    std::size_t i = 0;
+    for (; i + 2 <= n; i += 2) {
+        const __m128d m = _mm_loadu_pd(mean + i);
+        const __m128d variance = _mm_max_pd(zero, _mm_sub_pd(_mm_loadu_pd(meanSquare + i), _mm_mul_pd(m, m)));
+        const __m128d offset = _mm_mul_pd(w, _mm_sqrt_pd(variance));
+        _mm_storeu_pd(upper + i, _mm_add_pd(m, offset));
+        _mm_storeu_pd(lower + i, _mm_sub_pd(m, offset));
+    }
+    bandsScalar(mean + i, meanSquare + i, n - i, width, upper + i, lower + i);
+}
+
+void andGreaterSse2(const double* a, double aScale, const double* b, double bScale, std::size_t n, bool orEqual,
+                    unsigned char* mask)
+{
+    const __m128d sa = _mm_set1_pd(aScale);
+    const __m128d sb = _mm_set1_pd(bScale);
+    std::size_t i = 0;
+    for (; i + 2 <= n; i += 2) {
+        const __m128d left = _mm_mul_pd(sa, _mm_loadu_pd(a + i));
+        const __m128d right = _mm_mul_pd(sb, _mm_loadu_pd(b + i));
+        const int bits = _mm_movemask_pd(orEqual ? _mm_cmpge_pd(left, right) : _mm_cmpgt_pd(left, right));
+        const std::uint32_t bytes = kMaskBytes[bits];
+        mask[i] &= static_cast<unsigned char>(bytes);
+        mask[i + 1] &= static_cast<unsigned char>(bytes >> 8);
+    }
+    andGreaterScalar(a + i, aScale, b + i, bScale, n - i, orEqual, mask + i);
+}
+
+const KernelOps kSse2Ops = {
+    "SSE2", windowMeanSse2, windowMeanDirectSse2, differenceSse2, maxOfSse2, minOfSse2,
+    trueRangeSse2, typicalVolumeSse2, safeRatioSse2, bandsSse2, andGreaterSse2,
+};
+
+// --- AVX2 ---
+
+BTE_TARGET_AVX2 void windowMeanAvx2(const double* prefix, std::size_t n, int period, double* out)
+{
+    const __m256d divisor = _mm256_set1_pd(period);
+    std::size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        __m256d sum = _mm256_sub_pd(_mm256_loadu_pd(prefix + i + period), _mm256_loadu_pd(prefix + i));
+        _mm256_storeu_pd(out + i, _mm256_div_pd(sum, divisor));
+    }
+    windowMeanScalar(prefix + i, n - i, period, out + i);
+}
+
+BTE_TARGET_AVX2 void windowMeanDirectAvx2(const double* values, std::size_t n, int period, double* out)
+{
+    const __m256d divisor = _mm256_set1_pd(period);
+    std::size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        __m256d sum = _mm256_setzero_pd();
+        for (int k = 0; k < period; ++k) sum = _mm256_add_pd(sum, _mm256_loadu_pd(values + i + k));
+        _mm256_storeu_pd(out + i, _mm256_div_pd(sum, divisor));
+    }
+    windowMeanDirectScalar(values + i, n - i, period, out + i);
+}
+
+BTE_TARGET_AVX2 void differenceAvx2(const double* a, const double* b, std::size_t n, double* out)
+{
+    std::size_t i = 0;
+    for (; i + 4 <= n; i += 4) _mm256_storeu_pd(out + i, _mm256_sub_pd(_mm256_loadu_pd(a + i), _mm256_loadu_pd(b + i)));
+    differenceScalar(a + i, b + i, n - i, out + i);
+}
+
+BTE_TARGET_AVX2 void maxOfAvx2(const double* a, const double* b, std::size_t n, double* out)
+{
+    std::size_t i = 0;
+    for (; i + 4 <= n; i += 4) _mm256_storeu_pd(out + i, _mm256_max_pd(_mm256_loadu_pd(a + i), _mm256_loadu_pd(b + i)));
+    maxOfScalar(a + i, b + i, n - i, out + i);
+}
+
+BTE_TARGET_AVX2 void minOfAvx2(const double* a, const double* b, std::size_t n, double* out)
+{
+    std::size_t i = 0;
+    for (; i + 4 <= n; i += 4) _mm256_storeu_pd(out + i, _mm256_min_pd(_mm256_loadu_pd(a + i), _mm256_loadu_pd(b + i)));
+    minOfScalar(a + i, b + i, n - i, out + i);
+}
+
+BTE_TARGET_AVX2 void trueRangeAvx2(const double* high, const double* low, const double* prevClose, std::size_t n,
+                                   double* out)
+{
+    std::size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        const __m256d c = _mm256_loadu_pd(prevClose + i);
+        const __m256d top = _mm256_max_pd(_mm256_loadu_pd(high + i), c);
+        const __m256d bottom = _mm256_min_pd(_mm256_loadu_pd(low + i), c);
+        _mm256_storeu_pd(out + i, _mm256_sub_pd(top, bottom));
+    }
+    trueRangeScalar(high + i, low + i, prevClose + i, n - i, out + i);
+}
+
+BTE_TARGET_AVX2 void typicalVolumeAvx2(const double* high, const double* low, const double* close,
+                                       const double* volume, std::size_t n, double* out)
+{
+    const __m256d three = _mm256_set1_pd(3.0);
+    std::size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        __m256d typical = _mm256_add_pd(_mm256_add_pd(_mm256_loadu_pd(high + i), _mm256_loadu_pd(low + i)),
+                                        _mm256_loadu_pd(close + i));
+        _mm256_storeu_pd(out + i, _mm256_mul_pd(_mm256_div_pd(typical, three), _mm256_loadu_pd(volume + i)));
+    }
+    typicalVolumeScalar(high + i, low + i, close + i, volume + i, n - i, out + i);
+}
+
+BTE_TARGET_AVX2 void safeRatioAvx2(const double* a, const double* b, std::size_t n, double* out)
+{
+    const __m256d zero = _mm256_setzero_pd();
+    std::size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        const __m256d denominator = _mm256_loadu_pd(b + i);
+        const __m256d positive = _mm256_cmp_pd(denominator, zero, _CMP_GT_OQ);
+        _mm256_storeu_pd(out + i, _mm256_and_pd(positive, _mm256_div_pd(_mm256_loadu_pd(a + i), denominator)));
+    }
+    safeRatioScalar(a + i, b + i, n - i, out + i);
+}
+
+BTE_TARGET_AVX2 void bandsAvx2(const double* mean, const double* meanSquare, std::size_t n, double width,
+                               double* upper, double* lower)
+{
+    const __m256d zero = _mm256_setzero_pd();
+    const __m256d w = _mm256_set1_pd(width);
+    std::size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        const __m256d m = _mm256_loadu_pd(mean + i);
+        const __m256d variance = _mm256_max_pd(zero, _mm256_sub_pd(_mm256_loadu_pd(meanSquare + i), _mm256_mul_pd(m, m)));
+        const __m256d offset = _mm256_mul_pd(w, _mm256_sqrt_pd(variance));
+        _mm256_storeu_pd(upper + i, _mm256_add_pd(m, offset));
+        _mm256_storeu_pd(lower + i, _mm256_sub_pd(m, offset));
+    }
+    bandsScalar(mean + i, meanSquare + i, n - i, width, upper + i, lower + i);
+}
+
+BTE_TARGET_AVX2 void andGreaterAvx2(const double* a, double aScale, const double* b, double bScale, std::size_t n,
+                                    bool orEqual, unsigned char* mask)
+{
+    const __m256d sa = _mm256_set1_pd(aScale);
+    const __m256d sb = _mm256_set1_pd(bScale);
+    std::size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        const __m256d left = _mm256_mul_pd(sa, _mm256_loadu_pd(a + i));
+        const __m256d right = _mm256_mul_pd(sb, _mm256_loadu_pd(b + i));
+        const __m256d hit = orEqual ? _mm256_cmp_pd(left, right, _CMP_GE_OQ) : _mm256_cmp_pd(left, right, _CMP_GT_OQ);
+        std::uint32_t bytes;
+        std::memcpy(&bytes, mask + i, sizeof(bytes));
+        bytes &= kMaskBytes[_mm256_movemask_pd(hit)];
+        std::memcpy(mask + i, &bytes, sizeof(bytes));
+    }
+    andGreaterScalar(a + i, aScale, b + i, bScale, n - i, orEqual, mask + i);
+}
+
+const KernelOps kAvx2Ops = {
+    "AVX2", windowMeanAvx2, windowMeanDirectAvx2, differenceAvx2, maxOfAvx2, minOfAvx2,
+    trueRangeAvx2, typicalVolumeAvx2, safeRatioAvx2, bandsAvx2, andGreaterAvx2,
+};
+
+bool cpuHasAvx2()
+{
+#if defined(_MSC_VER) && !defined(__clang__)
+    int info[4];
+    __cpuid(info, 0);
+    if (info[0] < 7) return false;
+    __cpuid(info, 1);
+    const bool osSavesYmm = (info[2] & (1 << 27)) && (_xgetbv(0) & 0x6) == 0x6;
+    if (!osSavesYmm || !(info[2] & (1 << 28))) return false;
+    __cpuidex(info, 7, 0);
+    return (info[1] & (1 << 5)) != 0;
+#else
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("avx2");
+#endif
+}
+
+#endif // BTE_KERNELS_X86
+
+// Picked on first use. BTE_INDICATOR_KERNELS=scalar|sse2 forces a narrower path, e.g. to compare them.
+const KernelOps& selectOps()
+{
+    const char* forced = std::getenv("BTE_INDICATOR_KERNELS");
+    if (forced && std::strcmp(forced, "scalar") == 0) {
+        return kScalarOps;
+    }
+#ifdef BTE_KERNELS_X86
+    if (forced && std::strcmp(forced, "sse2") == 0) {
+        return kSse2Ops;
+    }
+    return cpuHasAvx2() ? kAvx2Ops : kSse2Ops;
+#else
+    return kScalarOps;
+#endif
+}
+
+const KernelOps& ops()
+{
+    static const KernelOps& selected = selectOps();
+    return selected;
+}
+
+// ------------------------
+// Helpers
+// ------------------------
+
+bool tooShort(std::size_t n, int period, double* out)
+{
+    if (period > 0 && n >= static_cast<std::size_t>(period)) {
+        return false;
+    }
+    std::fill(out, out + n, 0.0);
+    return true;
+}
+
+// prefix[i] = values[0] + ... + values[i - 1]
+std::vector<double> prefixSums(const double* values, std::size_t n)
+{
+    std::vector<double> prefix(n + 1);
+    prefix[0] = 0.0;
+    for (std::size_t i = 0; i < n; ++i) prefix[i + 1] = prefix[i] + values[i];
+    return prefix;
+}
+
+// Up to this period windows are summed directly, which matches the per-bar loops the backtest
+// used to run bit for bit; longer windows use prefix sums to stay O(1) per bar.
+constexpr int kDirectWindowMax = 32;
+
+// out[i] = mean of values[i - period + 1 .. i], 0 before the first complete window
+void windowMeans(const double* values, std::size_t n, int period, double* out)
+{
+    std::fill(out, out + period - 1, 0.0);
+    if (period <= kDirectWindowMax) {
+        ops().windowMeanDirect(values, n - period + 1, period, out + period - 1);
+        return;
+    }
+    std::vector<double> prefix = prefixSums(values, n);
+    ops().windowMean(prefix.data(), n - period + 1, period, out + period - 1);
+}
+
+// Van Herk / Gil-Werman: per-block running extremes forwards and backwards, then one vectorized
+// merge, so each output costs O(1) whatever the period.
+template <typename Pick>
+void rollingExtreme(const double* values, std::size_t n, int period, double* out, Pick pick,
+                    void (*merge)(const double*, const double*, std::size_t, double*))
+{
+    const std::size_t p = static_cast<std::size_t>(period);
+    std::vector<double> forward(n), backward(n);
+    for (std::size_t i = 0; i < n; ++i) {
+        forward[i] = i % p == 0 ? values[i] : pick(forward[i - 1], values[i]);
+    }
+    for (std::size_t i = n; i-- > 0;) {
+        backward[i] = (i + 1) % p == 0 || i + 1 == n ? values[i] : pick(backward[i + 1], values[i]);
+    }
+    std::fill(out, out + p - 1, 0.0);
+    merge(backward.data(), forward.data() + p - 1, n - p + 1, out + p - 1);
+}
+
+} // namespace
+
+// ------------------------
+// Kernels
+// ------------------------
+
+void smaSeries(const double* values, std::size_t n, int period, double* out)
+{
+    if (tooShort(n, period, out)) return;
+    windowMeans(values, n, period, out);
+}
+
+void emaSeries(const double* values, std::size_t n, int period, double* out)
+{
+    if (tooShort(n, period, out)) return;
+    double ema = 0.0;
+    for (int i = 0; i < period; ++i) {
+        out[i] = 0.0;
+        ema += values[i];
+    }
+    ema /= period;
+    out[period - 1] = ema;
+
+    const double alpha = 2.0 / (period + 1.0);
+    for (std::size_t i = static_cast<std::size_t>(period); i < n; ++i) {
+        ema += alpha * (values[i] - ema);
+        out[i] = ema;
+    }
+}
+
+void adrSeries(const double* high, const double* low, std::size_t n, int period, double* out)
+{
+    if (tooShort(n, period, out)) return;
+    std::vector<double> range(n);
+    ops().difference(high, low, n, range.data());
+    windowMeans(range.data(), n, period, out);
+}
+
+void atrSeries(const double* high, const double* low, const double* close, std::size_t n, int period, double* out)
+{
+    if (tooShort(n, period, out)) return;
+    // The first bar has no previous close, so its true range is just high - low
+    std::vector<double> range(n);
+    range[0] = high[0] - low[0];
+    ops().trueRange(high + 1, low + 1, close, n - 1, range.data() + 1);
+
+    double atr = 0.0;
+    for (int i = 0; i < period; ++i) {
+        out[i] = 0.0;
+        atr += range[static_cast<std::size_t>(i)];
+    }
+    atr /= period;
+    out[period - 1] = atr;
+    for (std::size_t i = static_cast<std::size_t>(period); i < n; ++i) {
+        atr = (atr * (period - 1) + range[i]) / period;
+        out[i] = atr;
+    }
+}
+
+void rsiSeries(const double* close, std::size_t n, int period, double* out)
+{
+    if (period <= 0 || n <= static_cast<std::size_t>(period)) {
+        std::fill(out, out + n, 0.0);
+        return;
+    }
+
+    double gain = 0.0;
+    double loss = 0.0;
+    for (int i = 1; i <= period; ++i) {
+        const double change = close[i] - close[i - 1];
+        (change > 0.0 ? gain : loss) += std::abs(change);
+    }
+    gain /= period;
+    loss /= period;
+
+    std::fill(out, out + period, 0.0);
+    for (std::size_t i = static_cast<std::size_t>(period); i < n; ++i) {
+        if (i > static_cast<std::size_t>(period)) {
+            const double change = close[i] - close[i - 1];
+            gain = (gain * (period - 1) + std::max(change, 0.0)) / period;
+            loss = (loss * (period - 1) + std::max(-change, 0.0)) / period;
+        }
+        out[i] = loss == 0.0 ? 100.0 : 100.0 - 100.0 / (1.0 + gain / loss);
+    }
+}
+
+void bollingerSeries(const double* values, std::size_t n, int period, double width,
+                     double* middle, double* upper, double* lower)
+{
+    if (tooShort(n, period, middle)) {
+        std::fill(upper, upper + n, 0.0);
+        std::fill(lower, lower + n, 0.0);
+        return;
+    }
+    // Variance comes from E[x^2] - E[x]^2 over prefix sums. Measuring from the first value keeps
+    // those sums small, so little precision is lost to cancellation.
+    const double origin = values[0];
+    std::vector<double> shifted(n), squares(n);
+    for (std::size_t i = 0; i < n; ++i) {
+        shifted[i] = values[i] - origin;
+        squares[i] = shifted[i] * shifted[i];
+    }
+    std::vector<double> shiftedMean(n), meanSquare(n);
+    windowMeans(values, n, period, middle);
+    windowMeans(shifted.data(), n, period, shiftedMean.data());
+    windowMeans(squares.data(), n, period, meanSquare.data());
+
+    const std::size_t first = static_cast<std::size_t>(period) - 1;
+    std::fill(upper, upper + first, 0.0);
+    std::fill(lower, lower + first, 0.0);
+    ops().bands(shiftedMean.data() + first, meanSquare.data() + first, n - first, width, upper + first, lower + first);
+    for (std::size_t i = first; i < n; ++i) {
+        upper[i] += origin;
+        lower[i] += origin;
+    }
+}
+
+void rollingMaxSeries(const double* values, std::size_t n, int period, double* out)
+{
+    if (tooShort(n, period, out)) return;
+    rollingExtreme(values, n, period, out, [](double a, double b) { return std::max(a, b); }, ops().maxOf);
+}
+
+void rollingMinSeries(const double* values, std::size_t n, int period, double* out)
+{
+    if (tooShort(n, period, out)) return;
+    rollingExtreme(values, n, period, out, [](double a, double b) { return std::min(a, b); }, ops().minOf);
+}
+
+void vwapSeries(const double* high, const double* low, const double* close, const double* volume,
+                std::size_t n, int period, double* out)
+{
+    if (tooShort(n, period, out)) return;
+    std::vector<double> priceVolume(n);
+    ops().typicalVolume(high, low, close, volume, n, priceVolume.data());
+
+    // Ratio of the window means is the ratio of the window sums
+    std::vector<double> meanPriceVolume(n), meanVolume(n);
+    windowMeans(priceVolume.data(), n, period, meanPriceVolume.data());
+    windowMeans(volume, n, period, meanVolume.data());
+    std::fill(out, out + n, 0.0);
+    const std::size_t first = static_cast<std::size_t>(period) - 1;
+    ops().safeRatio(meanPriceVolume.data() + first, meanVolume.data() + first, n - first, out + first);
+}
+
+void andGreaterMask(const double* a, double aScale, const double* b, double bScale, std::size_t n, bool orEqual,
+                    unsigned char* mask)
+{
+    ops().andGreater(a, aScale, b, bScale, n, orEqual, mask);
+}
+
+const char* indicatorKernelPath()
+{
+    return ops().name;
+}
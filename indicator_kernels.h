@@ -0,0 +1,42 @@
+#ifndef INDICATOR_KERNELS_H
+#define INDICATOR_KERNELS_H
+
+#include <cstddef>
+
+// Indicator series over contiguous arrays of n bars, oldest first. Each kernel writes n values to
+// out; values before the first complete period are 0, as the chart and the backtest expect.
+//
+// The element-wise parts (window sums from prefix sums, true range, band widths, rolling max/min
+// merges) run on AVX2 or SSE2 when the CPU has them, chosen once at startup, with a scalar
+// fallback elsewhere. Recurrences (EMA, Wilder smoothing) are inherently sequential and stay scalar.
+
+// Simple moving average, out[i] = mean of values[i - period + 1 .. i]
+void smaSeries(const double* values, std::size_t n, int period, double* out);
+// Exponential moving average seeded with the SMA of the first period values
+void emaSeries(const double* values, std::size_t n, int period, double* out);
+// Average daily range: mean of high - low over period bars
+void adrSeries(const double* high, const double* low, std::size_t n, int period, double* out);
+// Average true range with Wilder smoothing, seeded with the mean of the first period true ranges
+void atrSeries(const double* high, const double* low, const double* close, std::size_t n, int period, double* out);
+// Wilder's relative strength index, 0..100, defined from bar period on
+void rsiSeries(const double* close, std::size_t n, int period, double* out);
+// Bollinger bands: SMA plus and minus width population standard deviations
+void bollingerSeries(const double* values, std::size_t n, int period, double width,
+                     double* middle, double* upper, double* lower);
+// Donchian channel edges: highest value and lowest value over period bars
+void rollingMaxSeries(const double* values, std::size_t n, int period, double* out);
+void rollingMinSeries(const double* values, std::size_t n, int period, double* out);
+// Volume-weighted average of the typical price (high + low + close) / 3 over period bars
+void vwapSeries(const double* high, const double* low, const double* close, const double* volume,
+                std::size_t n, int period, double* out);
+
+// Signal arrays for rule-based strategies, see signal_backtest.h.
+// mask[i] is left at 1 only where aScale * a[i] > bScale * b[i] (>= with orEqual); comparisons
+// involving NaN are false. For < and <= swap the operands.
+void andGreaterMask(const double* a, double aScale, const double* b, double bScale, std::size_t n, bool orEqual,
+                    unsigned char* mask);
+
+// "AVX2", "SSE2" or "scalar"
+const char* indicatorKernelPath();
+
+#endif // INDICATOR_KERNELS_H
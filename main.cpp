@@ -2,18 +2,29 @@
 #include <QMainWindow>
 #include <QHBoxLayout>
 #include <QStackedWidget>
+#include <QMessageBox>
 #include "mainwindow.h"
 #include "menu.h"
 #include "backtest.h"
 #include "chartingpage.h"
 #include "backtest_engine.h"// Our container class
-
-#include <sqlite3.h>
+#include "watchlistpage.h"
+#include "screenerpage.h"
+#include "database.h"
 
 int main(int argc, char *argv[])
 {
     QApplication a(argc, argv);
 
+    // One writer plus a pool of WAL readers shared by every page
+    if (!Database::instance().open("Universe_OHLCV.db")) {
+        QMessageBox::critical(nullptr, "Database",
+                              QString("Could not open Universe_OHLCV.db: %1.\n"
+                                      "It may have been written by a newer version of the application.")
+                                  .arg(QString::fromStdString(Database::instance().lastError())));
+        return 1;
+    }
+
     QMainWindow mainWindow;
     QWidget *centralWidget = new QWidget();
     QStackedWidget *stackedWidget = new QStackedWidget();
@@ -25,10 +36,6 @@ int main(int argc, char *argv[])
     // Page 2: ChartingPage
     ChartingPage *chartingPage = new ChartingPage();
 
-    // Open the database and configure the chart widget
-    sqlite3* db;
-    sqlite3_open("Universe_OHLCV.db", &db);
-    chartingPage->getChartWidget()->setDatabase(db);
     chartingPage->getChartWidget()->loadTicker("SPY", true);
 
     stackedWidget->addWidget(chartingPage);
@@ -37,6 +44,17 @@ int main(int argc, char *argv[])
     backtest_engine *backtestEngine = new backtest_engine();
     stackedWidget->addWidget(backtestEngine);
 
+    // Finished runs show up in the chart's run selector
+    QObject::connect(backtestEngine, &backtest_engine::runCompleted, chartingPage, &ChartingPage::addBacktestRun);
+
+    // Page 4: Watchlist
+    WatchlistPage *watchlistPage = new WatchlistPage();
+    stackedWidget->addWidget(watchlistPage);
+
+    // Page 5: Screener
+    ScreenerPage *screenerPage = new ScreenerPage();
+    stackedWidget->addWidget(screenerPage);
+
     // For testing purposes, run backtest.
     //Backtest backtest;
     //backtest.run(db, "AAPL");
@@ -46,6 +64,16 @@ int main(int argc, char *argv[])
     menu->setFixedWidth(200);
     QObject::connect(menu, &Menu::navigateToPage, stackedWidget, &QStackedWidget::setCurrentIndex);
 
+    // Double-clicking a watchlist chart opens it on the charting page
+    QObject::connect(watchlistPage, &WatchlistPage::symbolActivated, chartingPage, &ChartingPage::showSymbol);
+    QObject::connect(watchlistPage, &WatchlistPage::symbolActivated, menu, [menu]() { menu->setCurrentRow(1); });
+
+    // Screen matches open on the charting page, or as a group in the watchlist
+    QObject::connect(screenerPage, &ScreenerPage::symbolActivated, chartingPage, &ChartingPage::showSymbol);
+    QObject::connect(screenerPage, &ScreenerPage::symbolActivated, menu, [menu]() { menu->setCurrentRow(1); });
+    QObject::connect(screenerPage, &ScreenerPage::showSymbols, watchlistPage, &WatchlistPage::setSymbols);
+    QObject::connect(screenerPage, &ScreenerPage::showSymbols, menu, [menu]() { menu->setCurrentRow(3); });
+
     QHBoxLayout *mainLayout = new QHBoxLayout(centralWidget);
     mainLayout->addWidget(menu);
     mainLayout->addWidget(stackedWidget);
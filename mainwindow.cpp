@@ -2,6 +2,7 @@
 #include "authenticate.h"
 #include "fetch_data.h"
 #include "manage_db.h"
+#include "database.h"
 #include "./ui_mainwindow.h"
 #include "menu.h"
 
@@ -11,6 +12,7 @@
 #include <QUrl>
 #include <QInputDialog>
 #include <QDir>
+#include <QFileDialog>
 #include <QStackedWidget>
 #include <QVBoxLayout>
 #include <sstream>
@@ -21,7 +23,6 @@
 MainWindow::MainWindow(QWidget *parent)
     : QMainWindow(parent)
     , ui(new Ui::MainWindow)
-    , DB(nullptr)
     {
 
     QStackedWidget *stackedWidget = new QStackedWidget;
@@ -46,10 +47,12 @@ MainWindow::MainWindow(QWidget *parent)
 
     ui->setupUi(this);
 
-    // Open SQLite Database
-    int exit = sqlite3_open("Universe_OHLCV.db", &DB);
-    if (exit) {
-        ui->dataOutput->setText("Error opening database: " + QString::fromStdString(sqlite3_errmsg(DB)));
+    // The shared database is opened (and migrated) in main()
+    Database& database = Database::instance();
+    if (!database.isOpen()) {
+        ui->dataOutput->setText("Error opening database: " + QString::fromStdString(database.lastError()));
+    } else if (!database.lastError().empty()) {
+        ui->dataOutput->setText("Database opened, but the schema migration failed.");
     } else {
         ui->dataOutput->setText("Database opened successfully!");
     }
@@ -67,21 +70,30 @@ MainWindow::MainWindow(QWidget *parent)
 
 MainWindow::~MainWindow()
 {
-    if (DB) {
-        sqlite3_close(DB);
-    }
-
     delete ui;
 }
 
 void MainWindow::createDatabase_clicked()
 {
-    createDatabase(DB);
+    QString csvPath = QFileDialog::getOpenFileName(this, tr("Select price history CSV"), QString(),
+                                                   tr("CSV files (*.csv);;All files (*)"));
+    if (csvPath.isEmpty()) {
+        return;
+    }
+    DbLease db = Database::instance().writer();
+    if (!db) {
+        ui->dataOutput->setText("Database is not open.");
+        return;
+    }
+    createDatabase(*db, csvPath.toStdString(), ui->dataOutput);
 }
 
 void MainWindow::removeDuplicates_clicked()
 {
-    removeDuplicates(DB);
+    DbLease db = Database::instance().writer();
+    if (db) {
+        removeDuplicates(*db);
+    }
 }
 
 void MainWindow::queryStock_clicked()
@@ -97,7 +109,12 @@ void MainWindow::queryStock_clicked()
     std::ostringstream outputStream;
     std::streambuf* oldCout = std::cout.rdbuf(outputStream.rdbuf());
 
-    queryStock(DB, ticker.toStdString());
+    {
+        DbLease db = Database::instance().reader();
+        if (db) {
+            queryStock(*db, tickerStr);
+        }
+    }
 
     std::cout.rdbuf(oldCout);
     ui->dataOutput->setPlainText(QString::fromStdString(outputStream.str()));  // Display result
@@ -163,7 +180,7 @@ void MainWindow::fetchStock_clicked()
     std::ostringstream outputStream;
     std::streambuf* oldCout = std::cout.rdbuf(outputStream.rdbuf());
 
-    handleFetchStockData(DB, tickerStr);  // Pass the ticker symbol
+    handleFetchStockData(tickerStr);  // Pass the ticker symbol
 
     std::cout.rdbuf(oldCout);
     ui->dataOutput->setPlainText(QString::fromStdString(outputStream.str()));  // Display result
@@ -190,5 +207,5 @@ void MainWindow::dataOutput()
 
 void MainWindow::updateAll_clicked()
 {
-    updatePriceHistory(DB, ui->dataOutput);
+    updatePriceHistory(ui->dataOutput);
 }
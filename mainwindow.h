@@ -5,7 +5,6 @@
 #include <QLineEdit>
 #include <QPushButton>
 #include <QTextEdit>
-#include <sqlite3.h>
 
 QT_BEGIN_NAMESPACE
 namespace Ui {
@@ -34,7 +33,6 @@ private slots:
 
 private:
     Ui::MainWindow *ui;
-    sqlite3* DB;
 
 };
 #endif // MAINWINDOW_H
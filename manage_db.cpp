@@ -18,135 +18,77 @@
 
 #include "authenticate.h"
 #include "fetch_data.h"
+#include "bulk_import.h"
+#include "bar_repository.h"
+#include "db_schema.h"
+#include "day_number.h"
 
 // ------------------------
 // Database Functions
 // ------------------------
 
-void removeDuplicates(sqlite3* DB) {
-    const char* deleteSQL =
-        "WITH Duplicates AS ("
-        "    SELECT rowid FROM Stocks "
-        "    WHERE rowid NOT IN ("
-        "        SELECT MIN(rowid) FROM Stocks GROUP BY ticker, date"
-        "    )"
-        ") "
-        "DELETE FROM Stocks WHERE rowid IN (SELECT rowid FROM Duplicates);";
-
-    char* errorMessage;
-    int exit = sqlite3_exec(DB, deleteSQL, NULL, NULL, &errorMessage);
-    if (exit != SQLITE_OK) {
-        std::cerr << "Error removing duplicates: " << errorMessage << std::endl;
-        sqlite3_free(errorMessage);
+// Uniqueness is enforced by the (ticker_id, day) primary key, so duplicates can only exist in a
+// database that predates it. Running the schema migration rebuilds and dedupes such a table once.
+void removeDuplicates(DbConnection& db) {
+    if (ensureSchema(db.handle())) {
+        std::cout << "Bars are keyed by (ticker_id, day); no duplicates remain." << std::endl;
     }
     else {
-        std::cout << "Duplicates removed successfully!" << std::endl;
+        std::cerr << "Error migrating database schema." << std::endl;
     }
 }
 
 
-void createDatabase(sqlite3* DB) {
-    char* errorMessage;
-    int exit = sqlite3_open("Universe_OHLCV.db", &DB);
-    if (exit) {
-        std::cerr << "Error opening database: " << sqlite3_errmsg(DB) << std::endl;
+void createDatabase(DbConnection& db, const std::string& csvPath, QTextEdit* outputWidget) {
+    if (!ensureSchema(db.handle())) {
+        outputWidget->append("Error creating or migrating the database schema.");
         return;
     }
-    std::cout << "Database opened successfully!" << std::endl;
-
-    std::string createTableSQL = "CREATE TABLE IF NOT EXISTS Stocks ("
-                                 "open REAL, "
-                                 "high REAL, "
-                                 "low REAL, "
-                                 "close REAL, "
-                                 "volume INTEGER,"
-                                 "ticker TEXT, "
-                                 "date TEXT);";
-    exit = sqlite3_exec(DB, createTableSQL.c_str(), NULL, 0, &errorMessage);
-    if (exit != SQLITE_OK) {
-        std::cerr << "Error creating table: " << errorMessage << std::endl;
-        sqlite3_free(errorMessage);
-    }
-    else {
-        std::cout << "Table created successfully!" << std::endl;
-    }
 
-    std::ifstream file("C:\\Users\\Vincents XPS\\Desktop\\Scripts\\Project\\universe_price_history.csv");
-    if (!file.is_open()) {
-        std::cerr << "Error opening CSV file!" << std::endl;
-    }
-    std::string line;
-    std::getline(file, line);
-
-    sqlite3_stmt* stmt;
-    std::string insertSQL = "INSERT INTO Stocks (open, high, low, close, volume, ticker, date) VALUES (?, ?, ?, ?, ?, ?, ?);";
-    sqlite3_prepare_v2(DB, insertSQL.c_str(), -1, &stmt, NULL);
-
-    std::string ticker, date;
-    double open, high, low, close;
-    int volume;
-
-    sqlite3_exec(DB, "PRAGMA synchronous = OFF;", NULL, NULL, NULL);
-    sqlite3_exec(DB, "PRAGMA journal_mode = MEMORY;", NULL, NULL, NULL);
-    sqlite3_exec(DB, "BEGIN TRANSACTION;", NULL, NULL, NULL);
-
-    while (std::getline(file, line)) {
-        std::stringstream ss(line);
-        ss >> open; ss.ignore();
-        ss >> high; ss.ignore();
-        ss >> low; ss.ignore();
-        ss >> close; ss.ignore();
-        ss >> volume; ss.ignore();
-        std::getline(ss, ticker, ',');
-        std::getline(ss, date);
-        sqlite3_bind_double(stmt, 1, open);
-        sqlite3_bind_double(stmt, 2, high);
-        sqlite3_bind_double(stmt, 3, low);
-        sqlite3_bind_double(stmt, 4, close);
-        sqlite3_bind_int(stmt, 5, volume);
-        sqlite3_bind_text(stmt, 6, ticker.c_str(), -1, SQLITE_STATIC);
-        sqlite3_bind_text(stmt, 7, date.c_str(), -1, SQLITE_STATIC);
-        if (sqlite3_step(stmt) != SQLITE_DONE) {
-            std::cerr << "Error inserting data: " << sqlite3_errmsg(DB) << std::endl;
+    outputWidget->append(QString::fromStdString("Importing " + csvPath));
+    QCoreApplication::processEvents();
+
+    // Report roughly once per second while the import runs
+    double lastReport = 0.0;
+    ImportStats stats;
+    bool ok = bulkImportCSV(db, csvPath, stats, [&](const ImportStats& progress) {
+        if (progress.seconds - lastReport < 1.0) {
+            return;
         }
-        sqlite3_reset(stmt);
+        lastReport = progress.seconds;
+        double percent = progress.totalBytes ? 100.0 * progress.bytesParsed / progress.totalBytes : 0.0;
+        outputWidget->append(QString("%1 rows (%2%), %3 rows/sec")
+                                 .arg(progress.rowsInserted)
+                                 .arg(percent, 0, 'f', 1)
+                                 .arg(static_cast<qlonglong>(progress.rowsPerSecond())));
+        QCoreApplication::processEvents();
+    });
+
+    if (!ok) {
+        outputWidget->append(QString::fromStdString("Error importing CSV file: " + csvPath));
+        return;
     }
-
-    sqlite3_exec(DB, "COMMIT;", NULL, NULL, NULL);
-    sqlite3_finalize(stmt);
-    file.close();
-    sqlite3_close(DB);
-    std::cout << "CSV data inserted into SQLite successfully!" << std::endl;
+    outputWidget->append(QString("Imported %1 rows (%2 rejected) in %3s, %4 rows/sec")
+                             .arg(stats.rowsInserted)
+                             .arg(stats.rowsRejected)
+                             .arg(stats.seconds, 0, 'f', 2)
+                             .arg(static_cast<qlonglong>(stats.rowsPerSecond())));
 }
 
-void queryStock(sqlite3* DB, std::string ticker) {
+void queryStock(DbConnection& db, std::string ticker) {
     std::transform(ticker.begin(), ticker.end(), ticker.begin(), ::toupper);
 
-    std::string querySQL = "SELECT * FROM Stocks WHERE ticker = ?;";
-    sqlite3_stmt* stmt;
-    if (sqlite3_prepare_v2(DB, querySQL.c_str(), -1, &stmt, NULL) != SQLITE_OK) {
-        std::cerr << "Error preparing query: " << sqlite3_errmsg(DB) << std::endl;
-        sqlite3_close(DB);
-        return;
-    }
-    sqlite3_bind_text(stmt, 1, ticker.c_str(), -1, SQLITE_STATIC);
+    BarView bars = BarRepository::instance().get(db, ticker);
     std::cout << "Results for ticker: " << ticker << "\n--------------------------------------\n";
     std::cout << "Open\tHigh\tLow\tClose\tVolume\tTicker\tDate\n";
-    while (sqlite3_step(stmt) == SQLITE_ROW) {
-        double open = sqlite3_column_double(stmt, 0);
-        double high = sqlite3_column_double(stmt, 1);
-        double low = sqlite3_column_double(stmt, 2);
-        double close = sqlite3_column_double(stmt, 3);
-        int volume = sqlite3_column_int(stmt, 4);
-        const unsigned char* tickerResult = sqlite3_column_text(stmt, 5);
-        const unsigned char* date = sqlite3_column_text(stmt, 6);
-        std::cout << open << "\t" << high << "\t" << low << "\t" << close
-                  << "\t" << volume << "\t" << tickerResult << "\t" << date << "\n";
+    for (std::size_t i = 0; i < bars.size(); ++i) {
+        std::cout << bars.open()[i] << "\t" << bars.high()[i] << "\t" << bars.low()[i] << "\t" << bars.close()[i]
+                  << "\t" << static_cast<long long>(bars.volume()[i]) << "\t" << ticker
+                  << "\t" << dayToString(bars.day()[i]) << "\n";
     }
-    sqlite3_finalize(stmt);
 }
 
-void updatePriceHistory(sqlite3* DB, QTextEdit* outputWidget) {
+void updatePriceHistory(QTextEdit* outputWidget) {
     std::ifstream file("C:\\BTE\\universe.csv");
     if (!file.is_open()) {
         outputWidget->append("Error opening CSV file!");
@@ -182,8 +124,12 @@ void updatePriceHistory(sqlite3* DB, QTextEdit* outputWidget) {
 
     if (!allCandles.empty()) {
          outputWidget->append(QString::fromStdString("Inserting " + std::to_string(allCandles.size()) + " rows."));
-        insertCandlesToDB(DB, allCandles);
+        DbLease db = Database::instance().writer();
+        if (!db) {
+            outputWidget->append("Database is not open.");
+            return;
+        }
+        insertCandlesToDB(*db, allCandles);
     }
-    removeDuplicates(DB);
 }
 
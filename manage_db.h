@@ -6,10 +6,13 @@
 #include <vector>
 #include <QTextEdit>
 
-void removeDuplicates(sqlite3* DB);
-void createDatabase(sqlite3* DB);
-void queryStock(sqlite3* DB, std::string ticker);
+#include "database.h"
+
+void removeDuplicates(DbConnection& db);
+void createDatabase(DbConnection& db, const std::string& csvPath, QTextEdit* outputWidget);
+void queryStock(DbConnection& db, std::string ticker);
 void queryStockForBT(sqlite3* DB, std::string ticker);
-void updatePriceHistory(sqlite3* DB, QTextEdit* outputWidget);
+// Fetches every ticker in universe.csv; the writer connection is only held for the final insert.
+void updatePriceHistory(QTextEdit* outputWidget);
 
 #endif // MANAGE_DB_H
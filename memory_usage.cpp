@@ -0,0 +1,220 @@
+#include "memory_usage.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <sstream>
+
+#if defined(_WIN32)
+#define NOMINMAX
+#include <windows.h>
+#include <psapi.h>
+#elif defined(__APPLE__)
+#include <mach/mach.h>
+#include <sys/resource.h>
+#else
+#include <unistd.h>
+#endif
+
+const char* memorySubsystemName(MemorySubsystem subsystem)
+{
+    switch (subsystem) {
+    case MemorySubsystem::BarCache: return "Bar cache";
+    case MemorySubsystem::RunBars: return "Bars held by the run";
+    case MemorySubsystem::Features: return "Indicator series";
+    case MemorySubsystem::TradeLog: return "Trade log";
+    case MemorySubsystem::ChartBuffers: return "Chart buffers";
+    }
+    return "";
+}
+
+// ------------------------
+// Per-subsystem accounting
+// ------------------------
+
+MemoryUsage& MemoryUsage::instance()
+{
+    static MemoryUsage usage;
+    return usage;
+}
+
+void MemoryUsage::add(MemorySubsystem subsystem, std::int64_t bytes)
+{
+    const std::size_t i = static_cast<std::size_t>(subsystem);
+    const std::int64_t now = current_[i].fetch_add(bytes, std::memory_order_relaxed) + bytes;
+    std::int64_t peak = peak_[i].load(std::memory_order_relaxed);
+    while (now > peak && !peak_[i].compare_exchange_weak(peak, now, std::memory_order_relaxed)) {
+    }
+}
+
+std::int64_t MemoryUsage::current(MemorySubsystem subsystem) const
+{
+    return current_[static_cast<std::size_t>(subsystem)].load(std::memory_order_relaxed);
+}
+
+std::int64_t MemoryUsage::peak(MemorySubsystem subsystem) const
+{
+    return peak_[static_cast<std::size_t>(subsystem)].load(std::memory_order_relaxed);
+}
+
+void MemoryUsage::resetPeaks()
+{
+    for (std::size_t i = 0; i < kMemorySubsystemCount; ++i) {
+        peak_[i].store(current_[i].load(std::memory_order_relaxed), std::memory_order_relaxed);
+    }
+}
+
+std::string MemoryUsage::report() const
+{
+    std::ostringstream text;
+    char line[160];
+    for (std::size_t i = 0; i < kMemorySubsystemCount; ++i) {
+        const MemorySubsystem subsystem = static_cast<MemorySubsystem>(i);
+        std::snprintf(line, sizeof(line), "%-22s %12s now, %12s peak\n", memorySubsystemName(subsystem),
+                      formatBytes(static_cast<double>(current(subsystem))).c_str(),
+                      formatBytes(static_cast<double>(peak(subsystem))).c_str());
+        text << line;
+    }
+    return text.str();
+}
+
+MemoryCharge::MemoryCharge(MemorySubsystem subsystem, std::size_t bytes)
+    : subsystem_(subsystem)
+{
+    set(bytes);
+}
+
+MemoryCharge::~MemoryCharge()
+{
+    set(0);
+}
+
+void MemoryCharge::set(std::size_t bytes)
+{
+    if (bytes != bytes_) {
+        MemoryUsage::instance().add(subsystem_, static_cast<std::int64_t>(bytes) - static_cast<std::int64_t>(bytes_));
+        bytes_ = bytes;
+    }
+}
+
+// ------------------------
+// Resident set size
+// ------------------------
+
+namespace {
+
+#if !defined(_WIN32) && !defined(__APPLE__)
+// A "VmHWM:   1234 kB" line of /proc/self/status
+std::size_t statusKilobytes(const char* field)
+{
+    std::ifstream status("/proc/self/status");
+    std::string line;
+    const std::size_t length = std::char_traits<char>::length(field);
+    while (std::getline(status, line)) {
+        if (line.compare(0, length, field) == 0) {
+            return static_cast<std::size_t>(std::strtoull(line.c_str() + length, nullptr, 10)) * 1024;
+        }
+    }
+    return 0;
+}
+#endif
+
+// Restarts the OS's high-water mark of the RSS if it can
+bool resetPeakRss()
+{
+#if !defined(_WIN32) && !defined(__APPLE__)
+    std::ofstream clearRefs("/proc/self/clear_refs");
+    clearRefs << "5";
+    clearRefs.flush();
+    return static_cast<bool>(clearRefs);
+#else
+    return false;
+#endif
+}
+
+} // namespace
+
+std::size_t currentRss()
+{
+#if defined(_WIN32)
+    PROCESS_MEMORY_COUNTERS counters;
+    return GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters)) ? counters.WorkingSetSize : 0;
+#elif defined(__APPLE__)
+    mach_task_basic_info info;
+    mach_msg_type_number_t count = MACH_TASK_BASIC_INFO_COUNT;
+    if (task_info(mach_task_self(), MACH_TASK_BASIC_INFO, reinterpret_cast<task_info_t>(&info), &count) != KERN_SUCCESS) {
+        return 0;
+    }
+    return info.resident_size;
+#else
+    std::ifstream statm("/proc/self/statm");
+    std::size_t pages = 0, resident = 0;
+    if (!(statm >> pages >> resident)) {
+        return 0;
+    }
+    return resident * static_cast<std::size_t>(sysconf(_SC_PAGESIZE));
+#endif
+}
+
+std::size_t peakRss()
+{
+#if defined(_WIN32)
+    PROCESS_MEMORY_COUNTERS counters;
+    return GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters)) ? counters.PeakWorkingSetSize : 0;
+#elif defined(__APPLE__)
+    rusage usage;
+    return getrusage(RUSAGE_SELF, &usage) == 0 ? static_cast<std::size_t>(usage.ru_maxrss) : 0;    // bytes on macOS
+#else
+    return statusKilobytes("VmHWM:");
+#endif
+}
+
+PeakRssMonitor::PeakRssMonitor(int intervalMs)
+    : intervalMs_(std::max(1, intervalMs))
+{
+    markReset_ = resetPeakRss();
+    peak_ = currentRss();
+    if (!markReset_) {
+        thread_ = std::thread([this]() {
+            std::unique_lock<std::mutex> lock(mutex_);
+            while (!wake_.wait_for(lock, std::chrono::milliseconds(intervalMs_), [this]() { return stopping_; })) {
+                peak_ = std::max(peak_, currentRss());
+            }
+        });
+    }
+}
+
+PeakRssMonitor::~PeakRssMonitor()
+{
+    stop();
+}
+
+std::size_t PeakRssMonitor::stop()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stopping_ = true;
+    }
+    wake_.notify_all();
+    if (thread_.joinable()) {
+        thread_.join();
+    }
+    std::lock_guard<std::mutex> lock(mutex_);
+    peak_ = std::max(peak_, markReset_ ? peakRss() : currentRss());
+    return peak_;
+}
+
+std::string formatBytes(double bytes)
+{
+    const char* units[] = {"B", "KB", "MB", "GB", "TB"};
+    std::size_t unit = 0;
+    while (bytes >= 1024.0 && unit + 1 < sizeof(units) / sizeof(units[0])) {
+        bytes /= 1024.0;
+        unit++;
+    }
+    char text[32];
+    std::snprintf(text, sizeof(text), unit == 0 ? "%.0f %s" : "%.1f %s", bytes, units[unit]);
+    return text;
+}
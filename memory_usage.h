@@ -0,0 +1,89 @@
+#ifndef MEMORY_USAGE_H
+#define MEMORY_USAGE_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <thread>
+
+// Bytes held by each part of the app, reported by its owner as it allocates and frees, so a run
+// can show where its memory went. Process-wide resident set size is read from the OS.
+enum class MemorySubsystem { BarCache, RunBars, Features, TradeLog, ChartBuffers };
+constexpr std::size_t kMemorySubsystemCount = 5;
+
+const char* memorySubsystemName(MemorySubsystem subsystem);
+
+class MemoryUsage
+{
+public:
+    static MemoryUsage& instance();
+
+    // Adds bytes (negative to release) to a subsystem
+    void add(MemorySubsystem subsystem, std::int64_t bytes);
+
+    std::int64_t current(MemorySubsystem subsystem) const;
+    // Most held at once since the last resetPeaks()
+    std::int64_t peak(MemorySubsystem subsystem) const;
+    void resetPeaks();
+
+    // One line per subsystem: current and peak
+    std::string report() const;
+
+private:
+    MemoryUsage() = default;
+
+    std::atomic<std::int64_t> current_[kMemorySubsystemCount] = {};
+    std::atomic<std::int64_t> peak_[kMemorySubsystemCount] = {};
+};
+
+// Bytes charged to a subsystem for as long as the charge lives
+class MemoryCharge
+{
+public:
+    explicit MemoryCharge(MemorySubsystem subsystem, std::size_t bytes = 0);
+    ~MemoryCharge();
+
+    MemoryCharge(const MemoryCharge&) = delete;
+    MemoryCharge& operator=(const MemoryCharge&) = delete;
+
+    void set(std::size_t bytes);
+    void add(std::size_t bytes) { set(bytes_ + bytes); }
+    std::size_t bytes() const { return bytes_; }
+
+private:
+    MemorySubsystem subsystem_;
+    std::size_t bytes_ = 0;
+};
+
+// Resident set size of the process now and at its highest, 0 where the OS does not tell
+std::size_t currentRss();
+std::size_t peakRss();
+
+// Highest resident set size while it runs. Where the OS can restart its own high-water mark
+// (Linux) that mark is exact; elsewhere the RSS is sampled every intervalMs.
+class PeakRssMonitor
+{
+public:
+    explicit PeakRssMonitor(int intervalMs = 5);
+    ~PeakRssMonitor();
+
+    // Stops sampling; returns the peak
+    std::size_t stop();
+
+private:
+    std::mutex mutex_;
+    std::condition_variable wake_;
+    bool stopping_ = false;
+    bool markReset_ = false;
+    std::size_t peak_ = 0;
+    int intervalMs_;
+    std::thread thread_;
+};
+
+// 1536 -> "1.5 KB"
+std::string formatBytes(double bytes);
+
+#endif // MEMORY_USAGE_H
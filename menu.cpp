@@ -5,6 +5,8 @@ Menu::Menu(QWidget *parent) : QListWidget(parent)
     addItem("Data Management");
     addItem("Charting");
     addItem("Backtest Engine");
+    addItem("Watchlist");
+    addItem("Screener");
 
     connect(this, &QListWidget::currentRowChanged, this, &Menu::navigateToPage);
 }
@@ -0,0 +1,219 @@
+#include "monte_carlo.h"
+#include "profiler.h"
+
+#include <algorithm>
+#include <atomic>
+#include <limits>
+#include <numeric>
+#include <thread>
+
+namespace {
+
+std::uint64_t splitMix64(std::uint64_t& state)
+{
+    std::uint64_t z = (state += 0x9E3779B97F4A7C15ULL);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    return z ^ (z >> 31);
+}
+
+// xoshiro256**, one stream per iteration so a sample does not depend on which thread drew it
+class Random
+{
+public:
+    Random(std::uint64_t seed, std::uint64_t stream)
+    {
+        std::uint64_t state = seed ^ (stream * 0xD1B54A32D192ED03ULL);
+        for (std::uint64_t& word : s_) {
+            word = splitMix64(state);
+        }
+    }
+
+    std::uint64_t next()
+    {
+        const std::uint64_t result = rotl(s_[1] * 5, 7) * 9;
+        const std::uint64_t t = s_[1] << 17;
+        s_[2] ^= s_[0];
+        s_[3] ^= s_[1];
+        s_[1] ^= s_[2];
+        s_[0] ^= s_[3];
+        s_[2] ^= t;
+        s_[3] = rotl(s_[3], 45);
+        return result;
+    }
+
+    // Uniform in [0, bound) by multiply and shift, redrawing the few values that would bias it
+    std::uint32_t below(std::uint32_t bound)
+    {
+        std::uint64_t product = (next() >> 32) * bound;
+        std::uint32_t low = static_cast<std::uint32_t>(product);
+        if (low < bound) {
+            const std::uint32_t threshold = static_cast<std::uint32_t>(-bound) % bound;
+            while (low < threshold) {
+                product = (next() >> 32) * bound;
+                low = static_cast<std::uint32_t>(product);
+            }
+        }
+        return static_cast<std::uint32_t>(product >> 32);
+    }
+
+private:
+    static std::uint64_t rotl(std::uint64_t x, int k) { return (x << k) | (x >> (64 - k)); }
+
+    std::uint64_t s_[4];
+};
+
+// Running measures of a path, fed one trade at a time
+struct PathMeter {
+    double equity = 0.0;
+    double peak = 0.0;
+    double drawdown = 0.0;
+    int streak = 0;
+    int longest = 0;
+
+    void add(double profit)
+    {
+        equity += profit;
+        peak = std::max(peak, equity);
+        drawdown = std::max(drawdown, peak - equity);
+        // No profit counts as a loss, as in the run's totals
+        streak = profit <= 0.0 ? streak + 1 : 0;
+        longest = std::max(longest, streak);
+    }
+
+    TradePath path() const { return {equity, drawdown, longest}; }
+};
+
+Distribution describe(std::vector<double>& values)
+{
+    Distribution d;
+    if (values.empty()) {
+        return d;
+    }
+    std::sort(values.begin(), values.end());
+    auto at = [&](double q) { return values[static_cast<std::size_t>(q * (values.size() - 1) + 0.5)]; };
+    d.mean = std::accumulate(values.begin(), values.end(), 0.0) / values.size();
+    d.min = values.front();
+    d.p5 = at(0.05);
+    d.p25 = at(0.25);
+    d.median = at(0.5);
+    d.p75 = at(0.75);
+    d.p95 = at(0.95);
+    d.max = values.back();
+    return d;
+}
+
+} // namespace
+
+std::vector<double> tradeProfits(const std::vector<TradeRecord>& trades)
+{
+    std::vector<const TradeRecord*> ordered;
+    ordered.reserve(trades.size());
+    for (const TradeRecord& trade : trades) {
+        ordered.push_back(&trade);
+    }
+    std::stable_sort(ordered.begin(), ordered.end(), [](const TradeRecord* a, const TradeRecord* b) {
+        return a->sellDay < b->sellDay;
+    });
+
+    std::vector<double> profits;
+    profits.reserve(ordered.size());
+    for (const TradeRecord* trade : ordered) {
+        profits.push_back((trade->sellPrice - trade->buyPrice) * trade->quantity);
+    }
+    return profits;
+}
+
+TradePath measurePath(const double* profits, std::size_t count)
+{
+    PathMeter meter;
+    for (std::size_t i = 0; i < count; ++i) {
+        meter.add(profits[i]);
+    }
+    return meter.path();
+}
+
+MonteCarloResult runMonteCarlo(const std::vector<double>& profits, const MonteCarloOptions& options)
+{
+    BTE_PROFILE_SCOPE("runMonteCarlo");
+    MonteCarloResult result;
+    const std::size_t n = std::min<std::size_t>(profits.size(), std::numeric_limits<std::uint32_t>::max());
+    const std::size_t iterations = static_cast<std::size_t>(std::max(0, options.iterations));
+    result.trades = n;
+    result.actual = measurePath(profits.data(), n);
+    if (n == 0 || iterations == 0) {
+        return result;
+    }
+
+    std::vector<TradePath> paths(iterations);
+    // Each trade is kept when a 64-bit draw is at least p * 2^64
+    const double skip = std::clamp(options.skipProbability, 0.0, 1.0);
+    const std::uint64_t skipBelow = skip >= 1.0 ? std::numeric_limits<std::uint64_t>::max()
+                                                : static_cast<std::uint64_t>(skip * 18446744073709551616.0);
+
+    const unsigned int threads = static_cast<unsigned int>(
+        std::min<std::size_t>(std::max(1u, std::thread::hardware_concurrency()), iterations));
+    constexpr std::size_t kChunk = 16;
+    std::atomic<std::size_t> next{0};
+    auto work = [&]() {
+        std::vector<double> deck;
+        const double* source = profits.data();
+        for (std::size_t begin = next.fetch_add(kChunk); begin < iterations; begin = next.fetch_add(kChunk)) {
+            const std::size_t end = std::min(iterations, begin + kChunk);
+            for (std::size_t it = begin; it < end; ++it) {
+                Random random(options.seed, it);
+                PathMeter meter;
+                switch (options.method) {
+                case ResampleMethod::Shuffle:
+                    // Fisher-Yates from the front: position i is final as soon as it is drawn.
+                    // The deck starts from the original order every time, so the sample does not
+                    // depend on the iterations this thread ran before.
+                    deck.assign(source, source + n);
+                    for (std::size_t i = 0; i < n; ++i) {
+                        const std::size_t j = i + random.below(static_cast<std::uint32_t>(n - i));
+                        std::swap(deck[i], deck[j]);
+                        meter.add(deck[i]);
+                    }
+                    break;
+                case ResampleMethod::Bootstrap:
+                    for (std::size_t i = 0; i < n; ++i) {
+                        meter.add(source[random.below(static_cast<std::uint32_t>(n))]);
+                    }
+                    break;
+                case ResampleMethod::SkipTrades:
+                    for (std::size_t i = 0; i < n; ++i) {
+                        if (random.next() >= skipBelow) {
+                            meter.add(source[i]);
+                        }
+                    }
+                    break;
+                }
+                paths[it] = meter.path();
+            }
+        }
+    };
+
+    std::vector<std::thread> workers;
+    for (unsigned int t = 1; t < threads; ++t) {
+        workers.emplace_back(work);
+    }
+    work();
+    for (std::thread& worker : workers) {
+        worker.join();
+    }
+
+    std::vector<double> finals(iterations), drawdowns(iterations), streaks(iterations);
+    std::size_t losses = 0;
+    for (std::size_t it = 0; it < iterations; ++it) {
+        finals[it] = paths[it].finalProfit;
+        drawdowns[it] = paths[it].maxDrawdown;
+        streaks[it] = paths[it].losingStreak;
+        losses += paths[it].finalProfit < 0.0;
+    }
+    result.iterations = iterations;
+    result.finalProfit = describe(finals);
+    result.maxDrawdown = describe(drawdowns);
+    result.losingStreak = describe(streaks);
+    result.lossProbability = static_cast<double>(losses) / iterations;
+    return result;
+}
@@ -0,0 +1,63 @@
+#ifndef MONTE_CARLO_H
+#define MONTE_CARLO_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "backtest.h"
+
+// Robustness of a run's result: the trade list is resampled many times and the spread of the
+// outcomes reported, instead of the single path the trades happened to take.
+enum class ResampleMethod {
+    Shuffle,      // the same trades in a random order; final profit is fixed, the path is not
+    Bootstrap,    // as many trades drawn with replacement
+    SkipTrades    // the original order with each trade missed with skipProbability
+};
+
+struct MonteCarloOptions {
+    ResampleMethod method = ResampleMethod::Shuffle;
+    int iterations = 1000;
+    double skipProbability = 0.1;
+    std::uint64_t seed = 1;        // iteration i always draws the same sample, however many threads run
+};
+
+// Measures of one sequence of trade profits, the equity starting at 0
+struct TradePath {
+    double finalProfit = 0.0;
+    double maxDrawdown = 0.0;      // largest fall from a running peak, in dollars
+    int losingStreak = 0;          // most losing trades in a row
+};
+
+struct Distribution {
+    double mean = 0.0;
+    double min = 0.0;
+    double p5 = 0.0;
+    double p25 = 0.0;
+    double median = 0.0;
+    double p75 = 0.0;
+    double p95 = 0.0;
+    double max = 0.0;
+};
+
+struct MonteCarloResult {
+    std::size_t iterations = 0;
+    std::size_t trades = 0;
+    TradePath actual;              // the trades in the order they closed
+    Distribution finalProfit;
+    Distribution maxDrawdown;
+    Distribution losingStreak;
+    double lossProbability = 0.0;  // share of iterations ending below 0
+};
+
+// Profit of every trade in the order the trades closed: the compact array the resampling runs on.
+std::vector<double> tradeProfits(const std::vector<TradeRecord>& trades);
+
+TradePath measurePath(const double* profits, std::size_t count);
+
+// Each iteration samples and measures in one pass over the array, without materialising the
+// sample. Iterations are spread over worker threads, each thread with its own copy of the array
+// for shuffling.
+MonteCarloResult runMonteCarlo(const std::vector<double>& profits, const MonteCarloOptions& options);
+
+#endif // MONTE_CARLO_H
@@ -0,0 +1,176 @@
+#include "profiler.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <map>
+#include <sstream>
+
+Profiler& Profiler::instance()
+{
+    static Profiler profiler;
+    return profiler;
+}
+
+Profiler::Profiler()
+{
+    if (std::getenv("BTE_PROFILE")) {
+        setEnabled(true);
+    }
+}
+
+std::int64_t Profiler::now()
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+Profiler::ThreadBuffer& Profiler::buffer()
+{
+    thread_local std::shared_ptr<ThreadBuffer> local;
+    if (!local) {
+        local = std::make_shared<ThreadBuffer>();
+        std::lock_guard<std::mutex> lock(mutex_);
+        local->thread = static_cast<int>(buffers_.size()) + 1;
+        buffers_.push_back(local);
+    }
+    return *local;
+}
+
+void Profiler::record(const char* name, std::int64_t start, std::int64_t end)
+{
+    ThreadBuffer& local = buffer();
+    std::lock_guard<std::mutex> lock(local.mutex);
+    local.events.push_back({name, start, end - start, 0.0});
+}
+
+void Profiler::count(const char* name, double value)
+{
+    ThreadBuffer& local = buffer();
+    std::lock_guard<std::mutex> lock(local.mutex);
+    local.events.push_back({name, now(), -1, value});
+}
+
+std::vector<Profiler::Phase> Profiler::summary(std::int64_t since) const
+{
+    // Keyed by name text, since the same literal may have several addresses
+    std::map<std::string, Phase> phases;
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (const std::shared_ptr<ThreadBuffer>& buffer : buffers_) {
+        std::lock_guard<std::mutex> bufferLock(buffer->mutex);
+        for (const Event& event : buffer->events) {
+            if (event.start < since) {
+                continue;
+            }
+            Phase& phase = phases[event.name];
+            phase.name = event.name;
+            phase.calls++;
+            if (event.duration < 0) {
+                phase.counter = true;
+                phase.total += event.value;
+            } else {
+                const double ms = event.duration / 1e6;
+                phase.totalMs += ms;
+                phase.maxMs = std::max(phase.maxMs, ms);
+            }
+        }
+    }
+
+    std::vector<Phase> result;
+    for (auto& entry : phases) {
+        result.push_back(std::move(entry.second));
+    }
+    std::sort(result.begin(), result.end(), [](const Phase& a, const Phase& b) {
+        if (a.counter != b.counter) return !a.counter;
+        return a.counter ? a.name < b.name : a.totalMs > b.totalMs;
+    });
+    return result;
+}
+
+std::string Profiler::summaryText(std::int64_t since) const
+{
+    std::ostringstream text;
+    char line[256];
+    for (const Phase& phase : summary(since)) {
+        if (phase.counter) {
+            std::snprintf(line, sizeof(line), "%-36s %14.0f\n", phase.name.c_str(), phase.total);
+        } else {
+            std::snprintf(line, sizeof(line), "%-36s %8zu calls %10.2f ms total %9.2f ms max\n",
+                          phase.name.c_str(), phase.calls, phase.totalMs, phase.maxMs);
+        }
+        text << line;
+    }
+    return text.str();
+}
+
+namespace {
+
+std::string jsonString(const char* text)
+{
+    std::string out = "\"";
+    for (const char* c = text; *c; ++c) {
+        if (*c == '"' || *c == '\\') {
+            out += '\\';
+            out += *c;
+        } else if (static_cast<unsigned char>(*c) < 0x20) {
+            out += ' ';
+        } else {
+            out += *c;
+        }
+    }
+    return out + "\"";
+}
+
+} // namespace
+
+bool Profiler::writeChromeTrace(const std::string& path)
+{
+    std::ofstream file(path, std::ios::out | std::ios::trunc);
+    if (!file) {
+        return false;
+    }
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    std::int64_t origin = INT64_MAX;
+    for (const std::shared_ptr<ThreadBuffer>& buffer : buffers_) {
+        std::lock_guard<std::mutex> bufferLock(buffer->mutex);
+        for (const Event& event : buffer->events) {
+            origin = std::min(origin, event.start);
+        }
+    }
+
+    // Timestamps are microseconds from the first event
+    file << "{\"traceEvents\":[\n";
+    bool first = true;
+    char numbers[128];
+    for (const std::shared_ptr<ThreadBuffer>& buffer : buffers_) {
+        std::lock_guard<std::mutex> bufferLock(buffer->mutex);
+        for (const Event& event : buffer->events) {
+            file << (first ? "" : ",\n") << "{\"name\":" << jsonString(event.name);
+            first = false;
+            const double ts = (event.start - origin) / 1e3;
+            if (event.duration < 0) {
+                std::snprintf(numbers, sizeof(numbers), ",\"ph\":\"C\",\"ts\":%.3f,\"pid\":1,\"tid\":%d,\"args\":{\"value\":%.17g}}",
+                              ts, buffer->thread, event.value);
+            } else {
+                std::snprintf(numbers, sizeof(numbers), ",\"ph\":\"X\",\"ts\":%.3f,\"dur\":%.3f,\"pid\":1,\"tid\":%d}",
+                              ts, event.duration / 1e3, buffer->thread);
+            }
+            file << numbers;
+        }
+        buffer->events.clear();
+    }
+    file << "\n],\"displayTimeUnit\":\"ms\"}\n";
+    return static_cast<bool>(file);
+}
+
+void Profiler::clear()
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (const std::shared_ptr<ThreadBuffer>& buffer : buffers_) {
+        std::lock_guard<std::mutex> bufferLock(buffer->mutex);
+        buffer->events.clear();
+    }
+}
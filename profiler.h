@@ -0,0 +1,109 @@
+#ifndef PROFILER_H
+#define PROFILER_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// Scoped timers and counters for finding where a run spends its time:
+//
+//   void loadSomething() {
+//       BTE_PROFILE_SCOPE("loadSomething");
+//       ...
+//       BTE_PROFILE_COUNT("bars loaded", count);
+//   }
+//
+// Each thread records into a buffer of its own, so threads never wait on each other. While
+// profiling is off (the default, or BTE_PROFILE set in the environment to start with it on) a
+// scope costs one relaxed atomic load; building with BTE_NO_PROFILER defined removes them.
+// Names must be string literals: only the pointer is kept.
+class Profiler
+{
+public:
+    static Profiler& instance();
+
+    static bool enabled() { return enabled_.load(std::memory_order_relaxed); }
+    static void setEnabled(bool on) { enabled_.store(on, std::memory_order_relaxed); }
+
+    // Nanoseconds on a steady clock
+    static std::int64_t now();
+
+    void record(const char* name, std::int64_t start, std::int64_t end);
+    void count(const char* name, double value);
+
+    // Totals of the scopes and counters recorded since a time from now(), scopes longest first
+    struct Phase {
+        std::string name;
+        bool counter = false;
+        std::size_t calls = 0;
+        double totalMs = 0.0;     // scopes
+        double maxMs = 0.0;
+        double total = 0.0;       // counters
+    };
+    std::vector<Phase> summary(std::int64_t since = 0) const;
+    std::string summaryText(std::int64_t since = 0) const;
+
+    // Writes every recorded event in the Chrome trace format (chrome://tracing, Perfetto) and
+    // drops them. Returns false if the file could not be written.
+    bool writeChromeTrace(const std::string& path);
+
+    void clear();
+
+private:
+    Profiler();
+
+    struct Event {
+        const char* name;
+        std::int64_t start;
+        std::int64_t duration;    // -1 for counters
+        double value;
+    };
+    struct ThreadBuffer {
+        std::mutex mutex;         // only contended while the events are read
+        std::vector<Event> events;
+        int thread = 0;
+    };
+
+    ThreadBuffer& buffer();
+
+    inline static std::atomic<bool> enabled_{false};
+    mutable std::mutex mutex_;
+    std::vector<std::shared_ptr<ThreadBuffer>> buffers_;    // outlive their threads
+};
+
+class ProfileScope
+{
+public:
+    explicit ProfileScope(const char* name)
+        : name_(Profiler::enabled() ? name : nullptr), start_(name_ ? Profiler::now() : 0) {}
+    ~ProfileScope()
+    {
+        if (name_) {
+            Profiler::instance().record(name_, start_, Profiler::now());
+        }
+    }
+
+    ProfileScope(const ProfileScope&) = delete;
+    ProfileScope& operator=(const ProfileScope&) = delete;
+
+private:
+    const char* name_;
+    std::int64_t start_;
+};
+
+#ifdef BTE_NO_PROFILER
+#define BTE_PROFILE_SCOPE(name) do {} while (0)
+#define BTE_PROFILE_COUNT(name, value) do {} while (0)
+#else
+#define BTE_PROFILE_CONCAT_(a, b) a##b
+#define BTE_PROFILE_CONCAT(a, b) BTE_PROFILE_CONCAT_(a, b)
+#define BTE_PROFILE_SCOPE(name) ProfileScope BTE_PROFILE_CONCAT(profileScope_, __LINE__)(name)
+#define BTE_PROFILE_COUNT(name, value) \
+    do { if (Profiler::enabled()) Profiler::instance().count((name), static_cast<double>(value)); } while (0)
+#endif
+
+#endif // PROFILER_H
@@ -0,0 +1,171 @@
+#include "run_cache.h"
+#include "day_number.h"
+#include "profiler.h"
+
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+
+namespace {
+
+// A trade is stored as buy day, sell day (int32), buy price, sell price, quantity (double) and
+// its info as a length byte and the characters; the ticker is the row's.
+template <typename T>
+void put(std::string& out, T value)
+{
+    char bytes[sizeof(T)];
+    std::memcpy(bytes, &value, sizeof(T));
+    out.append(bytes, sizeof(T));
+}
+
+template <typename T>
+bool take(const unsigned char*& in, const unsigned char* end, T& value)
+{
+    if (static_cast<std::size_t>(end - in) < sizeof(T)) {
+        return false;
+    }
+    std::memcpy(&value, in, sizeof(T));
+    in += sizeof(T);
+    return true;
+}
+
+std::string encodeTrades(const std::vector<TradeRecord>& trades)
+{
+    std::string out;
+    out.reserve(trades.size() * 40);
+    for (const TradeRecord& trade : trades) {
+        put<std::int32_t>(out, trade.buyDay);
+        put<std::int32_t>(out, trade.sellDay);
+        put(out, trade.buyPrice);
+        put(out, trade.sellPrice);
+        put(out, trade.quantity);
+        const std::size_t length = std::min<std::size_t>(trade.info.size(), 255);
+        put<std::uint8_t>(out, static_cast<std::uint8_t>(length));
+        out.append(trade.info, 0, length);
+    }
+    return out;
+}
+
+bool decodeTrades(const std::string& ticker, const unsigned char* in, std::size_t bytes, std::vector<TradeRecord>& trades)
+{
+    const unsigned char* end = in + bytes;
+    trades.clear();
+    while (in < end) {
+        TradeRecord trade;
+        std::int32_t buyDay, sellDay;
+        std::uint8_t length;
+        if (!take(in, end, buyDay) || !take(in, end, sellDay) || !take(in, end, trade.buyPrice)
+            || !take(in, end, trade.sellPrice) || !take(in, end, trade.quantity) || !take(in, end, length)
+            || static_cast<std::size_t>(end - in) < length) {
+            return false;
+        }
+        trade.info.assign(reinterpret_cast<const char*>(in), length);
+        in += length;
+        trade.ticker = ticker;
+        trade.buyDay = buyDay;
+        trade.sellDay = sellDay;
+        trade.buyDate = dayToString(buyDay);
+        trade.sellDate = dayToString(sellDay);
+        trades.push_back(std::move(trade));
+    }
+    return true;
+}
+
+} // namespace
+
+std::uint64_t strategyFingerprint(const std::string& description)
+{
+    // 64-bit FNV-1a
+    std::uint64_t hash = 0xcbf29ce484222325ULL;
+    const std::string text = std::to_string(kStrategyCodeRevision) + '\0' + description;
+    for (unsigned char c : text) {
+        hash = (hash ^ c) * 0x100000001b3ULL;
+    }
+    return hash;
+}
+
+bool RunCache::lookup(DbConnection& db, const std::string& ticker, const std::vector<std::uint64_t>& strategies,
+                      std::vector<std::vector<TradeRecord>>& trades, std::vector<char>& found)
+{
+    BTE_PROFILE_SCOPE("RunCache::lookup");
+    trades.assign(strategies.size(), std::vector<TradeRecord>());
+    found.assign(strategies.size(), 0);
+
+    const char* querySQL =
+        "SELECT r.trades FROM Tickers t JOIN RunResults r "
+        "ON r.ticker_id = t.id AND r.strategy = ? AND r.bars = ? "
+        "AND r.version = t.version AND r.last_day = t.last_day "
+        "WHERE t.symbol = ?;";
+    CachedStatement query = db.prepare("runcache.get", querySQL);
+    if (!query) {
+        return false;
+    }
+    sqlite3_stmt* stmt = query.get();
+
+    bool all = true;
+    for (std::size_t k = 0; k < strategies.size(); ++k) {
+        sqlite3_bind_int64(stmt, 1, static_cast<sqlite3_int64>(strategies[k]));
+        sqlite3_bind_int(stmt, 2, bars_);
+        sqlite3_bind_text(stmt, 3, ticker.c_str(), -1, SQLITE_TRANSIENT);
+        if (sqlite3_step(stmt) == SQLITE_ROW) {
+            const auto* blob = static_cast<const unsigned char*>(sqlite3_column_blob(stmt, 0));
+            const int bytes = sqlite3_column_bytes(stmt, 0);
+            found[k] = decodeTrades(ticker, blob, static_cast<std::size_t>(bytes), trades[k]);
+        }
+        sqlite3_reset(stmt);
+        all = all && found[k];
+    }
+    return all;
+}
+
+void RunCache::add(const BarView& bars, std::uint64_t strategy, const std::vector<TradeRecord>& trades)
+{
+    const std::shared_ptr<const BarSeries>& series = bars.series();
+    if (!series || series->version < 0 || series->size() == 0) {
+        return;
+    }
+    pending_.push_back({series->ticker, strategy, series->version, series->day.back(), encodeTrades(trades)});
+}
+
+std::size_t RunCache::flush()
+{
+    BTE_PROFILE_SCOPE("RunCache::flush");
+    std::vector<PendingRow> rows;
+    rows.swap(pending_);
+    if (rows.empty()) {
+        return 0;
+    }
+
+    DbLease db = Database::instance().writer();
+    if (!db) {
+        return 0;
+    }
+    const char* storeSQL =
+        "INSERT OR REPLACE INTO RunResults (ticker_id, strategy, bars, version, last_day, trades) "
+        "SELECT id, ?, ?, ?, ?, ? FROM Tickers WHERE symbol = ?;";
+    CachedStatement store = db->prepare("runcache.put", storeSQL);
+    if (!store) {
+        return 0;
+    }
+    sqlite3* DB = db.handle();
+    sqlite3_stmt* stmt = store.get();
+
+    std::size_t written = 0;
+    sqlite3_exec(DB, "BEGIN TRANSACTION;", nullptr, nullptr, nullptr);
+    for (const PendingRow& row : rows) {
+        sqlite3_bind_int64(stmt, 1, static_cast<sqlite3_int64>(row.strategy));
+        sqlite3_bind_int(stmt, 2, bars_);
+        sqlite3_bind_int64(stmt, 3, row.version);
+        sqlite3_bind_int(stmt, 4, row.lastDay);
+        sqlite3_bind_blob(stmt, 5, row.trades.data(), static_cast<int>(row.trades.size()), SQLITE_STATIC);
+        sqlite3_bind_text(stmt, 6, row.ticker.c_str(), -1, SQLITE_STATIC);
+        if (sqlite3_step(stmt) != SQLITE_DONE) {
+            std::cerr << "Error storing run result for " << row.ticker << ": " << sqlite3_errmsg(DB) << std::endl;
+        } else {
+            written += sqlite3_changes(DB) > 0;
+        }
+        sqlite3_reset(stmt);
+    }
+    sqlite3_exec(DB, "COMMIT;", nullptr, nullptr, nullptr);
+    return written;
+}
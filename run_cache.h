@@ -0,0 +1,57 @@
+#ifndef RUN_CACHE_H
+#define RUN_CACHE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "backtest.h"
+#include "bar_repository.h"
+#include "database.h"
+
+// Finished per-ticker backtest results, kept in the RunResults table so a repeated or partly
+// changed run only computes the tickers whose inputs changed. A result is keyed by ticker,
+// strategy fingerprint and the number of bars traded, and reused while the ticker's
+// Tickers.version and last_day are still the ones it was computed from (see db_schema.h): new
+// days or rewritten bars make it stale. The universe needs no key of its own, since a run is
+// assembled from its tickers' results.
+
+// Revision of the trading code. Bump it with any change that alters the trades of unchanged
+// inputs, so results stored by an older build are not reused.
+constexpr int kStrategyCodeRevision = 2;
+
+// Fingerprint of a strategy and its parameters, e.g. of "breakout " + describeStrategy(params)
+std::uint64_t strategyFingerprint(const std::string& description);
+
+class RunCache
+{
+public:
+    explicit RunCache(int bars) : bars_(bars) {}
+
+    // Reads ticker's stored results for each strategy into trades; found[k] tells whether
+    // trades[k] was stored and is still current. Returns true if all of them were.
+    bool lookup(DbConnection& db, const std::string& ticker, const std::vector<std::uint64_t>& strategies,
+                std::vector<std::vector<TradeRecord>>& trades, std::vector<char>& found);
+
+    // Queues trades computed over bars for flush(). Only views of a full history read by
+    // BarRepository::loadSeries carry a version; others are not stored.
+    void add(const BarView& bars, std::uint64_t strategy, const std::vector<TradeRecord>& trades);
+
+    // Writes the queued results in one transaction on the writer. Returns the number written.
+    std::size_t flush();
+
+private:
+    struct PendingRow {
+        std::string ticker;
+        std::uint64_t strategy;
+        std::int64_t version;
+        int lastDay;
+        std::string trades;    // encoded, see run_cache.cpp
+    };
+
+    int bars_;
+    std::vector<PendingRow> pending_;
+};
+
+#endif // RUN_CACHE_H
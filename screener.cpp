@@ -0,0 +1,546 @@
+#include "screener.h"
+#include "bar_repository.h"
+#include "database.h"
+#include "indicator_kernels.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <cmath>
+#include <climits>
+#include <cstdlib>
+#include <limits>
+#include <thread>
+
+namespace {
+
+constexpr double kNaN = std::numeric_limits<double>::quiet_NaN();
+
+// Connections leased at once while loading; matches the default reader pool of Database::open
+constexpr unsigned int kLoadThreads = 4;
+
+// Below this many tickers per thread, splitting the term columns across threads costs more than it saves
+constexpr std::size_t kMinTickersPerThread = 512;
+
+unsigned int workerCount(std::size_t items, std::size_t minPerWorker, unsigned int cap)
+{
+    unsigned int count = std::max(1u, std::thread::hardware_concurrency());
+    count = std::min(count, cap);
+    return static_cast<unsigned int>(std::max<std::size_t>(1, std::min<std::size_t>(count, items / minPerWorker)));
+}
+
+// Runs work(first, last) over [0, count) split into one contiguous range per thread
+template <typename Work>
+void parallelRanges(std::size_t count, unsigned int threads, Work work)
+{
+    if (threads <= 1) {
+        work(std::size_t(0), count);
+        return;
+    }
+    std::vector<std::thread> workers;
+    workers.reserve(threads);
+    const std::size_t chunk = (count + threads - 1) / threads;
+    for (unsigned int t = 0; t < threads; ++t) {
+        const std::size_t first = std::min(count, t * chunk);
+        const std::size_t last = std::min(count, first + chunk);
+        workers.emplace_back([&work, first, last]() { work(first, last); });
+    }
+    for (std::thread& worker : workers) {
+        worker.join();
+    }
+}
+
+} // namespace
+
+// ------------------------
+// ScreenPanel
+// ------------------------
+
+std::size_t ScreenPanel::bytes() const
+{
+    std::size_t total = sizeof(ScreenPanel) + lastDay.capacity() * sizeof(int);
+    for (const std::string& ticker : tickers) {
+        total += sizeof(std::string) + ticker.capacity();
+    }
+    total += (open.capacity() + high.capacity() + low.capacity() + close.capacity() + volume.capacity()) * sizeof(double);
+    return total;
+}
+
+bool loadScreenPanel(const std::vector<std::string>& symbols, std::size_t depth, ScreenPanel& panel)
+{
+    Database& database = Database::instance();
+    if (!database.isOpen()) {
+        return false;
+    }
+    // Taken first, so a write that lands during the load still marks the panel stale
+    const std::uint64_t generation = BarRepository::instance().generation();
+
+    std::vector<std::string> universe = symbols;
+    if (universe.empty()) {
+        DbLease db = database.reader();
+        if (!db) {
+            return false;
+        }
+        CachedStatement query = db->prepare("tickers.all", "SELECT symbol FROM Tickers ORDER BY symbol;");
+        if (!query) {
+            return false;
+        }
+        while (sqlite3_step(query.get()) == SQLITE_ROW) {
+            universe.emplace_back(reinterpret_cast<const char*>(sqlite3_column_text(query.get(), 0)));
+        }
+    }
+
+    depth = std::max<std::size_t>(1, depth);
+    const std::size_t count = universe.size();
+    panel = ScreenPanel();
+    panel.depth = depth;
+    panel.generation = generation;
+    panel.tickers = universe;
+    panel.lastDay.assign(count, 0);
+    panel.open.assign(count * depth, kNaN);
+    panel.high.assign(count * depth, kNaN);
+    panel.low.assign(count * depth, kNaN);
+    panel.close.assign(count * depth, kNaN);
+    panel.volume.assign(count * depth, kNaN);
+    std::vector<unsigned char> found(count, 0);
+
+    // Workers claim symbols one at a time and fill only their own slots, so nothing is locked
+    std::atomic<std::size_t> next{0};
+    auto load = [&]() {
+        DbLease db;
+        BarRepository& repository = BarRepository::instance();
+        for (std::size_t i = next++; i < count; i = next++) {
+            const std::size_t base = i * depth;
+            BarView cached = repository.peek(universe[i]);
+            if (!cached.empty()) {
+                BarView view = cached.last(depth);
+                const std::size_t offset = base + depth - view.size();
+                std::copy(view.open(), view.open() + view.size(), panel.open.begin() + offset);
+                std::copy(view.high(), view.high() + view.size(), panel.high.begin() + offset);
+                std::copy(view.low(), view.low() + view.size(), panel.low.begin() + offset);
+                std::copy(view.close(), view.close() + view.size(), panel.close.begin() + offset);
+                std::copy(view.volume(), view.volume() + view.size(), panel.volume.begin() + offset);
+                panel.lastDay[i] = view.day()[view.size() - 1];
+                found[i] = 1;
+                continue;
+            }
+
+            if (!db) {
+                db = Database::instance().reader();
+                if (!db) {
+                    return;
+                }
+            }
+            const char* latestSQL =
+                "SELECT day, open, high, low, close, volume FROM Bars "
+                "WHERE ticker_id = (SELECT id FROM Tickers WHERE symbol = ?) "
+                "ORDER BY day DESC LIMIT ?;";
+            CachedStatement query = db->prepare("bars.latest", latestSQL);
+            if (!query) {
+                return;
+            }
+            sqlite3_stmt* stmt = query.get();
+            sqlite3_bind_text(stmt, 1, universe[i].c_str(), -1, SQLITE_TRANSIENT);
+            sqlite3_bind_int64(stmt, 2, static_cast<sqlite3_int64>(depth));
+
+            // Newest first, so fill the ticker's slots from the right
+            std::size_t slot = base + depth;
+            while (slot > base && sqlite3_step(stmt) == SQLITE_ROW) {
+                --slot;
+                if (slot == base + depth - 1) {
+                    panel.lastDay[i] = sqlite3_column_int(stmt, 0);
+                }
+                panel.open[slot] = sqlite3_column_double(stmt, 1);
+                panel.high[slot] = sqlite3_column_double(stmt, 2);
+                panel.low[slot] = sqlite3_column_double(stmt, 3);
+                panel.close[slot] = sqlite3_column_double(stmt, 4);
+                panel.volume[slot] = sqlite3_column_double(stmt, 5);
+            }
+            found[i] = slot < base + depth;
+        }
+    };
+
+    const unsigned int threads = workerCount(count, 1, kLoadThreads);
+    std::vector<std::thread> workers;
+    for (unsigned int t = 1; t < threads; ++t) {
+        workers.emplace_back(load);
+    }
+    load();
+    for (std::thread& worker : workers) {
+        worker.join();
+    }
+
+    // Drop symbols without bars by moving later tickers down over them
+    std::size_t kept = 0;
+    for (std::size_t i = 0; i < count; ++i) {
+        if (!found[i]) {
+            continue;
+        }
+        if (kept != i) {
+            const std::size_t from = i * depth;
+            const std::size_t to = kept * depth;
+            for (std::vector<double>* column : {&panel.open, &panel.high, &panel.low, &panel.close, &panel.volume}) {
+                std::copy(column->begin() + from, column->begin() + from + depth, column->begin() + to);
+            }
+            panel.tickers[kept] = std::move(panel.tickers[i]);
+            panel.lastDay[kept] = panel.lastDay[i];
+        }
+        ++kept;
+    }
+    panel.tickers.resize(kept);
+    panel.lastDay.resize(kept);
+    for (std::vector<double>* column : {&panel.open, &panel.high, &panel.low, &panel.close, &panel.volume}) {
+        column->resize(kept * depth);
+        column->shrink_to_fit();
+    }
+    return true;
+}
+
+// ------------------------
+// Parsing
+// ------------------------
+
+namespace {
+
+class ScreenParser
+{
+public:
+    explicit ScreenParser(const std::string& text) : text_(text) {}
+
+    bool atEnd() { skipSpace(); return pos_ >= text_.size(); }
+
+    bool parseTerm(ScreenTerm& term)
+    {
+        ScreenTerm first;
+        if (!parseFactor(first)) return false;
+        skipSpace();
+        if (pos_ < text_.size() && text_[pos_] == '*') {
+            ++pos_;
+            ScreenTerm second;
+            if (!parseFactor(second)) return false;
+            if (first.field != ScreenField::Constant && second.field != ScreenField::Constant) {
+                return fail("only one side of '*' may be a field");
+            }
+            if (first.field == ScreenField::Constant) {
+                std::swap(first, second);
+            }
+            first.scale *= second.scale;
+        }
+        term = first;
+        return true;
+    }
+
+    bool parseFilter(ScreenFilter& filter)
+    {
+        if (!parseTerm(filter.lhs)) return false;
+        skipSpace();
+        if (text_.compare(pos_, 2, ">=") == 0) { filter.op = ScreenCompare::GreaterEqual; pos_ += 2; }
+        else if (text_.compare(pos_, 2, "<=") == 0) { filter.op = ScreenCompare::LessEqual; pos_ += 2; }
+        else if (text_.compare(pos_, 1, ">") == 0) { filter.op = ScreenCompare::Greater; pos_ += 1; }
+        else if (text_.compare(pos_, 1, "<") == 0) { filter.op = ScreenCompare::Less; pos_ += 1; }
+        else return fail("expected a comparison");
+        return parseTerm(filter.rhs);
+    }
+
+    bool parseAnd()
+    {
+        skipSpace();
+        std::string word = peekWord();
+        if (word != "and") return fail("expected 'and'");
+        pos_ += 3;
+        return true;
+    }
+
+    const std::string& error() const { return error_; }
+
+private:
+    void skipSpace()
+    {
+        while (pos_ < text_.size() && std::isspace(static_cast<unsigned char>(text_[pos_]))) ++pos_;
+    }
+
+    std::string peekWord() const
+    {
+        std::size_t end = pos_;
+        while (end < text_.size() && (std::isalpha(static_cast<unsigned char>(text_[end])) || text_[end] == '%')) ++end;
+        std::string word = text_.substr(pos_, end - pos_);
+        std::transform(word.begin(), word.end(), word.begin(), [](unsigned char c) { return std::tolower(c); });
+        return word;
+    }
+
+    bool parseFactor(ScreenTerm& term)
+    {
+        skipSpace();
+        if (pos_ >= text_.size()) return fail("unexpected end of expression");
+
+        const char* start = text_.c_str() + pos_;
+        char* end = nullptr;
+        const double number = std::strtod(start, &end);
+        if (end != start) {
+            pos_ += static_cast<std::size_t>(end - start);
+            term = ScreenTerm{ScreenField::Constant, 0, number};
+            return true;
+        }
+
+        std::string word = peekWord();
+        struct Name { const char* name; ScreenField field; bool hasPeriod; };
+        static const Name names[] = {
+            {"open", ScreenField::Open, false},        {"high", ScreenField::High, false},
+            {"low", ScreenField::Low, false},          {"close", ScreenField::Close, false},
+            {"volume", ScreenField::Volume, false},    {"sma", ScreenField::SMA, true},
+            {"ema", ScreenField::EMA, true},           {"adr", ScreenField::ADR, true},
+            {"adr%", ScreenField::ADRPercent, true},   {"avgvol", ScreenField::AvgVolume, true},
+            {"change", ScreenField::Change, true},     {"hh", ScreenField::HighestHigh, true},
+            {"ll", ScreenField::LowestLow, true},      {"atr", ScreenField::ATR, true},
+        };
+        const Name* match = nullptr;
+        for (const Name& name : names) {
+            if (word == name.name) match = &name;
+        }
+        if (!match) return fail("unknown field '" + word + "'");
+        pos_ += word.size();
+        term = ScreenTerm{match->field, 0, 1.0};
+        if (!match->hasPeriod) return true;
+
+        skipSpace();
+        if (pos_ >= text_.size() || text_[pos_] != '(') return fail(word + " needs a period, e.g. " + word + "(14)");
+        ++pos_;
+        skipSpace();
+        const long period = std::strtol(text_.c_str() + pos_, &end, 10);
+        if (end == text_.c_str() + pos_ || period <= 0) return fail("expected a positive period");
+        pos_ = static_cast<std::size_t>(end - text_.c_str());
+        skipSpace();
+        if (pos_ >= text_.size() || text_[pos_] != ')') return fail("expected ')'");
+        ++pos_;
+        term.period = static_cast<int>(period);
+        return true;
+    }
+
+    bool fail(const std::string& message)
+    {
+        error_ = message + " at position " + std::to_string(pos_ + 1);
+        return false;
+    }
+
+    const std::string& text_;
+    std::size_t pos_ = 0;
+    std::string error_;
+};
+
+} // namespace
+
+bool parseScreenFilters(const std::string& text, std::vector<ScreenFilter>& filters, std::string& error)
+{
+    filters.clear();
+    ScreenParser parser(text);
+    while (!parser.atEnd()) {
+        if (!filters.empty() && !parser.parseAnd()) {
+            error = parser.error();
+            return false;
+        }
+        ScreenFilter filter;
+        if (!parser.parseFilter(filter)) {
+            error = parser.error();
+            return false;
+        }
+        filters.push_back(filter);
+    }
+    return true;
+}
+
+bool parseScreenTerm(const std::string& text, ScreenTerm& term, std::string& error)
+{
+    ScreenParser parser(text);
+    if (!parser.parseTerm(term)) {
+        error = parser.error();
+        return false;
+    }
+    if (!parser.atEnd()) {
+        error = "unexpected text after the rank term";
+        return false;
+    }
+    return true;
+}
+
+// ------------------------
+// Evaluation
+// ------------------------
+
+namespace {
+
+// History a term needs before its value at the latest bar is defined
+std::size_t termDepth(const ScreenTerm& term)
+{
+    switch (term.field) {
+    case ScreenField::Constant:
+        return 0;
+    case ScreenField::Change:
+        return static_cast<std::size_t>(term.period) + 1;
+    case ScreenField::EMA:
+    case ScreenField::ATR:
+        // Long enough for the seed average to have faded
+        return static_cast<std::size_t>(term.period) * 3;
+    default:
+        return static_cast<std::size_t>(std::max(1, term.period));
+    }
+}
+
+// Value of term at the last of depth bars starting at offset; NaN if the history is too short.
+// Rolling indicators run the shared kernels over the ticker's bars in the window, into scratch.
+double termValue(const ScreenPanel& panel, std::size_t offset, const ScreenTerm& term, std::vector<double>& scratch)
+{
+    const std::size_t depth = panel.depth;
+    const std::size_t last = offset + depth - 1;
+    const int period = term.period;
+
+    const double* open = panel.open.data();
+    const double* high = panel.high.data();
+    const double* low = panel.low.data();
+    const double* close = panel.close.data();
+    const double* volume = panel.volume.data();
+    switch (term.field) {
+    case ScreenField::Constant:   return 1.0;
+    case ScreenField::Open:       return open[last];
+    case ScreenField::High:       return high[last];
+    case ScreenField::Low:        return low[last];
+    case ScreenField::Close:      return close[last];
+    case ScreenField::Volume:     return volume[last];
+    default:                      break;
+    }
+
+    // Slots before the ticker's first bar are NaN
+    std::size_t first = offset;
+    while (first <= last && std::isnan(close[first])) ++first;
+    const std::size_t count = last + 1 - first;
+    if (period <= 0 || count < static_cast<std::size_t>(period)) {
+        return kNaN;
+    }
+    scratch.resize(count);
+    double* out = scratch.data();
+
+    switch (term.field) {
+    case ScreenField::SMA:
+        smaSeries(close + first, count, period, out);
+        break;
+    case ScreenField::EMA:
+        emaSeries(close + first, count, period, out);
+        break;
+    case ScreenField::ADR:
+        adrSeries(high + first, low + first, count, period, out);
+        break;
+    case ScreenField::ATR:
+        atrSeries(high + first, low + first, close + first, count, period, out);
+        break;
+    case ScreenField::AvgVolume:
+        smaSeries(volume + first, count, period, out);
+        break;
+    case ScreenField::HighestHigh:
+        rollingMaxSeries(high + first, count, period, out);
+        break;
+    case ScreenField::LowestLow:
+        rollingMinSeries(low + first, count, period, out);
+        break;
+    case ScreenField::ADRPercent: {
+        double sum = 0.0;
+        for (std::size_t i = last + 1 - period; i <= last; ++i) sum += high[i] / low[i];
+        return (sum / period - 1.0) * 100.0;
+    }
+    case ScreenField::Change:
+        if (count <= static_cast<std::size_t>(period)) return kNaN;
+        return (close[last] / close[last - period] - 1.0) * 100.0;
+    default:
+        return kNaN;
+    }
+    return out[count - 1];
+}
+
+bool sameColumn(const ScreenTerm& a, const ScreenTerm& b)
+{
+    return a.field == b.field && (a.field == ScreenField::Constant || a.period == b.period);
+}
+
+} // namespace
+
+std::size_t screenDepth(const ScreenQuery& query)
+{
+    std::size_t depth = std::max<std::size_t>(1, termDepth(query.rankBy));
+    for (const ScreenFilter& filter : query.filters) {
+        depth = std::max({depth, termDepth(filter.lhs), termDepth(filter.rhs)});
+    }
+    return depth;
+}
+
+std::vector<ScreenHit> runScreen(const ScreenPanel& panel, const ScreenQuery& query)
+{
+    const std::size_t count = panel.tickerCount();
+
+    // One column per distinct (field, period); scales are applied when columns are compared
+    std::vector<ScreenTerm> terms;
+    auto columnFor = [&terms](const ScreenTerm& term) {
+        for (std::size_t c = 0; c < terms.size(); ++c) {
+            if (sameColumn(terms[c], term)) return c;
+        }
+        terms.push_back(term);
+        return terms.size() - 1;
+    };
+    struct CompiledFilter { std::size_t lhs, rhs; double lhsScale, rhsScale; ScreenCompare op; };
+    std::vector<CompiledFilter> filters;
+    for (const ScreenFilter& filter : query.filters) {
+        filters.push_back({columnFor(filter.lhs), columnFor(filter.rhs), filter.lhs.scale, filter.rhs.scale, filter.op});
+    }
+    const std::size_t rankColumn = columnFor(query.rankBy);
+
+    std::vector<std::vector<double>> columns(terms.size(), std::vector<double>(count));
+    parallelRanges(count, workerCount(count, kMinTickersPerThread, UINT_MAX), [&](std::size_t first, std::size_t last) {
+        std::vector<double> scratch;
+        for (std::size_t c = 0; c < terms.size(); ++c) {
+            double* values = columns[c].data();
+            for (std::size_t t = first; t < last; ++t) {
+                values[t] = termValue(panel, t * panel.depth, terms[c], scratch);
+            }
+        }
+    });
+
+    // NaN compares false, so tickers lacking the history for any term drop out here
+    std::vector<unsigned char> pass(count, 1);
+    unsigned char* mask = pass.data();
+    for (const CompiledFilter& filter : filters) {
+        const double* a = columns[filter.lhs].data();
+        const double* b = columns[filter.rhs].data();
+        const double sa = filter.lhsScale;
+        const double sb = filter.rhsScale;
+        switch (filter.op) {
+        case ScreenCompare::Greater:
+            for (std::size_t t = 0; t < count; ++t) mask[t] &= a[t] * sa > b[t] * sb;
+            break;
+        case ScreenCompare::GreaterEqual:
+            for (std::size_t t = 0; t < count; ++t) mask[t] &= a[t] * sa >= b[t] * sb;
+            break;
+        case ScreenCompare::Less:
+            for (std::size_t t = 0; t < count; ++t) mask[t] &= a[t] * sa < b[t] * sb;
+            break;
+        case ScreenCompare::LessEqual:
+            for (std::size_t t = 0; t < count; ++t) mask[t] &= a[t] * sa <= b[t] * sb;
+            break;
+        }
+    }
+
+    std::vector<ScreenHit> hits;
+    const double* rank = columns[rankColumn].data();
+    for (std::size_t t = 0; t < count; ++t) {
+        if (mask[t] && !std::isnan(rank[t])) {
+            hits.push_back({t, rank[t] * query.rankBy.scale, panel.close[t * panel.depth + panel.depth - 1]});
+        }
+    }
+
+    auto order = [&query](const ScreenHit& a, const ScreenHit& b) {
+        return query.ascending ? a.rank < b.rank : a.rank > b.rank;
+    };
+    if (query.limit > 0 && query.limit < hits.size()) {
+        std::partial_sort(hits.begin(), hits.begin() + static_cast<std::ptrdiff_t>(query.limit), hits.end(), order);
+        hits.resize(query.limit);
+    } else {
+        std::sort(hits.begin(), hits.end(), order);
+    }
+    return hits;
+}
@@ -0,0 +1,89 @@
+#ifndef SCREENER_H
+#define SCREENER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Trailing window of bars for every ticker of a universe, laid out as one array per field. Ticker t
+// owns [t * depth, (t + 1) * depth) of each array, oldest bar first and right-aligned: tickers with
+// less history have NaN in their leading slots.
+struct ScreenPanel {
+    std::size_t depth = 0;
+    std::uint64_t generation = 0;    // BarRepository::generation() when loading started
+    std::vector<std::string> tickers;
+    std::vector<int> lastDay;        // day number of each ticker's latest bar
+    std::vector<double> open, high, low, close, volume;
+
+    std::size_t tickerCount() const { return tickers.size(); }
+    std::size_t bytes() const;
+};
+
+// Loads the last depth bars of each symbol (every ticker in the database if symbols is empty).
+// Histories already held by BarRepository are copied from memory; the rest are read through the
+// (ticker_id, day) primary key on several pooled reader connections at once.
+// Symbols without bars are left out. Returns false if the database is not open.
+bool loadScreenPanel(const std::vector<std::string>& symbols, std::size_t depth, ScreenPanel& panel);
+
+// --- Queries ---
+
+enum class ScreenField {
+    Constant,       // scale is the value
+    Open, High, Low, Close, Volume,   // latest bar
+    SMA,            // of close
+    EMA,            // of close, seeded with the SMA at the start of the panel window
+    ADR,            // mean high - low, as used by the backtest
+    ATR,            // Wilder-smoothed true range
+    ADRPercent,     // mean (high / low - 1) * 100
+    AvgVolume,
+    Change,         // close versus period bars ago, in percent
+    HighestHigh,
+    LowestLow,
+};
+
+// scale * field(period), evaluated at each ticker's latest bar
+struct ScreenTerm {
+    ScreenField field = ScreenField::Constant;
+    int period = 0;
+    double scale = 1.0;
+};
+
+enum class ScreenCompare { Greater, GreaterEqual, Less, LessEqual };
+
+struct ScreenFilter {
+    ScreenTerm lhs;
+    ScreenCompare op;
+    ScreenTerm rhs;
+};
+
+// All filters must hold; hits are ordered by rankBy (descending unless ascending is set) and
+// truncated to limit if it is non-zero.
+struct ScreenQuery {
+    std::vector<ScreenFilter> filters;
+    ScreenTerm rankBy{ScreenField::Change, 1, 1.0};
+    bool ascending = false;
+    std::size_t limit = 0;
+};
+
+// Parses filters such as "close > sma(50) and adr%(14) > 4 and avgvol(20) > 5e6" and rank terms such
+// as "change(20)". Fields: open high low close volume sma(n) ema(n) adr(n) adr%(n) atr(n)
+// avgvol(n) change(n) hh(n) ll(n); a term may be multiplied by a number, e.g. "2*adr(14)".
+// On failure returns false and describes the problem in error.
+bool parseScreenFilters(const std::string& text, std::vector<ScreenFilter>& filters, std::string& error);
+bool parseScreenTerm(const std::string& text, ScreenTerm& term, std::string& error);
+
+// Bars of history the query needs for every term to be defined.
+std::size_t screenDepth(const ScreenQuery& query);
+
+struct ScreenHit {
+    std::size_t ticker;   // index into the panel
+    double rank;
+    double close;
+};
+
+// Evaluates query over every ticker of panel. Each term becomes one column with a value per ticker,
+// computed on worker threads; filters are then applied column against column as a branch-free mask.
+std::vector<ScreenHit> runScreen(const ScreenPanel& panel, const ScreenQuery& query);
+
+#endif // SCREENER_H
@@ -0,0 +1,136 @@
+#include "screenerpage.h"
+#include "bar_repository.h"
+#include "day_number.h"
+
+#include <QHeaderView>
+#include <QPushButton>
+#include <QTableWidgetItem>
+#include <QtConcurrent/QtConcurrentRun>
+#include <QDebug>
+#include <chrono>
+
+ScreenerPage::ScreenerPage(QWidget *parent) :
+    QWidget(parent),
+    ui(new Ui::ScreenerPage),
+    m_watcher(new QFutureWatcher<ScreenRun>(this))
+{
+    ui->setupUi(this);
+
+    ui->resultsTable->setColumnCount(4);
+    ui->resultsTable->setHorizontalHeaderLabels(QStringList() << "Ticker" << "Rank" << "Close" << "Last Bar");
+    ui->resultsTable->horizontalHeader()->setSectionResizeMode(QHeaderView::Stretch);
+    ui->resultsTable->setEditTriggers(QAbstractItemView::NoEditTriggers);
+    ui->resultsTable->setSelectionBehavior(QAbstractItemView::SelectRows);
+
+    connect(ui->runScreenButton, &QPushButton::clicked, this, &ScreenerPage::runScreenButton_Clicked);
+    connect(ui->enterFilters, &QLineEdit::returnPressed, this, &ScreenerPage::runScreenButton_Clicked);
+    connect(ui->reloadDataButton, &QPushButton::clicked, this, &ScreenerPage::reloadDataButton_Clicked);
+    connect(ui->showInWatchlistButton, &QPushButton::clicked, this, &ScreenerPage::showInWatchlistButton_Clicked);
+    connect(m_watcher, &QFutureWatcher<ScreenRun>::finished, this, &ScreenerPage::onScreenFinished);
+    connect(ui->resultsTable, &QTableWidget::cellDoubleClicked, this, [this](int row, int) {
+        emit symbolActivated(ui->resultsTable->item(row, 0)->text());
+    });
+}
+
+ScreenerPage::~ScreenerPage()
+{
+    m_watcher->waitForFinished();
+    delete ui;
+}
+
+void ScreenerPage::runScreenButton_Clicked()
+{
+    if (m_watcher->isRunning()) {
+        return;
+    }
+
+    ScreenQuery query;
+    std::string error;
+    if (!parseScreenFilters(ui->enterFilters->text().toStdString(), query.filters, error)
+        || !parseScreenTerm(ui->enterRank->text().toStdString(), query.rankBy, error)) {
+        ui->screenStatus->setText(QString::fromStdString(error));
+        return;
+    }
+    query.limit = static_cast<std::size_t>(std::max(0, ui->enterLimit->text().toInt()));
+
+    const std::size_t depth = screenDepth(query);
+    // A fetch or import since the panel was read invalidated some of its bars
+    const bool stale = m_panel && m_panel->generation != BarRepository::instance().generation();
+    std::shared_ptr<const ScreenPanel> panel = m_panel && !stale && m_panel->depth >= depth ? m_panel : nullptr;
+    ui->screenStatus->setText(panel ? "Screening..." : stale ? "Bars have changed, reloading..." : "Loading bars...");
+    ui->runScreenButton->setEnabled(false);
+
+    m_watcher->setFuture(QtConcurrent::run([panel, depth, query]() {
+        using Clock = std::chrono::steady_clock;
+        ScreenRun run;
+        run.panel = panel;
+        Clock::time_point start = Clock::now();
+        if (!run.panel) {
+            auto loaded = std::make_shared<ScreenPanel>();
+            if (!loadScreenPanel({}, depth, *loaded)) {
+                return run;
+            }
+            run.panel = loaded;
+            run.loaded = true;
+        }
+        Clock::time_point loadedAt = Clock::now();
+        run.hits = runScreen(*run.panel, query);
+        run.loadMs = std::chrono::duration<double, std::milli>(loadedAt - start).count();
+        run.screenMs = std::chrono::duration<double, std::milli>(Clock::now() - loadedAt).count();
+        return run;
+    }));
+}
+
+void ScreenerPage::reloadDataButton_Clicked()
+{
+    // New bars were imported; the next run reads them again
+    m_panel.reset();
+    ui->screenStatus->setText("Bars will be reloaded on the next run.");
+}
+
+void ScreenerPage::showInWatchlistButton_Clicked()
+{
+    emit showSymbols(m_results);
+}
+
+void ScreenerPage::onScreenFinished()
+{
+    ui->runScreenButton->setEnabled(true);
+    ScreenRun run = m_watcher->result();
+    if (!run.panel) {
+        ui->screenStatus->setText("Failed to read the database.");
+        return;
+    }
+    m_panel = run.panel;
+    populateResultsTable(run);
+
+    QString status = QString("%1 of %2 tickers matched").arg(run.hits.size()).arg(run.panel->tickerCount());
+    if (run.loaded) {
+        status += QString(", loaded %1 bars each in %2 ms").arg(run.panel->depth).arg(run.loadMs, 0, 'f', 0);
+    }
+    status += QString(", screened in %1 ms").arg(run.screenMs, 0, 'f', 1);
+    ui->screenStatus->setText(status);
+}
+
+void ScreenerPage::populateResultsTable(const ScreenRun &run)
+{
+    const ScreenPanel &panel = *run.panel;
+    m_results.clear();
+    ui->resultsTable->setSortingEnabled(false);
+    ui->resultsTable->setRowCount(static_cast<int>(run.hits.size()));
+    for (int row = 0; row < static_cast<int>(run.hits.size()); ++row) {
+        const ScreenHit &hit = run.hits[static_cast<std::size_t>(row)];
+        const QString ticker = QString::fromStdString(panel.tickers[hit.ticker]);
+        m_results.append(ticker);
+
+        auto *rankItem = new QTableWidgetItem();
+        rankItem->setData(Qt::DisplayRole, hit.rank);
+        auto *closeItem = new QTableWidgetItem();
+        closeItem->setData(Qt::DisplayRole, hit.close);
+        ui->resultsTable->setItem(row, 0, new QTableWidgetItem(ticker));
+        ui->resultsTable->setItem(row, 1, rankItem);
+        ui->resultsTable->setItem(row, 2, closeItem);
+        ui->resultsTable->setItem(row, 3, new QTableWidgetItem(QString::fromStdString(dayToString(panel.lastDay[hit.ticker]))));
+    }
+    ui->resultsTable->setSortingEnabled(true);
+}
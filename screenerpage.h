@@ -0,0 +1,51 @@
+#ifndef SCREENERPAGE_H
+#define SCREENERPAGE_H
+
+#include <QWidget>
+#include <QFutureWatcher>
+#include <QStringList>
+#include <memory>
+#include "ui_screenerpage.h"  // Generated from screenerpage.ui
+#include "screener.h"
+
+// Runs filter expressions over every ticker in the database and lists the matches, ranked.
+// Double-clicking a match charts it; the whole list can be sent to the watchlist.
+class ScreenerPage : public QWidget
+{
+    Q_OBJECT
+
+public:
+    explicit ScreenerPage(QWidget *parent = nullptr);
+    ~ScreenerPage();
+
+signals:
+    void symbolActivated(const QString &symbol);
+    void showSymbols(const QStringList &symbols);
+
+private slots:
+    void runScreenButton_Clicked();
+    void reloadDataButton_Clicked();
+    void showInWatchlistButton_Clicked();
+    void onScreenFinished();
+
+private:
+    // Everything a run hands back to the GUI thread
+    struct ScreenRun {
+        std::shared_ptr<const ScreenPanel> panel;
+        std::vector<ScreenHit> hits;
+        bool loaded = false;     // panel was (re)loaded for this run
+        double loadMs = 0.0;
+        double screenMs = 0.0;
+    };
+
+    void populateResultsTable(const ScreenRun &run);
+
+    Ui::ScreenerPage *ui;
+    QFutureWatcher<ScreenRun> *m_watcher;
+    // Kept between runs; reloaded when a query needs more history, when BarRepository has
+    // invalidated bars since it was read, or on Reload Data
+    std::shared_ptr<const ScreenPanel> m_panel;
+    QStringList m_results;
+};
+
+#endif // SCREENERPAGE_H
@@ -0,0 +1,494 @@
+#include "signal_backtest.h"
+#include "day_number.h"
+#include "indicator_kernels.h"
+#include "profiler.h"
+
+#include <algorithm>
+#include <atomic>
+#include <climits>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <iomanip>
+#include <map>
+#include <sstream>
+#include <thread>
+#include <tuple>
+
+namespace {
+
+// Per-bar values of screener terms over one view, each computed once. Indicators that the feature
+// store keeps come from there; the rest are computed over the view.
+class TermColumns
+{
+public:
+    explicit TermColumns(const BarView& bars) : bars_(bars), indicators_(bars), ones_(bars.size(), 1.0) {}
+
+    // scale is applied by the caller
+    const double* column(const ScreenTerm& term)
+    {
+        const std::size_t n = bars_.size();
+        const int period = std::max(1, term.period);
+        switch (term.field) {
+        case ScreenField::Constant:   return ones_.data();
+        case ScreenField::Open:       return bars_.open();
+        case ScreenField::High:       return bars_.high();
+        case ScreenField::Low:        return bars_.low();
+        case ScreenField::Close:      return bars_.close();
+        case ScreenField::Volume:     return bars_.volume();
+        case ScreenField::SMA:        return indicators_.values(FeatureKind::SMA, period);
+        case ScreenField::EMA:        return indicators_.values(FeatureKind::EMA, period);
+        case ScreenField::ADR:        return indicators_.values(FeatureKind::ADR, period);
+        case ScreenField::ATR:        return indicators_.values(FeatureKind::ATR, period);
+        case ScreenField::AvgVolume:  return indicators_.values(FeatureKind::AvgVolume, period);
+        default:                      break;
+        }
+
+        for (const Column& cached : columns_) {
+            if (cached.field == term.field && cached.period == period) {
+                return cached.values.data();
+            }
+        }
+        std::vector<double> values(n, 0.0);
+        const double* close = bars_.close();
+        switch (term.field) {
+        case ScreenField::ADRPercent: {
+            std::vector<double> ratio(n);
+            for (std::size_t i = 0; i < n; ++i) ratio[i] = bars_.high()[i] / bars_.low()[i];
+            smaSeries(ratio.data(), n, period, values.data());
+            for (std::size_t i = static_cast<std::size_t>(period) - 1; i < n; ++i) values[i] = (values[i] - 1.0) * 100.0;
+            break;
+        }
+        case ScreenField::Change:
+            for (std::size_t i = static_cast<std::size_t>(period); i < n; ++i) {
+                values[i] = (close[i] / close[i - period] - 1.0) * 100.0;
+            }
+            break;
+        case ScreenField::HighestHigh:
+            rollingMaxSeries(bars_.high(), n, period, values.data());
+            break;
+        case ScreenField::LowestLow:
+            rollingMinSeries(bars_.low(), n, period, values.data());
+            break;
+        default:
+            break;
+        }
+        columns_.push_back({term.field, period, std::move(values)});
+        return columns_.back().values.data();
+    }
+
+    // Bars where filter holds. Rule variants mostly share their filters, so each distinct one is
+    // compared once per ticker and rules only combine the masks.
+    const unsigned char* filterMask(const ScreenFilter& filter)
+    {
+        const FilterKey key{filter.lhs.field, filter.lhs.period, filter.lhs.scale, filter.op,
+                            filter.rhs.field, filter.rhs.period, filter.rhs.scale};
+        auto it = masks_.find(key);
+        if (it != masks_.end()) {
+            return it->second.data();
+        }
+
+        const std::size_t n = bars_.size();
+        std::vector<unsigned char> mask(n, 1);
+        const double* lhs = column(filter.lhs);
+        const double* rhs = column(filter.rhs);
+        const double ls = filter.lhs.scale;
+        const double rs = filter.rhs.scale;
+        switch (filter.op) {
+        case ScreenCompare::Greater:      andGreaterMask(lhs, ls, rhs, rs, n, false, mask.data()); break;
+        case ScreenCompare::GreaterEqual: andGreaterMask(lhs, ls, rhs, rs, n, true, mask.data()); break;
+        case ScreenCompare::Less:         andGreaterMask(rhs, rs, lhs, ls, n, false, mask.data()); break;
+        case ScreenCompare::LessEqual:    andGreaterMask(rhs, rs, lhs, ls, n, true, mask.data()); break;
+        }
+        return masks_.emplace(key, std::move(mask)).first->second.data();
+    }
+
+    Indicators& indicators() { return indicators_; }
+
+private:
+    using FilterKey = std::tuple<ScreenField, int, double, ScreenCompare, ScreenField, int, double>;
+
+    struct Column {
+        ScreenField field;
+        int period;
+        std::vector<double> values;
+    };
+
+    BarView bars_;
+    Indicators indicators_;
+    std::vector<double> ones_;
+    std::vector<Column> columns_;
+    std::map<FilterKey, std::vector<unsigned char>> masks_;
+};
+
+// First bar at which term is defined within the view
+std::size_t termWarmup(const ScreenTerm& term)
+{
+    switch (term.field) {
+    case ScreenField::Constant:
+    case ScreenField::Open:
+    case ScreenField::High:
+    case ScreenField::Low:
+    case ScreenField::Close:
+    case ScreenField::Volume:
+        return 0;
+    case ScreenField::Change:
+        return static_cast<std::size_t>(std::max(1, term.period));
+    default:
+        return static_cast<std::size_t>(std::max(1, term.period)) - 1;
+    }
+}
+
+// mask[i] &= other[i], eight bars at a time
+void andMasks(unsigned char* mask, const unsigned char* other, std::size_t n)
+{
+    std::size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        std::uint64_t a, b;
+        std::memcpy(&a, mask + i, 8);
+        std::memcpy(&b, other + i, 8);
+        a &= b;
+        std::memcpy(mask + i, &a, 8);
+    }
+    for (; i < n; ++i) mask[i] &= other[i];
+}
+
+SignalStats evaluateRule(const BarView& bars, TermColumns& columns, const SignalRule& rule,
+                         std::vector<unsigned char>& entries, std::vector<TradeRecord>* trades)
+{
+    SignalStats stats;
+    const std::size_t n = bars.size();
+    std::size_t warmup = static_cast<std::size_t>(std::max(1, rule.adrPeriod)) - 1;
+    for (const ScreenFilter& filter : rule.entry) {
+        warmup = std::max({warmup, termWarmup(filter.lhs), termWarmup(filter.rhs)});
+    }
+    if (n < warmup + 2) {
+        return stats;
+    }
+
+    // --- Signal array ---
+    entries.assign(n, 1);
+    std::fill(entries.begin(), entries.begin() + static_cast<std::ptrdiff_t>(warmup), 0);
+    unsigned char* entry = entries.data();
+    for (const ScreenFilter& filter : rule.entry) {
+        andMasks(entry, columns.filterMask(filter), n);
+    }
+    const double* adr = columns.indicators().values(FeatureKind::ADR, std::max(1, rule.adrPeriod));
+    const double* close = bars.close();
+
+    // --- Resolver ---
+    const double* high = bars.high();
+    const double* low = bars.low();
+    const int* day = bars.day();
+    const std::size_t maxHold = rule.maxHoldBars > 0 ? static_cast<std::size_t>(rule.maxHoldBars) : n;
+    std::size_t from = warmup;
+    while (from + 1 < n) {
+        const void* found = std::memchr(entry + from, 1, n - 1 - from);
+        if (!found) {
+            break;
+        }
+        const std::size_t e = static_cast<std::size_t>(static_cast<const unsigned char*>(found) - entry);
+        from = e + 1;
+        if (!(adr[e] > 0.0)) {
+            continue;
+        }
+        const int quantity = static_cast<int>(rule.dollarRisk / adr[e]);
+        if (quantity < 1) {
+            continue;
+        }
+
+        const double stop = close[e] - rule.stopAdrs * adr[e];
+        const double target = close[e] + rule.targetAdrs * adr[e];
+        const std::size_t lastBar = std::min(n - 1, e + maxHold);
+        std::size_t x = e + 1;
+        while (x <= lastBar && low[x] > stop && high[x] < target) {
+            ++x;
+        }
+        double exitPrice;
+        const char* info;
+        if (x > lastBar) {
+            if (lastBar == n - 1 && e + maxHold > n - 1) {
+                break;   // still open at the last bar
+            }
+            x = lastBar;
+            exitPrice = close[x];
+            info = "Time";
+        } else if (low[x] <= stop) {
+            exitPrice = stop;
+            info = "Stop";
+        } else {
+            exitPrice = target;
+            info = "Target";
+        }
+
+        const double profit = (exitPrice - close[e]) * quantity;
+        stats.trades++;
+        stats.wins += profit > 0.0;
+        stats.profit += profit;
+        if (trades) {
+            TradeRecord trade;
+            trade.ticker = bars.ticker();
+            trade.buyDate = dayToString(day[e]);
+            trade.sellDate = dayToString(day[x]);
+            trade.buyDay = day[e];
+            trade.sellDay = day[x];
+            trade.buyPrice = close[e];
+            trade.sellPrice = exitPrice;
+            trade.quantity = quantity;
+            trade.info = info;
+            trades->push_back(trade);
+        }
+        // Flat again after the exit bar
+        from = x + 1;
+    }
+    return stats;
+}
+
+} // namespace
+
+SignalStats runSignalBacktest(const BarView& bars, const SignalRule& rule, std::vector<TradeRecord>* trades)
+{
+    TermColumns columns(bars);
+    std::vector<unsigned char> entries;
+    return evaluateRule(bars, columns, rule, entries, trades);
+}
+
+std::vector<SignalStats> screenSignalRules(const std::vector<BarView>& views, const std::vector<SignalRule>& rules)
+{
+    BTE_PROFILE_SCOPE("screenSignalRules");
+    std::vector<SignalStats> totals(rules.size());
+    if (views.empty() || rules.empty()) {
+        return totals;
+    }
+
+    const unsigned int threads = static_cast<unsigned int>(
+        std::min<std::size_t>(std::max(1u, std::thread::hardware_concurrency()), views.size()));
+    std::vector<std::vector<SignalStats>> perThread(threads, std::vector<SignalStats>(rules.size()));
+    std::atomic<std::size_t> next{0};
+    auto work = [&](unsigned int t) {
+        std::vector<unsigned char> entries;
+        std::vector<SignalStats>& local = perThread[t];
+        for (std::size_t v = next++; v < views.size(); v = next++) {
+            TermColumns columns(views[v]);
+            for (std::size_t r = 0; r < rules.size(); ++r) {
+                local[r].merge(evaluateRule(views[v], columns, rules[r], entries, nullptr));
+            }
+        }
+    };
+
+    std::vector<std::thread> workers;
+    for (unsigned int t = 1; t < threads; ++t) {
+        workers.emplace_back(work, t);
+    }
+    work(0);
+    for (std::thread& worker : workers) {
+        worker.join();
+    }
+    for (const std::vector<SignalStats>& local : perThread) {
+        for (std::size_t r = 0; r < rules.size(); ++r) {
+            totals[r].merge(local[r]);
+        }
+    }
+    return totals;
+}
+
+// ------------------------
+// Rule grids
+// ------------------------
+
+namespace {
+
+bool parseGridValues(const std::string& key, const std::string& list, std::vector<double>& values, std::string& error)
+{
+    std::size_t start = 0;
+    while (start <= list.size()) {
+        std::size_t end = list.find(',', start);
+        if (end == std::string::npos) {
+            end = list.size();
+        }
+        const std::string item = list.substr(start, end - start);
+        char* parsedEnd = nullptr;
+        const double value = std::strtod(item.c_str(), &parsedEnd);
+        if (item.empty() || parsedEnd != item.c_str() + item.size()) {
+            error = "invalid value \"" + item + "\" for " + key;
+            return false;
+        }
+        values.push_back(value);
+        start = end + 1;
+    }
+    return true;
+}
+
+bool setRuleParam(SignalRule& rule, const std::string& key, double value, std::string& error)
+{
+    int* integer = nullptr;
+    if (key == "adr") integer = &rule.adrPeriod;
+    else if (key == "hold") integer = &rule.maxHoldBars;
+    else if (key == "risk") integer = &rule.dollarRisk;
+    else if (key == "stop") rule.stopAdrs = value;
+    else if (key == "target") rule.targetAdrs = value;
+    else {
+        error = "unknown parameter \"" + key + "\" (adr, stop, target, hold or risk)";
+        return false;
+    }
+
+    if (integer) {
+        if (!(value >= 0.0 && value <= INT_MAX) || value != std::floor(value)) {
+            std::ostringstream text;
+            text << value;
+            error = key + " must be a whole number, got " + text.str();
+            return false;
+        }
+        *integer = static_cast<int>(value);
+    }
+    if (rule.adrPeriod <= 0) {
+        error = "adr must be positive";
+        return false;
+    }
+    return true;
+}
+
+std::string trimmed(const std::string& text)
+{
+    const std::size_t begin = text.find_first_not_of(" \t\r");
+    if (begin == std::string::npos) {
+        return std::string();
+    }
+    return text.substr(begin, text.find_last_not_of(" \t\r") - begin + 1);
+}
+
+// scale * field(period) in the rule language, every number exact
+std::string termText(const ScreenTerm& term)
+{
+    std::ostringstream text;
+    text << std::setprecision(17);
+    if (term.field == ScreenField::Constant) {
+        text << term.scale;
+        return text.str();
+    }
+    if (term.scale != 1.0) {
+        text << term.scale << " * ";
+    }
+    const int period = std::max(1, term.period);
+    switch (term.field) {
+    case ScreenField::Open:        text << "open"; break;
+    case ScreenField::High:        text << "high"; break;
+    case ScreenField::Low:         text << "low"; break;
+    case ScreenField::Close:       text << "close"; break;
+    case ScreenField::Volume:      text << "volume"; break;
+    case ScreenField::SMA:         text << "sma(close, " << period << ")"; break;
+    case ScreenField::EMA:         text << "ema(close, " << period << ")"; break;
+    case ScreenField::ADR:         text << "adr(" << period << ")"; break;
+    case ScreenField::ATR:         text << "atr(" << period << ")"; break;
+    case ScreenField::AvgVolume:   text << "avgvol(" << period << ")"; break;
+    case ScreenField::Change:      text << "((close / prev(close, " << period << ") - 1) * 100)"; break;
+    case ScreenField::HighestHigh: text << "highest(high, " << period << ")"; break;
+    case ScreenField::LowestLow:   text << "lowest(low, " << period << ")"; break;
+    default:                       break;   // adr% is refused by parseSignalRuleGrid
+    }
+    return text.str();
+}
+
+} // namespace
+
+bool parseSignalRuleGrid(const std::string& text, std::vector<SignalRule>& rules, std::string& error)
+{
+    std::vector<std::vector<ScreenFilter>> entries;
+    std::vector<SignalRule> grid(1);
+    std::istringstream lines(text);
+    std::string line;
+    for (int number = 1; std::getline(lines, line); ++number) {
+        const std::string where = "line " + std::to_string(number) + ": ";
+        line = trimmed(line.substr(0, line.find('#')));
+        const std::size_t colon = line.find(':');
+        if (colon != std::string::npos) {
+            if (trimmed(line.substr(0, colon)) != "entry") {
+                error = where + "expected \"entry:\" or key=values";
+                return false;
+            }
+            std::vector<ScreenFilter> filters;
+            if (!parseScreenFilters(line.substr(colon + 1), filters, error)) {
+                error = where + error;
+                return false;
+            }
+            if (filters.empty()) {
+                error = where + "an entry needs at least one filter";
+                return false;
+            }
+            for (const ScreenFilter& filter : filters) {
+                if (filter.lhs.field == ScreenField::ADRPercent || filter.rhs.field == ScreenField::ADRPercent) {
+                    error = where + "adr%(n) cannot be run by the rule engine";
+                    return false;
+                }
+            }
+            entries.push_back(std::move(filters));
+            continue;
+        }
+
+        std::istringstream words(line);
+        std::string word;
+        while (words >> word) {
+            const std::size_t equals = word.find('=');
+            if (equals == std::string::npos) {
+                error = where + "expected key=values, got \"" + word + "\"";
+                return false;
+            }
+            const std::string key = word.substr(0, equals);
+            std::vector<double> values;
+            if (!parseGridValues(key, word.substr(equals + 1), values, error)) {
+                error = where + error;
+                return false;
+            }
+
+            std::vector<SignalRule> expanded;
+            expanded.reserve(grid.size() * values.size());
+            for (const SignalRule& base : grid) {
+                for (double value : values) {
+                    SignalRule rule = base;
+                    if (!setRuleParam(rule, key, value, error)) {
+                        error = where + error;
+                        return false;
+                    }
+                    expanded.push_back(rule);
+                }
+            }
+            grid.swap(expanded);
+        }
+    }
+    if (entries.empty()) {
+        error = "no entry line";
+        return false;
+    }
+
+    rules.clear();
+    rules.reserve(entries.size() * grid.size());
+    for (const std::vector<ScreenFilter>& filters : entries) {
+        for (const SignalRule& params : grid) {
+            SignalRule rule = params;
+            rule.entry = filters;
+            rules.push_back(std::move(rule));
+        }
+    }
+    return true;
+}
+
+std::string describeSignalRule(const SignalRule& rule)
+{
+    static const char* const compare[] = {" > ", " >= ", " < ", " <= "};
+    std::ostringstream text;
+    text << std::setprecision(17) << "entry: ";
+    for (std::size_t f = 0; f < rule.entry.size(); ++f) {
+        const ScreenFilter& filter = rule.entry[f];
+        text << (f > 0 ? " and " : "") << termText(filter.lhs) << compare[static_cast<int>(filter.op)]
+             << termText(filter.rhs);
+    }
+    const int adrPeriod = std::max(1, rule.adrPeriod);
+    text << "; stop: entry - " << rule.stopAdrs << " * adr(" << adrPeriod << ")"
+         << "; target: entry + " << rule.targetAdrs << " * adr(" << adrPeriod << ")";
+    if (rule.maxHoldBars > 0) {
+        text << "; exit: held >= " << rule.maxHoldBars;
+    }
+    text << "; size: " << rule.dollarRisk << " / adr(" << adrPeriod << ")";
+    return text.str();
+}
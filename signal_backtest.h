@@ -0,0 +1,65 @@
+#ifndef SIGNAL_BACKTEST_H
+#define SIGNAL_BACKTEST_H
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+#include "backtest.h"
+#include "bar_repository.h"
+#include "screener.h"
+
+// A rule strategy simple enough to evaluate as whole arrays: buy at the close of every bar where
+// all entry filters hold while flat, then sell at the first later bar that reaches the stop or
+// the target (the stop wins if a bar reaches both), or at the close once maxHoldBars have passed.
+// Filters use the screener's terms, evaluated at every bar instead of the latest one.
+struct SignalRule {
+    std::vector<ScreenFilter> entry;
+    int adrPeriod = 14;
+    double stopAdrs = 1.0;      // stop and target, in ADRs from the entry close
+    double targetAdrs = 3.0;
+    int maxHoldBars = 0;        // 0 holds until the stop or the target
+    int dollarRisk = 100;       // shares = dollarRisk / ADR, as in Backtest
+};
+
+struct SignalStats {
+    std::size_t trades = 0;
+    std::size_t wins = 0;
+    double profit = 0.0;
+
+    void merge(const SignalStats& other) {
+        trades += other.trades;
+        wins += other.wins;
+        profit += other.profit;
+    }
+};
+
+// The entry signal is built as a byte per bar with the mask kernels of indicator_kernels.h; a
+// sequential pass then jumps from entry to entry and scans for each one's exit. Trades are only
+// formatted into records when trades is given. Positions still open at the last bar are not counted.
+SignalStats runSignalBacktest(const BarView& bars, const SignalRule& rule, std::vector<TradeRecord>* trades = nullptr);
+
+// Totals of every rule over every view, for screening many variants before the detailed engine.
+// Each ticker's term series are computed once and shared by all rules; tickers are spread over
+// worker threads.
+std::vector<SignalStats> screenSignalRules(const std::vector<BarView>& views, const std::vector<SignalRule>& rules);
+
+// Every rule of a grid such as
+//
+//   entry: close > hh(20) and avgvol(20) > 5e6
+//   entry: close > sma(50) and change(5) > 10
+//   stop=1,1.5 target=2,3,4 hold=0,10
+//
+// Each entry line holds screener filters (see parseScreenFilters) and is one alternative; the
+// other lines hold key=values words, every combination of which is tried with every entry. Keys:
+// adr stop target hold risk; keys that are not named keep the SignalRule defaults. adr%(n) is
+// refused, since the rule language has no equivalent to run the best rules in detail with. '#'
+// starts a comment. On failure returns false and describes the problem, naming the line, in error.
+bool parseSignalRuleGrid(const std::string& text, std::vector<SignalRule>& rules, std::string& error);
+
+// rule as one line of the language compileRuleStrategy reads (see strategy_rules.h), e.g.
+// "entry: close > highest(high, 20); stop: entry - 1 * adr(14); ...". runRuleStrategy trades it
+// as runSignalBacktest does.
+std::string describeSignalRule(const SignalRule& rule);
+
+#endif // SIGNAL_BACKTEST_H
@@ -0,0 +1,837 @@
+#include "strategy_rules.h"
+#include "day_number.h"
+#include "indicator_kernels.h"
+#include "profiler.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <limits>
+#include <type_traits>
+
+namespace {
+
+// Not 0 and not NaN. Written without branches, like the ops below, so the loops over whole
+// columns vectorize.
+inline bool truthy(double value)
+{
+    return (value != 0.0) & (value == value);
+}
+
+template <RuleOp Op>
+inline double opValue(double x, double y)
+{
+    if constexpr (Op == RuleOp::Add) return x + y;
+    else if constexpr (Op == RuleOp::Sub) return x - y;
+    else if constexpr (Op == RuleOp::Mul) return x * y;
+    else if constexpr (Op == RuleOp::Div) return x / y;
+    else if constexpr (Op == RuleOp::Min) return std::min(x, y);
+    else if constexpr (Op == RuleOp::Max) return std::max(x, y);
+    else if constexpr (Op == RuleOp::Abs) return std::abs(x);
+    else if constexpr (Op == RuleOp::Neg) return -x;
+    else if constexpr (Op == RuleOp::Greater) return static_cast<double>(x > y);
+    else if constexpr (Op == RuleOp::GreaterEqual) return static_cast<double>(x >= y);
+    else if constexpr (Op == RuleOp::Less) return static_cast<double>(x < y);
+    else if constexpr (Op == RuleOp::LessEqual) return static_cast<double>(x <= y);
+    else if constexpr (Op == RuleOp::Equal) return static_cast<double>(x == y);
+    else if constexpr (Op == RuleOp::NotEqual) return static_cast<double>(x != y);
+    else if constexpr (Op == RuleOp::And) return static_cast<double>(truthy(x) & truthy(y));
+    else if constexpr (Op == RuleOp::Or) return static_cast<double>(truthy(x) | truthy(y));
+    else return static_cast<double>(!truthy(x));
+}
+
+// Calls f with the op as a compile-time constant, so each op gets its own loop
+template <typename F>
+decltype(auto) withOp(RuleOp op, F&& f)
+{
+    using C = RuleOp;
+    switch (op) {
+    case C::Add:          return f(std::integral_constant<C, C::Add>());
+    case C::Sub:          return f(std::integral_constant<C, C::Sub>());
+    case C::Mul:          return f(std::integral_constant<C, C::Mul>());
+    case C::Div:          return f(std::integral_constant<C, C::Div>());
+    case C::Min:          return f(std::integral_constant<C, C::Min>());
+    case C::Max:          return f(std::integral_constant<C, C::Max>());
+    case C::Abs:          return f(std::integral_constant<C, C::Abs>());
+    case C::Neg:          return f(std::integral_constant<C, C::Neg>());
+    case C::Greater:      return f(std::integral_constant<C, C::Greater>());
+    case C::GreaterEqual: return f(std::integral_constant<C, C::GreaterEqual>());
+    case C::Less:         return f(std::integral_constant<C, C::Less>());
+    case C::LessEqual:    return f(std::integral_constant<C, C::LessEqual>());
+    case C::Equal:        return f(std::integral_constant<C, C::Equal>());
+    case C::NotEqual:     return f(std::integral_constant<C, C::NotEqual>());
+    case C::And:          return f(std::integral_constant<C, C::And>());
+    case C::Or:           return f(std::integral_constant<C, C::Or>());
+    case C::Not:
+    default:              return f(std::integral_constant<C, C::Not>());
+    }
+}
+
+double applyOp(RuleOp op, double x, double y)
+{
+    return withOp(op, [&](auto c) { return opValue<decltype(c)::value>(x, y); });
+}
+
+// First bar at which column is defined within a view
+std::size_t columnWarmup(const RuleColumn& column)
+{
+    const std::size_t period = static_cast<std::size_t>(std::max(1, column.period));
+    switch (column.series) {
+    case RuleSeries::Field:    return 0;
+    case RuleSeries::Previous:
+    case RuleSeries::RSI:      return period;
+    default:                   return period - 1;
+    }
+}
+
+// ------------------------
+// Compiling
+// ------------------------
+
+// Emits one program's instructions. Constant operands are folded, and temporaries are reused as
+// soon as the instruction reading them is emitted, so a program needs about as many as its
+// expressions nest deep.
+class ProgramBuilder
+{
+public:
+    ProgramBuilder(RuleStrategy& strategy, RuleProgram& program) : strategy_(strategy), program_(program) {}
+
+    RuleOperand constant(double value)
+    {
+        RuleOperand operand;
+        operand.value = value;
+        return operand;
+    }
+
+    RuleOperand column(const RuleColumn& column)
+    {
+        std::vector<RuleColumn>& columns = strategy_.columns;
+        auto it = std::find(columns.begin(), columns.end(), column);
+        if (it == columns.end()) {
+            it = columns.insert(columns.end(), column);
+        }
+        program_.warmup = std::max(program_.warmup, columnWarmup(column));
+        RuleOperand operand;
+        operand.kind = RuleOperand::Column;
+        operand.index = static_cast<int>(it - columns.begin());
+        return operand;
+    }
+
+    RuleOperand position(RuleOperand::Kind kind)
+    {
+        program_.usesPosition = true;
+        RuleOperand operand;
+        operand.kind = kind;
+        return operand;
+    }
+
+    RuleOperand emit(RuleOp op, const RuleOperand& a, const RuleOperand& b = RuleOperand())
+    {
+        if (a.kind == RuleOperand::Constant && b.kind == RuleOperand::Constant) {
+            return constant(applyOp(op, a.value, b.value));
+        }
+        const bool perPosition = dependsOnPosition(a) || dependsOnPosition(b);
+        release(a, perPosition);
+        release(b, perPosition);
+        RuleOperand target;
+        target.kind = RuleOperand::Temp;
+        target.index = acquire(perPosition);
+        perPositionTemp_.resize(static_cast<std::size_t>(program_.temps));
+        perPositionTemp_[static_cast<std::size_t>(target.index)] = perPosition;
+        program_.code.push_back({op, target.index, a, b, perPosition});
+        return target;
+    }
+
+    // Adds one line's value to the program, combined with the lines before by op
+    void add(const RuleOperand& value, RuleOp op)
+    {
+        program_.result = program_.defined ? emit(op, program_.result, value) : value;
+        program_.defined = true;
+    }
+
+    bool defined() const { return program_.defined; }
+
+private:
+    bool dependsOnPosition(const RuleOperand& operand) const
+    {
+        switch (operand.kind) {
+        case RuleOperand::EntryPrice:
+        case RuleOperand::BarsHeld: return true;
+        case RuleOperand::Temp:     return perPositionTemp_[static_cast<std::size_t>(operand.index)];
+        default:                    return false;
+        }
+    }
+
+    // Shared values are computed for every bar before any perPosition instruction runs, so a
+    // temporary never passes between the two kinds: a shared one read by a perPosition
+    // instruction is not reused at all, since later perPosition runs still read it.
+    void release(const RuleOperand& operand, bool byPerPosition)
+    {
+        if (operand.kind != RuleOperand::Temp) {
+            return;
+        }
+        const bool perPosition = perPositionTemp_[static_cast<std::size_t>(operand.index)];
+        if (perPosition == byPerPosition) {
+            free_[perPosition].push_back(operand.index);
+        }
+    }
+
+    int acquire(bool perPosition)
+    {
+        std::vector<int>& free = free_[perPosition];
+        if (free.empty()) {
+            return program_.temps++;
+        }
+        auto lowest = std::min_element(free.begin(), free.end());
+        const int index = *lowest;
+        free.erase(lowest);
+        return index;
+    }
+
+    RuleStrategy& strategy_;
+    RuleProgram& program_;
+    std::vector<int> free_[2];             // shared, perPosition
+    std::vector<bool> perPositionTemp_;    // whether each temporary holds a perPosition value
+};
+
+class RuleParser
+{
+public:
+    RuleParser(const std::string& text, ProgramBuilder& builder, bool positionKnown)
+        : text_(text), builder_(builder), positionKnown_(positionKnown) {}
+
+    bool parse(RuleOperand& result)
+    {
+        if (!parseOr(result)) return false;
+        skipSpace();
+        if (pos_ < text_.size()) return fail(std::string("unexpected '") + text_[pos_] + "'");
+        return true;
+    }
+
+    const std::string& error() const { return error_; }
+
+private:
+    bool parseOr(RuleOperand& result)
+    {
+        if (!parseAnd(result)) return false;
+        while (acceptWord("or")) {
+            RuleOperand rhs;
+            if (!parseAnd(rhs)) return false;
+            result = builder_.emit(RuleOp::Or, result, rhs);
+        }
+        return true;
+    }
+
+    bool parseAnd(RuleOperand& result)
+    {
+        if (!parseNot(result)) return false;
+        while (acceptWord("and")) {
+            RuleOperand rhs;
+            if (!parseNot(rhs)) return false;
+            result = builder_.emit(RuleOp::And, result, rhs);
+        }
+        return true;
+    }
+
+    bool parseNot(RuleOperand& result)
+    {
+        if (acceptWord("not")) {
+            if (!parseNot(result)) return false;
+            result = builder_.emit(RuleOp::Not, result);
+            return true;
+        }
+        return parseComparison(result);
+    }
+
+    bool parseComparison(RuleOperand& result)
+    {
+        if (!parseSum(result)) return false;
+        skipSpace();
+        struct Comparison { const char* text; RuleOp op; };
+        static const Comparison comparisons[] = {
+            {">=", RuleOp::GreaterEqual}, {"<=", RuleOp::LessEqual}, {"==", RuleOp::Equal},
+            {"!=", RuleOp::NotEqual},     {">", RuleOp::Greater},    {"<", RuleOp::Less},
+        };
+        for (const Comparison& comparison : comparisons) {
+            const std::size_t length = std::strlen(comparison.text);
+            if (text_.compare(pos_, length, comparison.text) == 0) {
+                pos_ += length;
+                RuleOperand rhs;
+                if (!parseSum(rhs)) return false;
+                result = builder_.emit(comparison.op, result, rhs);
+                return true;
+            }
+        }
+        return true;
+    }
+
+    bool parseSum(RuleOperand& result)
+    {
+        if (!parseProduct(result)) return false;
+        for (;;) {
+            skipSpace();
+            if (pos_ >= text_.size() || (text_[pos_] != '+' && text_[pos_] != '-')) return true;
+            const RuleOp op = text_[pos_++] == '+' ? RuleOp::Add : RuleOp::Sub;
+            RuleOperand rhs;
+            if (!parseProduct(rhs)) return false;
+            result = builder_.emit(op, result, rhs);
+        }
+    }
+
+    bool parseProduct(RuleOperand& result)
+    {
+        if (!parseUnary(result)) return false;
+        for (;;) {
+            skipSpace();
+            if (pos_ >= text_.size() || (text_[pos_] != '*' && text_[pos_] != '/')) return true;
+            const RuleOp op = text_[pos_++] == '*' ? RuleOp::Mul : RuleOp::Div;
+            RuleOperand rhs;
+            if (!parseUnary(rhs)) return false;
+            result = builder_.emit(op, result, rhs);
+        }
+    }
+
+    bool parseUnary(RuleOperand& result)
+    {
+        skipSpace();
+        if (pos_ < text_.size() && text_[pos_] == '-') {
+            ++pos_;
+            if (!parseUnary(result)) return false;
+            result = builder_.emit(RuleOp::Neg, result);
+            return true;
+        }
+        return parsePrimary(result);
+    }
+
+    bool parsePrimary(RuleOperand& result)
+    {
+        skipSpace();
+        if (pos_ >= text_.size()) return fail("unexpected end of expression");
+
+        if (text_[pos_] == '(') {
+            ++pos_;
+            if (!parseOr(result)) return false;
+            return expect(')');
+        }
+
+        if (std::isdigit(static_cast<unsigned char>(text_[pos_])) || text_[pos_] == '.') {
+            const char* start = text_.c_str() + pos_;
+            char* end = nullptr;
+            const double number = std::strtod(start, &end);
+            if (end == start) return fail("expected a number");
+            pos_ += static_cast<std::size_t>(end - start);
+            result = builder_.constant(number);
+            return true;
+        }
+
+        const std::size_t wordStart = pos_;
+        const std::string name = readWord();
+        if (name.empty()) return fail(std::string("unexpected '") + text_[pos_] + "'");
+
+        RuleField field;
+        if (fieldNamed(name, field)) {
+            result = builder_.column({RuleSeries::Field, field, 0});
+            return true;
+        }
+        if (name == "entry" || name == "held") {
+            if (!positionKnown_) {
+                pos_ = wordStart;
+                return fail("'" + name + "' is only known in exit, stop, target and size");
+            }
+            result = builder_.position(name == "entry" ? RuleOperand::EntryPrice : RuleOperand::BarsHeld);
+            return true;
+        }
+
+        if (name == "min" || name == "max" || name == "abs") {
+            if (!expect('(') || !parseOr(result)) return false;
+            if (name == "abs") {
+                result = builder_.emit(RuleOp::Abs, result);
+                return expect(')');
+            }
+            RuleOperand rhs;
+            if (!expect(',') || !parseOr(rhs) || !expect(')')) return false;
+            result = builder_.emit(name == "min" ? RuleOp::Min : RuleOp::Max, result, rhs);
+            return true;
+        }
+
+        struct Function { const char* name; RuleSeries series; bool hasField; };
+        static const Function functions[] = {
+            {"sma", RuleSeries::SMA, true},          {"ema", RuleSeries::EMA, true},
+            {"highest", RuleSeries::Highest, true},  {"lowest", RuleSeries::Lowest, true},
+            {"prev", RuleSeries::Previous, true},    {"adr", RuleSeries::ADR, false},
+            {"atr", RuleSeries::ATR, false},         {"avgvol", RuleSeries::AvgVolume, false},
+            {"rsi", RuleSeries::RSI, false},         {"vwap", RuleSeries::VWAP, false},
+        };
+        const Function* function = nullptr;
+        for (const Function& candidate : functions) {
+            if (name == candidate.name) function = &candidate;
+        }
+        if (!function) {
+            pos_ = wordStart;
+            return fail("unknown name '" + name + "'");
+        }
+
+        RuleColumn column{function->series, RuleField::Close, 0};
+        if (!expect('(')) return false;
+        if (function->hasField) {
+            skipSpace();
+            const std::string source = readWord();
+            if (!fieldNamed(source, column.field)) {
+                return fail(name + " takes a field first, e.g. " + name + "(close, 10)");
+            }
+            if (!expect(',')) return false;
+        }
+        skipSpace();
+        char* end = nullptr;
+        const long period = std::strtol(text_.c_str() + pos_, &end, 10);
+        if (end == text_.c_str() + pos_ || period <= 0 || period > 100000) return fail("expected a positive period");
+        pos_ = static_cast<std::size_t>(end - text_.c_str());
+        if (!expect(')')) return false;
+
+        // A volume average is the stored avgvol series
+        if (column.series == RuleSeries::SMA && column.field == RuleField::Volume) {
+            column.series = RuleSeries::AvgVolume;
+        }
+        if (!function->hasField) {
+            column.field = RuleField::Close;
+        }
+        column.period = static_cast<int>(period);
+        result = builder_.column(column);
+        return true;
+    }
+
+    static bool fieldNamed(const std::string& name, RuleField& field)
+    {
+        struct Name { const char* name; RuleField field; };
+        static const Name names[] = {
+            {"open", RuleField::Open}, {"high", RuleField::High}, {"low", RuleField::Low},
+            {"close", RuleField::Close}, {"volume", RuleField::Volume},
+        };
+        for (const Name& candidate : names) {
+            if (name == candidate.name) {
+                field = candidate.field;
+                return true;
+            }
+        }
+        return false;
+    }
+
+    void skipSpace()
+    {
+        while (pos_ < text_.size() && std::isspace(static_cast<unsigned char>(text_[pos_]))) ++pos_;
+    }
+
+    // Identifier at pos_, lower-cased, consumed
+    std::string readWord()
+    {
+        std::size_t end = pos_;
+        while (end < text_.size() && (std::isalnum(static_cast<unsigned char>(text_[end])) || text_[end] == '_')) ++end;
+        if (end == pos_ || std::isdigit(static_cast<unsigned char>(text_[pos_]))) return std::string();
+        std::string word = text_.substr(pos_, end - pos_);
+        std::transform(word.begin(), word.end(), word.begin(), [](unsigned char c) { return std::tolower(c); });
+        pos_ = end;
+        return word;
+    }
+
+    bool acceptWord(const char* word)
+    {
+        skipSpace();
+        const std::size_t start = pos_;
+        if (readWord() == word) return true;
+        pos_ = start;
+        return false;
+    }
+
+    bool expect(char c)
+    {
+        skipSpace();
+        if (pos_ >= text_.size() || text_[pos_] != c) return fail(std::string("expected '") + c + "'");
+        ++pos_;
+        return true;
+    }
+
+    bool fail(const std::string& message)
+    {
+        error_ = message + " at position " + std::to_string(pos_ + 1);
+        return false;
+    }
+
+    const std::string& text_;
+    ProgramBuilder& builder_;
+    bool positionKnown_;
+    std::size_t pos_ = 0;
+    std::string error_;
+};
+
+std::string trimmed(const std::string& text)
+{
+    std::size_t begin = 0;
+    std::size_t end = text.size();
+    while (begin < end && std::isspace(static_cast<unsigned char>(text[begin]))) ++begin;
+    while (end > begin && std::isspace(static_cast<unsigned char>(text[end - 1]))) --end;
+    return text.substr(begin, end - begin);
+}
+
+// ------------------------
+// Evaluation
+// ------------------------
+
+// The columns of a strategy over one view, and room for each program's temporaries at every bar
+class RuleEvaluator
+{
+public:
+    // Which instructions of a program run
+    enum class Part { All, Shared, PerPosition };
+
+    RuleEvaluator(const BarView& bars, const RuleStrategy& strategy) : indicators_(bars), n_(bars.size())
+    {
+        std::size_t temps = 0;
+        for (const RuleProgram* program : {&strategy.entry, &strategy.exit, &strategy.stop, &strategy.target, &strategy.size}) {
+            regions_.push_back({program, temps * n_});
+            temps += static_cast<std::size_t>(program->temps);
+        }
+        temps_.resize(temps * n_);
+        columns_.reserve(strategy.columns.size());
+        for (const RuleColumn& column : strategy.columns) {
+            columns_.push_back(compute(bars, column));
+        }
+    }
+
+    // Runs part of program over bars [begin, end)
+    void run(const RuleProgram& program, std::size_t begin, std::size_t end, Part part = Part::All)
+    {
+        double* temps = tempsOf(program);
+        for (const RuleInstr& instr : program.code) {
+            if ((part == Part::Shared && instr.perPosition) || (part == Part::PerPosition && !instr.perPosition)) {
+                continue;
+            }
+            const Lane a = lane(instr.a, temps);
+            const Lane b = lane(instr.b, temps);
+            double* out = temps + static_cast<std::size_t>(instr.target) * n_;
+            if (end == begin + 1) {
+                // One bar, as for stops and targets at an entry: no loop to set up
+                out[begin] = applyOp(instr.op, a.varies ? a.values[begin] : *a.values,
+                                     b.varies ? b.values[begin] : *b.values);
+                continue;
+            }
+            withOp(instr.op, [&](auto c) { runOp<decltype(c)::value>(a, b, out, begin, end); });
+        }
+    }
+
+    double result(const RuleProgram& program, std::size_t i)
+    {
+        const Lane value = lane(program.result, tempsOf(program));
+        return value.varies ? value.values[i] : *value.values;
+    }
+
+    // Value of program at bar i for a position entered at entryPrice, held bars ago. With
+    // Part::PerPosition the shared part must have been run over i already.
+    double at(const RuleProgram& program, std::size_t i, double entryPrice, std::size_t held, Part part = Part::All)
+    {
+        entryPrice_ = entryPrice;
+        held_ = static_cast<double>(held);
+        run(program, i, i + 1, part);
+        return result(program, i);
+    }
+
+    // mask[i] = 1 where program holds, for bars [begin, end)
+    void mask(const RuleProgram& program, std::size_t begin, std::size_t end, unsigned char* mask)
+    {
+        if (begin >= end) {
+            return;
+        }
+        run(program, begin, end);
+        const Lane value = lane(program.result, tempsOf(program));
+        if (!value.varies) {
+            std::fill(mask + begin, mask + end, truthy(*value.values) ? 1 : 0);
+            return;
+        }
+        for (std::size_t i = begin; i < end; ++i) {
+            mask[i] = truthy(value.values[i]);
+        }
+    }
+
+private:
+    struct Lane {
+        const double* values;
+        bool varies;      // one value per bar, or one for all
+    };
+
+    struct Region {
+        const RuleProgram* program;
+        std::size_t offset;
+    };
+
+    double* tempsOf(const RuleProgram& program)
+    {
+        for (const Region& region : regions_) {
+            if (region.program == &program) return temps_.data() + region.offset;
+        }
+        return temps_.data();
+    }
+
+    Lane lane(const RuleOperand& operand, const double* temps) const
+    {
+        switch (operand.kind) {
+        case RuleOperand::Column:     return {columns_[static_cast<std::size_t>(operand.index)], true};
+        case RuleOperand::Temp:       return {temps + static_cast<std::size_t>(operand.index) * n_, true};
+        case RuleOperand::EntryPrice: return {&entryPrice_, false};
+        case RuleOperand::BarsHeld:   return {&held_, false};
+        case RuleOperand::Constant:
+        default:                      return {&operand.value, false};
+        }
+    }
+
+    template <RuleOp Op>
+    static void runOp(Lane a, Lane b, double* out, std::size_t begin, std::size_t end)
+    {
+        if (a.varies && b.varies) {
+            for (std::size_t i = begin; i < end; ++i) out[i] = opValue<Op>(a.values[i], b.values[i]);
+        } else if (a.varies) {
+            const double y = *b.values;
+            for (std::size_t i = begin; i < end; ++i) out[i] = opValue<Op>(a.values[i], y);
+        } else if (b.varies) {
+            const double x = *a.values;
+            for (std::size_t i = begin; i < end; ++i) out[i] = opValue<Op>(x, b.values[i]);
+        } else {
+            std::fill(out + begin, out + end, opValue<Op>(*a.values, *b.values));
+        }
+    }
+
+    const double* compute(const BarView& bars, const RuleColumn& column)
+    {
+        const double* fields[] = {bars.open(), bars.high(), bars.low(), bars.close(), bars.volume()};
+        const double* source = fields[static_cast<int>(column.field)];
+        const int period = std::max(1, column.period);
+
+        // Series the feature store keeps
+        switch (column.series) {
+        case RuleSeries::Field:     return source;
+        case RuleSeries::ADR:       return indicators_.values(FeatureKind::ADR, period);
+        case RuleSeries::ATR:       return indicators_.values(FeatureKind::ATR, period);
+        case RuleSeries::AvgVolume: return indicators_.values(FeatureKind::AvgVolume, period);
+        case RuleSeries::SMA:
+            if (column.field == RuleField::Close) return indicators_.values(FeatureKind::SMA, period);
+            break;
+        case RuleSeries::EMA:
+            if (column.field == RuleField::Close) return indicators_.values(FeatureKind::EMA, period);
+            break;
+        default:
+            break;
+        }
+
+        owned_.emplace_back(n_, 0.0);
+        double* out = owned_.back().data();
+        switch (column.series) {
+        case RuleSeries::SMA:     smaSeries(source, n_, period, out); break;
+        case RuleSeries::EMA:     emaSeries(source, n_, period, out); break;
+        case RuleSeries::Highest: rollingMaxSeries(source, n_, period, out); break;
+        case RuleSeries::Lowest:  rollingMinSeries(source, n_, period, out); break;
+        case RuleSeries::RSI:     rsiSeries(bars.close(), n_, period, out); break;
+        case RuleSeries::VWAP:    vwapSeries(bars.high(), bars.low(), bars.close(), bars.volume(), n_, period, out); break;
+        case RuleSeries::Previous:
+            for (std::size_t i = static_cast<std::size_t>(period); i < n_; ++i) out[i] = source[i - period];
+            break;
+        default:
+            break;
+        }
+        return out;
+    }
+
+    Indicators indicators_;
+    std::size_t n_;
+    std::vector<std::vector<double>> owned_;
+    std::vector<const double*> columns_;
+    std::vector<Region> regions_;
+    std::vector<double> temps_;
+    double entryPrice_ = 0.0;
+    double held_ = 0.0;
+};
+
+} // namespace
+
+bool compileRuleStrategy(const std::string& text, RuleStrategy& strategy, std::string& error)
+{
+    strategy = RuleStrategy();
+    ProgramBuilder entry(strategy, strategy.entry);
+    ProgramBuilder exit(strategy, strategy.exit);
+    ProgramBuilder stop(strategy, strategy.stop);
+    ProgramBuilder target(strategy, strategy.target);
+    ProgramBuilder size(strategy, strategy.size);
+
+    struct Section { const char* name; ProgramBuilder* builder; RuleOp combine; bool repeats; bool positionKnown; };
+    const Section sections[] = {
+        {"entry", &entry, RuleOp::And, true, false},   {"filter", &entry, RuleOp::And, true, false},
+        {"exit", &exit, RuleOp::Or, true, true},       {"stop", &stop, RuleOp::And, false, true},
+        {"target", &target, RuleOp::And, false, true}, {"size", &size, RuleOp::And, false, true},
+    };
+
+    std::size_t lineStart = 0;
+    for (int line = 1; lineStart <= text.size(); ++line) {
+        std::size_t lineEnd = text.find('\n', lineStart);
+        if (lineEnd == std::string::npos) lineEnd = text.size();
+        std::string content = text.substr(lineStart, lineEnd - lineStart);
+        lineStart = lineEnd + 1;
+        content = content.substr(0, content.find('#'));
+
+        std::size_t statementStart = 0;
+        while (statementStart <= content.size()) {
+            std::size_t statementEnd = content.find(';', statementStart);
+            if (statementEnd == std::string::npos) statementEnd = content.size();
+            const std::string statement = trimmed(content.substr(statementStart, statementEnd - statementStart));
+            statementStart = statementEnd + 1;
+            if (statement.empty()) {
+                continue;
+            }
+
+            const std::string where = "line " + std::to_string(line) + ": ";
+            const std::size_t colon = statement.find(':');
+            if (colon == std::string::npos) {
+                error = where + "expected 'section: expression'";
+                return false;
+            }
+            std::string name = trimmed(statement.substr(0, colon));
+            std::transform(name.begin(), name.end(), name.begin(), [](unsigned char c) { return std::tolower(c); });
+            const Section* section = nullptr;
+            for (const Section& candidate : sections) {
+                if (name == candidate.name) section = &candidate;
+            }
+            if (!section) {
+                error = where + "unknown section '" + name + "' (entry, filter, exit, stop, target or size)";
+                return false;
+            }
+            if (!section->repeats && section->builder->defined()) {
+                error = where + name + " is given twice";
+                return false;
+            }
+
+            const std::string expression = statement.substr(colon + 1);
+            RuleParser parser(expression, *section->builder, section->positionKnown);
+            RuleOperand value;
+            if (!parser.parse(value)) {
+                error = where + parser.error();
+                return false;
+            }
+            section->builder->add(value, section->combine);
+        }
+    }
+
+    if (!entry.defined()) {
+        error = "an entry line is required";
+        return false;
+    }
+    if (!exit.defined() && !stop.defined() && !target.defined()) {
+        error = "an exit, stop or target line is required";
+        return false;
+    }
+    if (!size.defined()) {
+        const std::string sizing = "100 / adr(14)";
+        RuleParser parser(sizing, size, true);
+        RuleOperand value;
+        parser.parse(value);
+        size.add(value, RuleOp::And);
+    }
+    return true;
+}
+
+SignalStats runRuleStrategy(const BarView& bars, const RuleStrategy& strategy, std::vector<TradeRecord>* trades)
+{
+    BTE_PROFILE_SCOPE("runRuleStrategy");
+    SignalStats stats;
+    const std::size_t n = bars.size();
+    const std::size_t start = std::max({strategy.entry.warmup, strategy.size.warmup,
+                                        strategy.stop.warmup, strategy.target.warmup});
+    if (!strategy.entry.defined || n < start + 2) {
+        return stats;
+    }
+    RuleEvaluator evaluator(bars, strategy);
+
+    // --- Signal arrays ---
+    std::vector<unsigned char> entries(n, 0);
+    evaluator.mask(strategy.entry, start, n - 1, entries.data());
+    const bool hasExit = strategy.exit.defined;
+    const bool exitArray = hasExit && !strategy.exit.usesPosition;
+    const std::size_t exitFrom = strategy.exit.warmup;
+    std::vector<unsigned char> exits;
+    if (exitArray) {
+        exits.assign(n, 0);
+        evaluator.mask(strategy.exit, exitFrom, n, exits.data());
+    } else if (hasExit && exitFrom < n) {
+        // Only the instructions reading the position are left for each bar held
+        evaluator.run(strategy.exit, exitFrom, n, RuleEvaluator::Part::Shared);
+    }
+
+    // --- Resolver ---
+    const unsigned char* entry = entries.data();
+    const double* high = bars.high();
+    const double* low = bars.low();
+    const double* close = bars.close();
+    const int* day = bars.day();
+    const double infinity = std::numeric_limits<double>::infinity();
+    std::size_t from = start;
+    while (from + 1 < n) {
+        const void* found = std::memchr(entry + from, 1, n - 1 - from);
+        if (!found) {
+            break;
+        }
+        const std::size_t e = static_cast<std::size_t>(static_cast<const unsigned char*>(found) - entry);
+        from = e + 1;
+        const double price = close[e];
+        const double shares = evaluator.at(strategy.size, e, price, 0);
+        if (!(shares >= 1.0) || !std::isfinite(shares)) {
+            continue;
+        }
+        const double quantity = std::floor(shares);
+        // A stop or target that is not a number is never reached
+        const double stop = strategy.stop.defined ? evaluator.at(strategy.stop, e, price, 0) : -infinity;
+        const double target = strategy.target.defined ? evaluator.at(strategy.target, e, price, 0) : infinity;
+
+        std::size_t x = e + 1;
+        double exitPrice = 0.0;
+        const char* info = nullptr;
+        for (; x < n; ++x) {
+            if (low[x] <= stop) {
+                exitPrice = stop;
+                info = "Stop";
+                break;
+            }
+            if (high[x] >= target) {
+                exitPrice = target;
+                info = "Target";
+                break;
+            }
+            if (hasExit && x >= exitFrom
+                && (exitArray ? exits[x] != 0 : truthy(evaluator.at(strategy.exit, x, price, x - e, RuleEvaluator::Part::PerPosition)))) {
+                exitPrice = close[x];
+                info = "Exit";
+                break;
+            }
+        }
+        if (!info) {
+            break;   // still open at the last bar
+        }
+
+        const double profit = (exitPrice - price) * quantity;
+        stats.trades++;
+        stats.wins += profit > 0.0;
+        stats.profit += profit;
+        if (trades) {
+            TradeRecord trade;
+            trade.ticker = bars.ticker();
+            trade.buyDate = dayToString(day[e]);
+            trade.sellDate = dayToString(day[x]);
+            trade.buyDay = day[e];
+            trade.sellDay = day[x];
+            trade.buyPrice = price;
+            trade.sellPrice = exitPrice;
+            trade.quantity = quantity;
+            trade.info = info;
+            trades->push_back(trade);
+        }
+        // Flat again after the exit bar
+        from = x + 1;
+    }
+    return stats;
+}
@@ -0,0 +1,99 @@
+#ifndef STRATEGY_RULES_H
+#define STRATEGY_RULES_H
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+#include "backtest.h"
+#include "bar_repository.h"
+#include "signal_backtest.h"
+
+// A strategy written as rules instead of code, one "section: expression" per line (or separated
+// by ';'; '#' starts a comment):
+//
+//   entry:  high > sma(close, 10) + 2 * adr(14) and avgvol(14) > 5e7
+//   filter: close > 5
+//   stop:   entry - adr(14)
+//   target: entry + 3 * adr(14)
+//   exit:   close < ema(close, 20) or held >= 10
+//   size:   100 / adr(14)
+//
+// The strategy buys at the close of a bar where every entry and filter line holds while flat.
+// stop, target and size are evaluated once, on that bar, with entry = the entry close. Each later
+// bar sells at the stop if the low reaches it, else at the target if the high reaches it, else at
+// the close if any exit line holds. A strategy needs at least one of exit, stop or target; size
+// defaults to 100 / adr(14) shares, the Backtest sizing. Positions still open at the last bar are
+// not counted.
+//
+// Expressions have + - * /, comparisons (> >= < <= == !=), and / or / not, parentheses, numbers,
+// the fields open high low close volume, min(a, b), max(a, b), abs(a) and the indicators
+//   sma(field, n)  ema(field, n)  highest(field, n)  lowest(field, n)  prev(field, n)
+//   adr(n)  atr(n)  avgvol(n)  rsi(n)  vwap(n)
+// entry and held (bars since the entry) are known in exit, stop, target and size.
+
+enum class RuleField { Open, High, Low, Close, Volume };
+enum class RuleSeries { Field, SMA, EMA, Highest, Lowest, Previous, ADR, ATR, AvgVolume, RSI, VWAP };
+
+// An input series; field is the value itself for Field and the source of SMA to Previous
+struct RuleColumn {
+    RuleSeries series = RuleSeries::Field;
+    RuleField field = RuleField::Close;
+    int period = 0;
+
+    bool operator==(const RuleColumn& other) const {
+        return series == other.series && field == other.field && period == other.period;
+    }
+};
+
+enum class RuleOp : unsigned char {
+    Add, Sub, Mul, Div, Min, Max, Abs, Neg,
+    Greater, GreaterEqual, Less, LessEqual, Equal, NotEqual,
+    And, Or, Not
+};
+
+struct RuleOperand {
+    enum Kind : unsigned char { Constant, Column, Temp, EntryPrice, BarsHeld };
+    Kind kind = Constant;
+    int index = 0;          // into RuleStrategy::columns, or the temporary
+    double value = 0.0;     // Constant
+};
+
+// target = op(a, b), element-wise over a range of bars
+struct RuleInstr {
+    RuleOp op;
+    int target;
+    RuleOperand a;
+    RuleOperand b;
+    bool perPosition;     // reads entry or held, directly or through a temporary
+};
+
+// One compiled expression. Instructions run in order over a whole range of bars at a time,
+// writing numbered temporaries; comparisons and logic give 1 or 0.
+struct RuleProgram {
+    std::vector<RuleInstr> code;
+    RuleOperand result;
+    int temps = 0;
+    std::size_t warmup = 0;       // first bar at which every column it reads is defined
+    bool usesPosition = false;    // some instruction is perPosition
+    bool defined = false;         // its section was given
+};
+
+struct RuleStrategy {
+    std::vector<RuleColumn> columns;    // every series the programs read, each once
+    RuleProgram entry;                  // entry and filter lines, and-ed
+    RuleProgram exit;                   // exit lines, or-ed
+    RuleProgram stop;
+    RuleProgram target;
+    RuleProgram size;
+};
+
+// Parses text once into strategy. Returns false with a message naming the line on error.
+bool compileRuleStrategy(const std::string& text, RuleStrategy& strategy, std::string& error);
+
+// The columns are computed once per view (indicators the feature store keeps come from there);
+// entry signals and exits that do not read the position are then evaluated over every bar at
+// once. Trades are only formatted into records when trades is given.
+SignalStats runRuleStrategy(const BarView& bars, const RuleStrategy& strategy, std::vector<TradeRecord>* trades = nullptr);
+
+#endif // STRATEGY_RULES_H
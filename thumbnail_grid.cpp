@@ -0,0 +1,298 @@
+#include "thumbnail_grid.h"
+#include "bar_lod.h"
+#include "bar_repository.h"
+#include "candle_renderer.h"
+#include "database.h"
+
+#include <QFutureWatcher>
+#include <QMouseEvent>
+#include <QPaintEvent>
+#include <QPainter>
+#include <QScrollBar>
+#include <QtConcurrent/QtConcurrentRun>
+#include <algorithm>
+#include <climits>
+
+namespace {
+
+constexpr int kTileWidth = 220;
+constexpr int kTileHeight = 140;
+constexpr int kTileSpacing = 8;
+constexpr int kCaptionHeight = 18;
+
+// Rows rendered ahead of the viewport in each direction, so short scrolls show finished tiles
+constexpr int kPrefetchRows = 1;
+// Thumbnails kept before those outside the prefetch range are dropped
+constexpr int kMaxCachedThumbnails = 400;
+
+const QColor kBackground(16, 16, 16);
+const QColor kTileBackground(24, 24, 24);
+const QColor kTileBorder(68, 68, 68);
+
+} // namespace
+
+QImage renderThumbnail(const std::string& ticker, QSize size, qreal devicePixelRatio, int bars)
+{
+    // A history the repository already holds is sliced; otherwise only the last bars are read,
+    // without caching them, so scrolling through a long list does not evict what the chart holds
+    const std::size_t wanted = static_cast<std::size_t>(std::max(1, bars));
+    BarView view = BarRepository::instance().peek(ticker).last(wanted);
+    if (view.empty()) {
+        DbLease db = Database::instance().reader();
+        if (!db) {
+            return QImage();
+        }
+        view = BarView(BarRepository::loadPage(*db, ticker, INT_MAX, wanted, true));
+    }
+    if (view.empty()) {
+        return QImage();
+    }
+
+    QImage image(size * devicePixelRatio, QImage::Format_ARGB32_Premultiplied);
+    image.setDevicePixelRatio(devicePixelRatio);
+    image.fill(kTileBackground);
+
+    ChartMapping mapping;
+    mapping.area = QRectF(2, 2, size.width() - 4, size.height() - 4);
+    mapping.barsVisible = static_cast<double>(view.size());
+
+    // Long histories in a small tile are drawn from merged bars, a few pixels per candle
+    BarPyramid pyramid(view);
+    const int level = pyramid.levelFor(mapping.pixelsPerBar());
+    const BarView& drawn = pyramid.level(level);
+    double minPrice, maxPrice;
+    if (!visiblePriceRange(drawn, 0, drawn.size(), minPrice, maxPrice)) {
+        return QImage();
+    }
+    mapping.minValue = minPrice;
+    mapping.maxValue = maxPrice > minPrice ? maxPrice : minPrice + 1.0;
+
+    QPainter painter(&image);
+    paintCandles(painter, mapping.coarsened(1 << level), drawn, CandleStyle());
+    return image;
+}
+
+ThumbnailGrid::ThumbnailGrid(QWidget *parent)
+    : QAbstractScrollArea(parent)
+{
+    setHorizontalScrollBarPolicy(Qt::ScrollBarAlwaysOff);
+    verticalScrollBar()->setSingleStep(rowHeight() / 4);
+    viewport()->setAttribute(Qt::WA_OpaquePaintEvent);
+}
+
+void ThumbnailGrid::setSymbols(const QStringList &symbols)
+{
+    m_symbols = symbols;
+    verticalScrollBar()->setValue(0);
+    refresh();
+}
+
+void ThumbnailGrid::setBarCount(int bars)
+{
+    if (bars <= 0 || bars == m_barCount) {
+        return;
+    }
+    m_barCount = bars;
+    refresh();
+}
+
+void ThumbnailGrid::refresh()
+{
+    // In-flight jobs carry the old generation and are ignored when they finish
+    m_generation++;
+    m_dataGeneration = BarRepository::instance().generation();
+    m_thumbnails.clear();
+    m_pending.clear();
+    updateScrollBar();
+    viewport()->update();
+}
+
+// --- Layout ---
+
+int ThumbnailGrid::columns() const
+{
+    return std::max(1, (viewport()->width() - kTileSpacing) / (kTileWidth + kTileSpacing));
+}
+
+int ThumbnailGrid::rowHeight() const
+{
+    return kTileHeight + kCaptionHeight + kTileSpacing;
+}
+
+// Image area of tile index; its caption sits just above
+QRect ThumbnailGrid::tileRect(int index) const
+{
+    const int row = index / columns();
+    const int column = index % columns();
+    return QRect(kTileSpacing + column * (kTileWidth + kTileSpacing),
+                 kTileSpacing + row * rowHeight() + kCaptionHeight - verticalScrollBar()->value(),
+                 kTileWidth, kTileHeight);
+}
+
+int ThumbnailGrid::tileAt(const QPoint &pos) const
+{
+    const int row = (pos.y() + verticalScrollBar()->value() - kTileSpacing) / rowHeight();
+    const int column = (pos.x() - kTileSpacing) / (kTileWidth + kTileSpacing);
+    if (pos.x() < kTileSpacing || column >= columns()) {
+        return -1;
+    }
+    const int index = row * columns() + column;
+    if (index < 0 || index >= m_symbols.size() || !tileRect(index).adjusted(0, -kCaptionHeight, 0, 0).contains(pos)) {
+        return -1;
+    }
+    return index;
+}
+
+// Tiles [first, last) intersecting the viewport
+void ThumbnailGrid::visibleRange(int &first, int &last) const
+{
+    const int scroll = verticalScrollBar()->value();
+    const int firstRow = std::max(0, (scroll - kTileSpacing) / rowHeight());
+    const int lastRow = (scroll + viewport()->height()) / rowHeight() + 1;
+    first = std::min(static_cast<int>(m_symbols.size()), firstRow * columns());
+    last = std::min(static_cast<int>(m_symbols.size()), lastRow * columns());
+}
+
+void ThumbnailGrid::updateScrollBar()
+{
+    const int rows = (static_cast<int>(m_symbols.size()) + columns() - 1) / columns();
+    const int contentHeight = rows * rowHeight() + kTileSpacing;
+    verticalScrollBar()->setRange(0, std::max(0, contentHeight - viewport()->height()));
+    verticalScrollBar()->setPageStep(viewport()->height());
+}
+
+// --- Rendering ---
+
+// Queues every tile near the viewport that has neither a thumbnail nor a job yet
+void ThumbnailGrid::requestThumbnails()
+{
+    int first, last;
+    visibleRange(first, last);
+    const int margin = kPrefetchRows * columns();
+    first = std::max(0, first - margin);
+    last = std::min(static_cast<int>(m_symbols.size()), last + margin);
+    m_visible->first.store(first);
+    m_visible->last.store(last);
+
+    const QSize size(kTileWidth, kTileHeight);
+    const qreal ratio = devicePixelRatioF();
+    for (int index = first; index < last; ++index) {
+        const QString &symbol = m_symbols[index];
+        if (m_thumbnails.contains(symbol) || m_pending.contains(symbol)) {
+            continue;
+        }
+        m_pending.insert(symbol);
+
+        const quint64 generation = m_generation;
+        const std::string ticker = symbol.toUpper().toStdString();
+        const int bars = m_barCount;
+        std::shared_ptr<VisibleTiles> visible = m_visible;
+        auto *watcher = new QFutureWatcher<RenderResult>(this);
+        connect(watcher, &QFutureWatcher<RenderResult>::finished, this, [this, watcher, index, symbol, generation]() {
+            onThumbnailRendered(index, symbol, generation, watcher->result());
+            watcher->deleteLater();
+        });
+        watcher->setFuture(QtConcurrent::run([ticker, size, ratio, bars, index, visible]() {
+            RenderResult result;
+            // Scrolled past before a worker got to it; it is queued again if it comes back
+            if (index < visible->first.load() || index >= visible->last.load()) {
+                result.skipped = true;
+                return result;
+            }
+            result.image = renderThumbnail(ticker, size, ratio, bars);
+            return result;
+        }));
+    }
+    evictThumbnails(first, last);
+}
+
+void ThumbnailGrid::onThumbnailRendered(int index, const QString &symbol, quint64 generation,
+                                        const RenderResult &result)
+{
+    if (generation != m_generation) {
+        return;
+    }
+    m_pending.remove(symbol);
+    if (!result.skipped) {
+        m_thumbnails.insert(symbol, Thumbnail{result.image});
+    }
+    // Repainting a skipped tile that came back into view queues it again
+    const QRect tile = tileRect(index).adjusted(0, -kCaptionHeight, 0, 0);
+    if (tile.intersects(viewport()->rect())) {
+        viewport()->update(tile);
+    }
+}
+
+// Keeps the cache bounded by dropping thumbnails of tiles outside [first, last)
+void ThumbnailGrid::evictThumbnails(int first, int last)
+{
+    if (m_thumbnails.size() <= kMaxCachedThumbnails) {
+        return;
+    }
+    for (int index = 0; index < m_symbols.size(); ++index) {
+        if (index < first || index >= last) {
+            m_thumbnails.remove(m_symbols[index]);
+        }
+    }
+}
+
+void ThumbnailGrid::paintEvent(QPaintEvent *event)
+{
+    // Bars were fetched or imported since the thumbnails were drawn
+    if (m_dataGeneration != BarRepository::instance().generation()) {
+        refresh();
+    }
+
+    QPainter painter(viewport());
+    painter.fillRect(event->rect(), kBackground);
+
+    int first, last;
+    visibleRange(first, last);
+    for (int index = first; index < last; ++index) {
+        const QRect tile = tileRect(index);
+        const QRect caption(tile.left(), tile.top() - kCaptionHeight, tile.width(), kCaptionHeight);
+        if (!event->rect().intersects(tile.united(caption))) {
+            continue;
+        }
+
+        const QString &symbol = m_symbols[index];
+        painter.setPen(Qt::white);
+        painter.drawText(caption.adjusted(2, 0, -2, 0), Qt::AlignLeft | Qt::AlignVCenter, symbol);
+
+        auto it = m_thumbnails.constFind(symbol);
+        if (it == m_thumbnails.constEnd()) {
+            painter.fillRect(tile, kTileBackground);
+        } else if (it->image.isNull()) {
+            painter.fillRect(tile, kTileBackground);
+            painter.setPen(Qt::gray);
+            painter.drawText(tile, Qt::AlignCenter, "No data");
+        } else {
+            painter.drawImage(tile.topLeft(), it->image);
+        }
+        painter.setPen(kTileBorder);
+        painter.drawRect(tile.adjusted(0, 0, -1, -1));
+    }
+
+    requestThumbnails();
+}
+
+void ThumbnailGrid::resizeEvent(QResizeEvent *event)
+{
+    QAbstractScrollArea::resizeEvent(event);
+    updateScrollBar();
+}
+
+void ThumbnailGrid::scrollContentsBy(int dx, int dy)
+{
+    Q_UNUSED(dx);
+    viewport()->scroll(0, dy);
+}
+
+void ThumbnailGrid::mouseDoubleClickEvent(QMouseEvent *event)
+{
+    const int index = tileAt(event->pos());
+    if (index >= 0) {
+        emit symbolActivated(m_symbols[index]);
+    }
+    QAbstractScrollArea::mouseDoubleClickEvent(event);
+}
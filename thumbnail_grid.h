@@ -0,0 +1,86 @@
+#ifndef THUMBNAIL_GRID_H
+#define THUMBNAIL_GRID_H
+
+#include <QAbstractScrollArea>
+#include <QHash>
+#include <QImage>
+#include <QSet>
+#include <QString>
+#include <QStringList>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <string>
+
+// Renders the last bars of ticker as a mini candlestick chart into an image of size (device
+// independent pixels). Safe to call from any thread: bars come from the shared BarRepository if it
+// holds them, otherwise they are read on a pooled connection without being cached, and drawing
+// goes to a QImage. Returns a null image if the ticker has no bars.
+QImage renderThumbnail(const std::string& ticker, QSize size, qreal devicePixelRatio, int bars);
+
+// Scrolling grid of mini charts, one tile per symbol. Only the tiles in (or just around) the
+// viewport are ever rendered; each is drawn on the global thread pool and then blitted as an
+// image, so scrolling through thousands of symbols never blocks the GUI thread.
+class ThumbnailGrid : public QAbstractScrollArea
+{
+    Q_OBJECT
+
+public:
+    explicit ThumbnailGrid(QWidget *parent = nullptr);
+
+    void setSymbols(const QStringList &symbols);
+    const QStringList &symbols() const { return m_symbols; }
+
+    // Bars shown per thumbnail; re-renders every tile.
+    void setBarCount(int bars);
+    int barCount() const { return m_barCount; }
+
+    // Drops every thumbnail. Also done on the next paint once BarRepository has invalidated bars,
+    // e.g. after new prices were fetched or imported.
+    void refresh();
+
+signals:
+    void symbolActivated(const QString &symbol);   // tile double-clicked
+
+protected:
+    void paintEvent(QPaintEvent *event) override;
+    void resizeEvent(QResizeEvent *event) override;
+    void scrollContentsBy(int dx, int dy) override;
+    void mouseDoubleClickEvent(QMouseEvent *event) override;
+
+private:
+    // Range of tiles a job may still render; jobs for tiles scrolled far away are skipped.
+    struct VisibleTiles {
+        std::atomic<int> first{0};
+        std::atomic<int> last{0};
+    };
+
+    struct Thumbnail {
+        QImage image;   // null if the ticker has no bars
+    };
+
+    struct RenderResult {
+        QImage image;
+        bool skipped = false;   // tile was out of range by the time a worker picked it up
+    };
+
+    int columns() const;
+    int rowHeight() const;
+    QRect tileRect(int index) const;   // viewport coordinates
+    int tileAt(const QPoint &pos) const;
+    void visibleRange(int &first, int &last) const;
+    void updateScrollBar();
+    void requestThumbnails();
+    void onThumbnailRendered(int index, const QString &symbol, quint64 generation, const RenderResult &result);
+    void evictThumbnails(int first, int last);
+
+    QStringList m_symbols;
+    int m_barCount = 60;
+    QHash<QString, Thumbnail> m_thumbnails;
+    QSet<QString> m_pending;
+    quint64 m_generation = 0;   // bumped whenever cached and in-flight thumbnails become stale
+    std::uint64_t m_dataGeneration = 0;   // BarRepository::generation() the thumbnails were drawn from
+    std::shared_ptr<VisibleTiles> m_visible = std::make_shared<VisibleTiles>();
+};
+
+#endif // THUMBNAIL_GRID_H
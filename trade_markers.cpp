@@ -0,0 +1,66 @@
+#include "trade_markers.h"
+
+#include <algorithm>
+
+namespace {
+
+MarkerKind exitKind(const std::string& info)
+{
+    if (info == "Partial") return MarkerKind::Partial;
+    if (info == "Stop") return MarkerKind::Stop;
+    return MarkerKind::Sell;
+}
+
+} // namespace
+
+const char* markerKindName(MarkerKind kind)
+{
+    switch (kind) {
+    case MarkerKind::Buy:     return "Buy";
+    case MarkerKind::Sell:    return "Sell";
+    case MarkerKind::Partial: return "Partial";
+    case MarkerKind::Stop:    return "Stop";
+    }
+    return "";
+}
+
+TradeMarkerIndex::TradeMarkerIndex(const std::vector<TradeRecord>& trades)
+    : trades_(trades)
+{
+    for (std::size_t i = 0; i < trades_.size(); ++i) {
+        const TradeRecord& trade = trades_[i];
+        std::vector<TradeMarker>& markers = byTicker_[trade.ticker];
+        markers.push_back({trade.buyDay, trade.buyPrice, MarkerKind::Buy, i});
+        markers.push_back({trade.sellDay, trade.sellPrice, exitKind(trade.info), i});
+    }
+
+    for (auto& [ticker, markers] : byTicker_) {
+        // Entries sort ahead of exits on the same day so duplicate buys end up adjacent
+        std::sort(markers.begin(), markers.end(), [](const TradeMarker& a, const TradeMarker& b) {
+            return a.day != b.day ? a.day < b.day : a.kind < b.kind;
+        });
+        // A partial exit and the final exit share one entry; keep a single buy marker for it
+        markers.erase(std::unique(markers.begin(), markers.end(), [](const TradeMarker& a, const TradeMarker& b) {
+                          return a.kind == MarkerKind::Buy && b.kind == MarkerKind::Buy
+                                 && a.day == b.day && a.price == b.price;
+                      }),
+                      markers.end());
+        markers.shrink_to_fit();
+        markerCount_ += markers.size();
+    }
+}
+
+TradeMarkerIndex::Range TradeMarkerIndex::range(const std::string& ticker, int firstDay, int lastDay) const
+{
+    auto it = byTicker_.find(ticker);
+    if (it == byTicker_.end() || firstDay > lastDay) {
+        return {nullptr, nullptr};
+    }
+    const std::vector<TradeMarker>& markers = it->second;
+    auto first = std::lower_bound(markers.begin(), markers.end(), firstDay,
+                                  [](const TradeMarker& marker, int day) { return marker.day < day; });
+    auto last = std::upper_bound(first, markers.end(), lastDay,
+                                 [](int day, const TradeMarker& marker) { return day < marker.day; });
+    const TradeMarker* base = markers.data();
+    return {base + (first - markers.begin()), base + (last - markers.begin())};
+}
@@ -0,0 +1,46 @@
+#ifndef TRADE_MARKERS_H
+#define TRADE_MARKERS_H
+
+#include <cstddef>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "backtest.h"
+
+enum class MarkerKind { Buy, Sell, Partial, Stop };
+
+// One entry or exit of a backtest trade, placed at the bar it filled on.
+struct TradeMarker {
+    int day;                  // days since 1970-01-01, see day_number.h
+    double price;
+    MarkerKind kind;
+    std::size_t tradeIndex;   // into the run's trade list
+};
+
+// Entry and exit markers of one backtest run, grouped per ticker and sorted by day so the chart
+// can fetch the markers of its visible range, or of the bar under the cursor, by binary search.
+class TradeMarkerIndex
+{
+public:
+    using Range = std::pair<const TradeMarker*, const TradeMarker*>;
+
+    TradeMarkerIndex() = default;
+    explicit TradeMarkerIndex(const std::vector<TradeRecord>& trades);
+
+    // Markers of ticker with firstDay <= day <= lastDay.
+    Range range(const std::string& ticker, int firstDay, int lastDay) const;
+
+    const std::vector<TradeRecord>& trades() const { return trades_; }
+    std::size_t markerCount() const { return markerCount_; }
+
+private:
+    std::vector<TradeRecord> trades_;
+    std::unordered_map<std::string, std::vector<TradeMarker>> byTicker_;
+    std::size_t markerCount_ = 0;
+};
+
+const char* markerKindName(MarkerKind kind);
+
+#endif // TRADE_MARKERS_H
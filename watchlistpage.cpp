@@ -0,0 +1,66 @@
+#include "watchlistpage.h"
+#include "thumbnail_grid.h"
+
+#include <QFile>
+#include <QFileDialog>
+#include <QRegularExpression>
+#include <QDebug>
+
+WatchlistPage::WatchlistPage(QWidget *parent) :
+    QWidget(parent),
+    ui(new Ui::WatchlistPage)
+{
+    ui->setupUi(this);
+
+    connect(ui->loadUniverseButton, &QPushButton::clicked, this, &WatchlistPage::loadSymbolsFile);
+    connect(ui->enterBars, &QLineEdit::editingFinished, this, &WatchlistPage::updateBarCount);
+    connect(ui->thumbnailGrid, &ThumbnailGrid::symbolActivated, this, &WatchlistPage::symbolActivated);
+}
+
+WatchlistPage::~WatchlistPage()
+{
+    delete ui;
+}
+
+void WatchlistPage::setSymbols(const QStringList &symbols)
+{
+    ui->thumbnailGrid->setSymbols(symbols);
+    ui->symbolCount->setText(QString("%1 symbols").arg(symbols.size()));
+}
+
+// One symbol per line, like universe.csv; a "Symbol" header line is skipped
+void WatchlistPage::loadSymbolsFile()
+{
+    QString filePath = QFileDialog::getOpenFileName(this, "Load Symbols", "universe.csv", "CSV files (*.csv);;All files (*)");
+    if (filePath.isEmpty()) {
+        return;
+    }
+
+    QFile file(filePath);
+    if (!file.open(QIODevice::ReadOnly | QIODevice::Text)) {
+        qWarning() << "Could not open file:" << filePath;
+        return;
+    }
+    static const QRegularExpression breakLines("[\r\n]+");
+    QStringList lines = QString(file.readAll()).split(breakLines, Qt::SkipEmptyParts);
+
+    QStringList symbols;
+    symbols.reserve(lines.size());
+    for (const QString &line : lines) {
+        QString symbol = line.section(',', 0, 0).trimmed().toUpper();
+        if (!symbol.isEmpty() && symbol != "SYMBOL") {
+            symbols.append(symbol);
+        }
+    }
+    setSymbols(symbols);
+}
+
+void WatchlistPage::updateBarCount()
+{
+    int bars = ui->enterBars->text().toInt();
+    if (bars <= 0) {
+        ui->enterBars->setText(QString::number(ui->thumbnailGrid->barCount()));
+        return;
+    }
+    ui->thumbnailGrid->setBarCount(bars);
+}
@@ -0,0 +1,32 @@
+#ifndef WATCHLISTPAGE_H
+#define WATCHLISTPAGE_H
+
+#include <QWidget>
+#include <QStringList>
+#include "ui_watchlistpage.h"  // Generated from watchlistpage.ui
+
+// Grid of mini charts for a list of symbols, e.g. a universe file or the tickers that passed a
+// screen. Double-clicking a chart opens the symbol on the charting page.
+class WatchlistPage : public QWidget
+{
+    Q_OBJECT
+
+public:
+    explicit WatchlistPage(QWidget *parent = nullptr);
+    ~WatchlistPage();
+
+public slots:
+    void setSymbols(const QStringList &symbols);
+
+signals:
+    void symbolActivated(const QString &symbol);
+
+private slots:
+    void loadSymbolsFile();
+    void updateBarCount();
+
+private:
+    Ui::WatchlistPage *ui;
+};
+
+#endif // WATCHLISTPAGE_H